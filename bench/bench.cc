@@ -0,0 +1,139 @@
+#include <bench.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+/**
+ * Every allocation of the process goes through these, which is how allocations per operation are counted.
+ * The counter is a single relaxed atomic, so counting barely affects what is being measured.
+ */
+static std::atomic<uint64_t> allocationCount{0};
+
+static void* CountedAllocate(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void* memory = malloc(size ? size : 1);
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size) { return CountedAllocate(size); }
+void* operator new[](size_t size) { return CountedAllocate(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+
+namespace Bench {
+    struct Case {
+        std::string name;
+        Setup setup;
+    };
+
+    static std::vector<Case>& Cases() {
+        static std::vector<Case> cases;
+        return cases;
+    }
+
+    static std::string currentNote;
+    static std::string currentFailure;
+
+    void Register(std::string name, Setup setup) {
+        Cases().push_back({ std::move(name), std::move(setup) });
+    }
+
+    void SetNote(std::string note) {
+        currentNote = std::move(note);
+    }
+
+    void Fail(std::string message) {
+        if (currentFailure.empty()) currentFailure = std::move(message);
+    }
+
+    uint64_t AllocationCount() {
+        return allocationCount.load(std::memory_order_relaxed);
+    }
+
+    struct Measurement {
+        uint64_t iterations;
+        double nanoseconds;
+        uint64_t allocations;
+    };
+
+    static Measurement Measure(const Loop& loop, uint64_t iterations) {
+        uint64_t allocationsBefore = AllocationCount();
+        auto start = std::chrono::steady_clock::now();
+        loop(iterations);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        return { iterations, (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(), AllocationCount() - allocationsBefore };
+    }
+
+    /**
+     * Grow the iteration count until a run takes at least a tenth of the minimum time, then do one run sized to the minimum time.
+     * The runs before the final one double as the warm up.
+     */
+    static Measurement Run(const Loop& loop, double minimumNanoseconds) {
+        uint64_t iterations = 1;
+        Measurement probe = Measure(loop, iterations);
+        while (probe.nanoseconds < minimumNanoseconds / 10 && iterations < (1ull << 40)) {
+            iterations *= probe.nanoseconds < minimumNanoseconds / 1000 ? 10 : 2;
+            probe = Measure(loop, iterations);
+        }
+
+        double perIteration = probe.nanoseconds / (double)probe.iterations;
+        uint64_t target = perIteration > 0 ? (uint64_t)(minimumNanoseconds / perIteration) : iterations;
+        if (target < 1) target = 1;
+        return Measure(loop, target);
+    }
+
+    int RunAll(int argc, char** argv) {
+        const char* filter = "";
+        double minimumMilliseconds = 200;
+        bool failed = false;
+
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--list") == 0) {
+                for (const Case& benchCase : Cases()) printf("%s\n", benchCase.name.c_str());
+                return 0;
+            }
+            if (strncmp(argv[i], "--min-time=", 11) == 0) {
+                minimumMilliseconds = atof(argv[i] + 11);
+                continue;
+            }
+            filter = argv[i];
+        }
+
+        printf("%-52s %12s %14s %12s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+        for (const Case& benchCase : Cases()) {
+            if (!strstr(benchCase.name.c_str(), filter)) continue;
+
+            currentNote.clear();
+            currentFailure.clear();
+            Loop loop = benchCase.setup();
+            Measurement result = Run(loop, minimumMilliseconds * 1e6);
+
+            printf("%-52s %12llu %14.1f %12.2f", benchCase.name.c_str(), (unsigned long long)result.iterations,
+                result.nanoseconds / (double)result.iterations, (double)result.allocations / (double)result.iterations);
+            if (!currentNote.empty()) printf("  %s", currentNote.c_str());
+            printf("\n");
+            if (!currentFailure.empty()) {
+                printf("    FAILED: %s\n", currentFailure.c_str());
+                failed = true;
+            }
+            fflush(stdout);
+        }
+        return failed ? 1 : 0;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * A small benchmark harness: every case reports the time and the number of heap allocations per operation.
+ *
+ * A case is registered as a setup function that builds its fixture (untimed) and returns the loop to time.
+ * The loop is called with an iteration count, which the harness grows until a run takes long enough to be measured.
+ */
+namespace Bench {
+    /** Runs the operation being measured the given number of times. */
+    using Loop = std::function<void(uint64_t iterations)>;
+    /** Builds the fixture of a case and returns its loop. */
+    using Setup = std::function<Loop()>;
+
+    /**
+     * Register a benchmark case.
+     *
+     * @param name The name of the case, "group/case/parameter:value" by convention.
+     * @param setup Builds the fixture and returns the timed loop.
+     */
+    void Register(std::string name, Setup setup);
+
+    /**
+     * Attach a note to the result of the case that is currently running (e.g. latency percentiles), printed after its numbers.
+     *
+     * @param note The note.
+     */
+    void SetNote(std::string note);
+
+    /**
+     * Fail the case that is currently running, for cases that also check what they measure. The first failure of a case is printed
+     * after its numbers and makes the benchmark executable exit with 1.
+     *
+     * @param message What went wrong.
+     */
+    void Fail(std::string message);
+
+    /** @return How many heap allocations were made so far, by any thread. */
+    uint64_t AllocationCount();
+
+    /**
+     * Run every registered case whose name contains the filter given on the command line.
+     * Options: --list prints the case names, --min-time=<ms> sets how long each case runs for (default 200).
+     *
+     * @return The exit code of the benchmark executable, 1 if a case failed.
+     */
+    int RunAll(int argc, char** argv);
+
+    /** Keep the compiler from optimizing away a value that is otherwise unused. */
+    template <typename T>
+    inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+}
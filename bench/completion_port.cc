@@ -0,0 +1,115 @@
+#include <completion_port.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+CompletionPort::CompletionPort() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = eventFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &event);
+}
+
+CompletionPort::~CompletionPort() {
+    close(eventFd);
+    close(epollFd);
+}
+
+void CompletionPort::Associate(int fd, uint64_t key) {
+    std::lock_guard<std::mutex> guard(lock);
+    keys[fd] = key;
+
+    /** One-shot, so a socket is only reported again once a new read is armed on it. */
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+uint64_t CompletionPort::KeyOf(int fd) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = keys.find(fd);
+    return it == keys.end() ? 0 : it->second;
+}
+
+void CompletionPort::Complete(int fd, const PendingRead& read) {
+    ssize_t length = recv(fd, read.buffer, read.length, MSG_DONTWAIT);
+    Packet packet = { KeyOf(fd), length > 0 ? (size_t)length : 0, read.overlapped, length < 0 ? errno : 0 };
+    Post(packet);
+}
+
+void CompletionPort::Read(int fd, void* buffer, size_t length, void* overlapped) {
+    PendingRead read = { buffer, length, overlapped };
+
+    /** Like a WSARecv that succeeds synchronously, a read with data already there still queues its completion. */
+    ssize_t received = recv(fd, buffer, length, MSG_DONTWAIT | MSG_PEEK);
+    if (received >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        Complete(fd, read);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        pending[fd] = read;
+    }
+
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+void CompletionPort::Post(const Packet& packet) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        completed.push_back(packet);
+    }
+
+    uint64_t one = 1;
+    ssize_t written = write(eventFd, &one, sizeof(one));
+    (void)written;
+}
+
+bool CompletionPort::GetQueued(Packet& packet, int timeoutMilliseconds) {
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!completed.empty()) {
+                packet = completed.front();
+                completed.pop_front();
+                return true;
+            }
+        }
+
+        epoll_event events[16];
+        int count = epoll_wait(epollFd, events, 16, timeoutMilliseconds);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == eventFd) {
+                uint64_t value;
+                ssize_t drained = read(eventFd, &value, sizeof(value));
+                (void)drained;
+                continue;
+            }
+
+            PendingRead read;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                auto it = pending.find(fd);
+                if (it == pending.end()) continue;
+
+                read = it->second;
+                pending.erase(it);
+            }
+            Complete(fd, read);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * A stand-in for a Windows I/O completion port built on epoll and an eventfd, so the overlapped read path of the gate
+ * (HookedWSARecv and OverlappedReads in main.cc) can be run and measured on Linux.
+ *
+ * Reads are issued like overlapped WSARecv calls: they complete right away if data is already there, otherwise when the socket
+ * becomes readable, and either way their completion is dequeued as a packet with GetQueued. Packets can also be posted directly,
+ * like PostQueuedCompletionStatus, which is how the gate fails reads of blocked sockets.
+ */
+class CompletionPort {
+public:
+    struct Packet {
+        uint64_t key;
+        /** Bytes read, 0 for a failed read. */
+        size_t bytes;
+        /** Identifies the read, like the OVERLAPPED pointer. */
+        void* overlapped;
+        /** 0 on success, an errno value otherwise. */
+        int error;
+    };
+
+    CompletionPort();
+    ~CompletionPort();
+
+    CompletionPort(const CompletionPort&) = delete;
+    CompletionPort& operator=(const CompletionPort&) = delete;
+
+    /** Associate a socket with the port, like CreateIoCompletionPort. Completions of its reads carry the key. */
+    void Associate(int fd, uint64_t key);
+
+    /**
+     * Issue an overlapped read. The buffer has to stay valid until the completion is dequeued.
+     * Only one read per socket can be outstanding, which is all the gate (and Chromium) ever issues.
+     */
+    void Read(int fd, void* buffer, size_t length, void* overlapped);
+
+    /** Queue a completion packet, like PostQueuedCompletionStatus. Safe to call from any thread. */
+    void Post(const Packet& packet);
+
+    /**
+     * Dequeue the next completion, like GetQueuedCompletionStatus.
+     *
+     * @param packet Receives the completion.
+     * @param timeoutMilliseconds How long to wait for one, -1 to wait forever.
+     * @return false on timeout.
+     */
+    bool GetQueued(Packet& packet, int timeoutMilliseconds);
+
+private:
+    struct PendingRead {
+        void* buffer;
+        size_t length;
+        void* overlapped;
+    };
+
+    void Complete(int fd, const PendingRead& read);
+    uint64_t KeyOf(int fd);
+
+    int epollFd;
+    int eventFd;
+
+    std::mutex lock;
+    std::deque<Packet> completed;
+    std::unordered_map<int, PendingRead> pending;
+    std::unordered_map<int, uint64_t> keys;
+};
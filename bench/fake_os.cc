@@ -0,0 +1,122 @@
+#include <fake_os.h>
+
+void FakeOs::MountVolumes(size_t count) {
+    std::lock_guard<std::mutex> guard(lock);
+    volumes.clear();
+    for (size_t i = 0; i < count; i++) {
+        DevicePrefix prefix;
+        prefix.device = "\\Device\\HarddiskVolume" + std::to_string(i + 1);
+        prefix.dos = std::string(1, (char)('C' + i % 24)) + ":";
+        volumes.push_back(prefix);
+    }
+    volumeSignature++;
+}
+
+void FakeOs::TouchVolumes() {
+    std::lock_guard<std::mutex> guard(lock);
+    volumeSignature++;
+}
+
+uint32_t FakeOs::Spawn(size_t volume, const std::string& image, FileIdentity identity) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint32_t processId = nextProcessId;
+    nextProcessId += 4;
+
+    processes[processId] = { nextStartTime++, "\\Device\\HarddiskVolume" + std::to_string(volume + 1) + image, identity };
+    return processId;
+}
+
+void FakeOs::Recycle(uint32_t processId, const std::string& image, FileIdentity identity) {
+    std::lock_guard<std::mutex> guard(lock);
+    Process& process = processes[processId];
+
+    size_t volumeEnd = process.imagePath.find('\\', 8);
+    process.imagePath = process.imagePath.substr(0, volumeEnd) + image;
+    process.identity = identity;
+    process.startTime = nextStartTime++;
+}
+
+TcpConnectionKey FakeOs::Connect(uint32_t owner, uint16_t listenerPort) {
+    std::lock_guard<std::mutex> guard(lock);
+    uint16_t clientPort = nextClientPort++;
+    if (nextClientPort == 0) nextClientPort = 1024;
+
+    /** The client's row is the one the resolver looks for, the listener's row is in the table as well, just like on a real system. */
+    TcpTableRow client = { { LOOPBACK, LOOPBACK, clientPort, listenerPort }, owner };
+    TcpTableRow server = { { LOOPBACK, LOOPBACK, listenerPort, clientPort }, 4 };
+    tcpTable.push_back(client);
+    tcpTable.push_back(server);
+
+    return server.key;
+}
+
+void FakeOs::Reconnect(const TcpConnectionKey& connection, uint32_t owner) {
+    std::lock_guard<std::mutex> guard(lock);
+    TcpConnectionKey client = { connection.remoteIP, connection.localIP, connection.remotePort, connection.localPort };
+    for (TcpTableRow& row : tcpTable) {
+        if (row.key == client) row.owningPid = owner;
+    }
+}
+
+void FakeOs::FillTcpTable(size_t rows) {
+    std::lock_guard<std::mutex> guard(lock);
+    while (tcpTable.size() < rows) {
+        TcpTableRow row;
+        row.key.localIP = nextClientAddress;
+        row.key.localPort = nextClientPort;
+        row.key.remoteIP = 0x5DB8D822;
+        row.key.remotePort = 443;
+        row.owningPid = 8 + (uint32_t)(tcpTable.size() % 97) * 4;
+        tcpTable.push_back(row);
+
+        if (++nextClientPort == 0) {
+            nextClientPort = 1024;
+            nextClientAddress++;
+        }
+    }
+}
+
+void FakeOs::ClearTcpTable() {
+    std::lock_guard<std::mutex> guard(lock);
+    tcpTable.clear();
+}
+
+bool FakeOs::LoadTcpTable(std::vector<TcpTableRow>& rows) {
+    std::lock_guard<std::mutex> guard(lock);
+    rows.assign(tcpTable.begin(), tcpTable.end());
+    return true;
+}
+
+bool FakeOs::GetProcessStartTime(uint32_t processId, uint64_t& startTime) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = processes.find(processId);
+    if (it == processes.end()) return false;
+
+    startTime = it->second.startTime;
+    return true;
+}
+
+bool FakeOs::QueryProcessImage(uint32_t processId, ProcessImage& image) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = processes.find(processId);
+    if (it == processes.end()) return false;
+
+    image.identity = it->second.identity;
+    return image.path.Assign(it->second.imagePath);
+}
+
+bool FakeOs::LoadDevicePrefixes(std::vector<DevicePrefix>& prefixes) {
+    std::lock_guard<std::mutex> guard(lock);
+    prefixes = volumes;
+    return true;
+}
+
+uint64_t FakeOs::VolumeSignature() {
+    std::lock_guard<std::mutex> guard(lock);
+    return volumeSignature;
+}
+
+size_t FakeOs::TcpTableSize() {
+    std::lock_guard<std::mutex> guard(lock);
+    return tcpTable.size();
+}
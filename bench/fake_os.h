@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <device_path_map.h>
+#include <file_identity.h>
+#include <process_path.h>
+#include <tcp_snapshot.h>
+
+/**
+ * A synthetic operating system for the benchmarks: a TCP table, a process list and a set of mounted volumes.
+ * It answers the same questions the resolver asks the real OS (through the same loader signatures the providers take),
+ * so the resolver logic can be measured at any table size without touching the machine it runs on.
+ */
+class FakeOs {
+public:
+    struct Process {
+        uint64_t startTime;
+        /** The image path as the OS reports it, a device path like on Windows. */
+        std::string imagePath;
+        FileIdentity identity;
+    };
+
+    /** The address the gated process listens on, every fake connection goes to it. */
+    static constexpr uint32_t LOOPBACK = 0x7F000001;
+
+    /**
+     * Mount a number of volumes, as "\Device\HarddiskVolume<n>" on drive letters starting at C:.
+     *
+     * @param count The number of volumes.
+     */
+    void MountVolumes(size_t count);
+
+    /** Change the volume signature without changing the volumes, which forces the device map to be rebuilt. */
+    void TouchVolumes();
+
+    /**
+     * Start a process.
+     *
+     * @param volume The volume its image is on.
+     * @param image The path of its image on that volume, e.g. "\Steam\steam.exe".
+     * @param identity The file identity of its image.
+     * @return The ID of the new process.
+     */
+    uint32_t Spawn(size_t volume, const std::string& image, FileIdentity identity);
+
+    /**
+     * Make a PID belong to a new process, as happens when a process exits and its PID is handed out again.
+     *
+     * @param processId The PID to recycle.
+     * @param image The image of the new process.
+     * @param identity The identity of its image.
+     */
+    void Recycle(uint32_t processId, const std::string& image, FileIdentity identity);
+
+    /**
+     * Open a connection from a process to the listener port.
+     *
+     * @param owner The process owning the client end.
+     * @param listenerPort The port of the listener.
+     * @return The connection as seen from the listener (local is the listener's end), which is what the gate knows about a socket.
+     */
+    TcpConnectionKey Connect(uint32_t owner, uint16_t listenerPort);
+
+    /**
+     * Close a connection and open a new one from another process on the same 4-tuple, as happens once a client port is reused.
+     *
+     * @param connection The connection, as returned by Connect.
+     * @param owner The process owning the client end of the new connection.
+     */
+    void Reconnect(const TcpConnectionKey& connection, uint32_t owner);
+
+    /**
+     * Fill the TCP table with unrelated connections owned by unrelated processes, until it has the given number of rows.
+     *
+     * @param rows The number of rows the table should have.
+     */
+    void FillTcpTable(size_t rows);
+
+    /** Remove every connection, keeping the processes. */
+    void ClearTcpTable();
+
+    bool LoadTcpTable(std::vector<TcpTableRow>& rows);
+    bool GetProcessStartTime(uint32_t processId, uint64_t& startTime);
+    bool QueryProcessImage(uint32_t processId, ProcessImage& image);
+    bool LoadDevicePrefixes(std::vector<DevicePrefix>& prefixes);
+    uint64_t VolumeSignature();
+
+    size_t TcpTableSize();
+
+private:
+    std::mutex lock;
+    std::vector<TcpTableRow> tcpTable;
+    std::unordered_map<uint32_t, Process> processes;
+    std::vector<DevicePrefix> volumes;
+    uint64_t volumeSignature = 0;
+    uint32_t nextProcessId = 1000;
+    uint64_t nextStartTime = 1;
+    uint16_t nextClientPort = 1024;
+    uint32_t nextClientAddress = 0x0A000001;
+};
@@ -0,0 +1,105 @@
+#include <fake_resolver.h>
+#include <chrono>
+#include <metrics.h>
+#include <resolve_trace.h>
+
+FakeResolver::FakeResolver(FakeOs& os, size_t cacheCapacity)
+    : os(os),
+      tcp([&os](std::vector<TcpTableRow>& rows) {
+          PhaseTimer timer(ResolvePhase::TcpTable);
+          return os.LoadTcpTable(rows);
+      }),
+      devices([&os](std::vector<DevicePrefix>& prefixes) { return os.LoadDevicePrefixes(prefixes); }, [&os]() { return os.VolumeSignature(); }),
+      cache(cacheCapacity),
+      blockLimiter(8, 2) {}
+
+void FakeResolver::Trust(uint32_t parentPid, FileIdentity identity) {
+    trustedParent = parentPid;
+    trustedIdentity = identity;
+}
+
+ResolveResult FakeResolver::ResolveRemoteProcessId(const TcpConnectionKey& connection, uint32_t& owningPid) {
+    const uint64_t mark = tcp.Mark();
+
+    /** The row we are after is the one owned by the peer, so its local end is the remote end of our socket and vice versa. */
+    TcpConnectionKey key = {};
+    key.localIP = connection.remoteIP;
+    key.localPort = connection.remotePort;
+    key.remoteIP = connection.localIP;
+    key.remotePort = connection.localPort;
+
+    ResolveTrace& trace = ResolveTrace::Current();
+    trace.connection = connection;
+
+    PhaseTimer timer(ResolvePhase::MatchProcess);
+    if (!tcp.FindOwningPid(key, mark, owningPid)) {
+        return ResolveResult::ConnectionNotFound;
+    }
+    trace.owningPid = owningPid;
+    return ResolveResult::Ok;
+}
+
+ResolveResult FakeResolver::GetExecutableNameFromPID(uint32_t processId, ProcessImage& image) {
+    if (processId == 0 || processId == 4) {
+        image.path.Assign("System");
+        return ResolveResult::SystemProcess;
+    }
+
+    ProcessKey key = { processId, 0 };
+    bool hasStartTime = os.GetProcessStartTime(processId, key.startTime);
+
+    if (hasStartTime && cache.Lookup(key, image)) {
+        return ResolveResult::Ok;
+    }
+
+    {
+        PhaseTimer timer(ResolvePhase::ProcessImage);
+        if (!os.QueryProcessImage(processId, image)) {
+            return ResolveResult::ProcessQueryFailed;
+        }
+    }
+
+    if (image.path.View().substr(0, 8) == "\\Device\\") {
+        PhaseTimer timer(ResolvePhase::DevicePath);
+        char dosPath[PROCESS_PATH_CAPACITY];
+        if (devices.Translate(image.path.View(), dosPath, sizeof(dosPath))) {
+            image.path.Assign(dosPath);
+        }
+    }
+
+    if (hasStartTime && image.identity.IsValid()) {
+        cache.Insert(key, image);
+    }
+    return ResolveResult::Ok;
+}
+
+bool FakeResolver::IsSteamProcess(const TcpConnectionKey& connection, uint32_t& peerPid) {
+    peerPid = 0;
+    if (ResolveRemoteProcessId(connection, peerPid) != ResolveResult::Ok) {
+        peerPid = 0;
+        return false;
+    }
+
+    /** As in SecurityCheck, the PID alone is only trusted because ResolveRemoteProcessId never takes it from a snapshot older than the connection. */
+    if (trustedParent != 0 && peerPid == trustedParent) return true;
+
+    ProcessImage image;
+    if (GetExecutableNameFromPID(peerPid, image) != ResolveResult::Ok) return false;
+
+    return trustedIdentity.IsValid() && image.identity == trustedIdentity;
+}
+
+Verdict FakeResolver::ResolveVerdict(const TcpConnectionKey& connection) {
+    const auto start = std::chrono::steady_clock::now();
+    ResolveTrace& trace = ResolveTrace::Begin();
+
+    uint32_t peerPid = 0;
+    Verdict verdict = Verdict::Allow;
+    if (!IsSteamProcess(connection, peerPid)) {
+        verdict = blockLimiter.Consume(peerPid) ? Verdict::Block : Verdict::Drop;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    Metrics::RecordDecision(verdict, trace, (uint64_t)elapsed.count());
+    return verdict;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <device_path_map.h>
+#include <fake_os.h>
+#include <process_path.h>
+#include <process_path_cache.h>
+#include <rate_limiter.h>
+#include <tcp_snapshot.h>
+#include <verdict_cache.h>
+
+/**
+ * The resolver and trust decision of the gate (SocketProcessResolver and SecurityCheck), built from the same shared providers and caches
+ * but asking a FakeOs instead of the real one. Each step mirrors its counterpart in src/socket_trace.cc and src/security_check.cc,
+ * so the benchmarks measure the logic we ship rather than a model of it.
+ */
+class FakeResolver {
+public:
+    explicit FakeResolver(FakeOs& os, size_t cacheCapacity = 64);
+
+    /**
+     * Trust a parent process by PID and an executable by identity, like SecurityCheck::Initialize.
+     *
+     * @param parentPid The PID of the trusted parent, or 0.
+     * @param identity The identity of the trusted executable.
+     */
+    void Trust(uint32_t parentPid, FileIdentity identity);
+
+    /** @see SocketProcessResolver::ResolveRemoteProcessId */
+    ResolveResult ResolveRemoteProcessId(const TcpConnectionKey& connection, uint32_t& owningPid);
+
+    /** @see SocketProcessResolver::GetExecutableNameFromPID */
+    ResolveResult GetExecutableNameFromPID(uint32_t processId, ProcessImage& image);
+
+    /** @see SecurityCheck::IsSteamProcess */
+    bool IsSteamProcess(const TcpConnectionKey& connection, uint32_t& peerPid);
+
+    /** The verdict main.cc's SecurityCheck::ResolveVerdict would decide, including the block budget and metrics. */
+    Verdict ResolveVerdict(const TcpConnectionKey& connection);
+
+    TcpSnapshotProvider& Tcp() { return tcp; }
+    DevicePathMap& Devices() { return devices; }
+    ProcessPathCache& Cache() { return cache; }
+
+private:
+    FakeOs& os;
+    TcpSnapshotProvider tcp;
+    DevicePathMap devices;
+    ProcessPathCache cache;
+    PeerRateLimiter blockLimiter;
+
+    uint32_t trustedParent = 0;
+    FileIdentity trustedIdentity;
+};
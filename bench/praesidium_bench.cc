@@ -0,0 +1,2276 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <bench.h>
+#include <fake_os.h>
+#include <fake_resolver.h>
+#include <cdp_filter.h>
+#include <command_line.h>
+#include <debugger_port.h>
+#include <decision_log.h>
+#include <http_scanner.h>
+#include <latency_histogram.h>
+#include <rate_limiter.h>
+#include <resolver_pool.h>
+#include <sha256.h>
+#include <verdict_cache.h>
+#include <websocket_frames.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <spawn.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <completion_port.h>
+#include <deferred_reads.h>
+#include <epoch_pointer.h>
+#include <file_hash.h>
+#include <sock_diag.h>
+#include <socket_owner_index.h>
+#include <trust_policy.h>
+#include <trusted_process.h>
+#include <utilities.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#endif
+
+/**
+ * Microbenchmarks of the resolver and the gate's per-recv decision, run against a FakeOs.
+ *
+ * Usage: praesidium_bench [--list] [--min-time=<ms>] [filter]
+ */
+
+static const uint16_t DEBUGGER_PORT = 8080;
+static const FileIdentity STEAM_IDENTITY = { 0x1234, 0x5678 };
+static const FileIdentity OTHER_IDENTITY = { 0x1234, 0x9ABC };
+
+static const size_t TABLE_SIZES[] = { 10, 1000, 10000, 100000 };
+
+/**
+ * A system with steam.exe running and the gated process listening on the debugger port.
+ * Sockets of the gated process are numbered, socket N is connections[N].
+ */
+struct GateFixture {
+    FakeOs os;
+    FakeResolver resolver;
+    uint32_t steamPid;
+    uint32_t helperPid;
+    uint32_t otherPid;
+    std::vector<TcpConnectionKey> connections;
+
+    explicit GateFixture(size_t volumes = 4) : resolver(os) {
+        os.MountVolumes(volumes);
+        steamPid = os.Spawn(0, "\\Program Files (x86)\\Steam\\steam.exe", STEAM_IDENTITY);
+        helperPid = os.Spawn(0, "\\Program Files (x86)\\Steam\\steam.exe", STEAM_IDENTITY);
+        otherPid = os.Spawn(volumes - 1, "\\Users\\Public\\evil.exe", OTHER_IDENTITY);
+        resolver.Trust(steamPid, STEAM_IDENTITY);
+    }
+
+    /** Open connections from a process, then pad the table and take the snapshot so all of them are in it. */
+    void Connect(uint32_t owner, size_t count, size_t tableRows) {
+        for (size_t i = 0; i < count; i++) {
+            connections.push_back(os.Connect(owner, DEBUGGER_PORT));
+        }
+        os.FillTcpTable(tableRows);
+        resolver.Tcp().Refresh();
+    }
+};
+
+static std::string WithParameter(const char* name, const char* parameter, size_t value) {
+    return std::string(name) + "/" + parameter + ":" + std::to_string(value);
+}
+
+/** Format percentiles of a latency histogram as a note. */
+static std::string LatencyNote(const LatencyHistogram& histogram) {
+    std::unique_ptr<LatencyHistogram::Snapshot> snapshot(new LatencyHistogram::Snapshot());
+    histogram.Read(*snapshot);
+
+    char note[128];
+    snprintf(note, sizeof(note), "p50=%lluns p99=%lluns max=%lluns", (unsigned long long)snapshot->ValueAtQuantile(0.5),
+        (unsigned long long)snapshot->ValueAtQuantile(0.99), (unsigned long long)snapshot->max);
+    return note;
+}
+
+static void RegisterTcpSnapshotCases() {
+    for (size_t rows : TABLE_SIZES) {
+        /** A probe of the index: the connection is in the current snapshot. */
+        Bench::Register(WithParameter("tcp_snapshot/lookup", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            fixture->Connect(fixture->steamPid, 1, rows);
+
+            TcpConnectionKey connection = fixture->connections[0];
+            TcpConnectionKey key = { connection.remoteIP, connection.localIP, connection.remotePort, connection.localPort };
+            auto snapshot = fixture->resolver.Tcp().Current();
+            return [fixture, snapshot, key](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint32_t pid = 0;
+                    Bench::DoNotOptimize(snapshot->FindOwningPid(key, pid));
+                }
+            };
+        });
+
+        /** Dumping the table and indexing it, which a lookup pays for whenever it misses the snapshot. */
+        Bench::Register(WithParameter("tcp_snapshot/refresh", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            fixture->Connect(fixture->steamPid, 1, rows);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(fixture->resolver.Tcp().Refresh());
+                }
+            };
+        });
+    }
+
+    /**
+     * A client port reused by another process after steam's connection on it closed. The snapshot taken for steam's connection
+     * still has steam's row for the 4-tuple, the new connection has to be decided on the new owner.
+     */
+    Bench::Register("tcp_snapshot/reused_tuple", []() -> Bench::Loop {
+        auto fixture = std::make_shared<GateFixture>();
+        fixture->Connect(fixture->steamPid, 1, 256);
+        return [fixture](uint64_t iterations) {
+            const TcpConnectionKey connection = fixture->connections[0];
+            for (uint64_t i = 0; i < iterations; i++) {
+                const bool reused = (i & 1) != 0;
+                fixture->os.Reconnect(connection, reused ? fixture->otherPid : fixture->steamPid);
+
+                uint32_t peerPid = 0;
+                const bool trusted = fixture->resolver.IsSteamProcess(connection, peerPid);
+                if (trusted == reused || peerPid != (reused ? fixture->otherPid : fixture->steamPid)) {
+                    Bench::Fail("a reused 4-tuple was resolved to the process that owned it before");
+                    return;
+                }
+            }
+        };
+    });
+}
+
+static void RegisterProcessCases() {
+    /** The steady state: the peer's image is cached under its PID and start time. */
+    Bench::Register("process_image/cached", []() -> Bench::Loop {
+        auto fixture = std::make_shared<GateFixture>();
+        ProcessImage image;
+        fixture->resolver.GetExecutableNameFromPID(fixture->helperPid, image);
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                ProcessImage image;
+                Bench::DoNotOptimize(fixture->resolver.GetExecutableNameFromPID(fixture->helperPid, image));
+            }
+        };
+    });
+
+    /**
+     * PID churn: more distinct peers than the cache holds, cycled through so that every lookup misses,
+     * queries the image, translates its device path and evicts the least recently used entry.
+     */
+    for (size_t peers : { (size_t)16, (size_t)4096 }) {
+        Bench::Register(WithParameter("process_image/pid_churn", "peers", peers), [peers]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            auto pids = std::make_shared<std::vector<uint32_t>>();
+            for (size_t i = 0; i < peers; i++) {
+                pids->push_back(fixture->os.Spawn(i % 4, "\\Games\\client" + std::to_string(i) + ".exe", { 0x1234, 0x10000 + i }));
+            }
+            return [fixture, pids](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    ProcessImage image;
+                    Bench::DoNotOptimize(fixture->resolver.GetExecutableNameFromPID((*pids)[i % pids->size()], image));
+                }
+            };
+        });
+    }
+
+    /**
+     * The cache's contract, checked on every iteration: the least recently used entry is the one evicted, the counters add up,
+     * and a PID that was handed to a new process (a new start time) misses instead of returning the old process's image.
+     */
+    Bench::Register("process_image/cache_semantics", []() -> Bench::Loop {
+        auto fixture = std::make_shared<GateFixture>();
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                ProcessPathCache cache(4);
+                ProcessImage image;
+                for (uint32_t pid = 1; pid <= 4; pid++) {
+                    image.path.Assign("C:\\Games\\client" + std::to_string(pid) + ".exe");
+                    image.identity = { 0x1234, pid };
+                    cache.Insert({ pid, 100 + pid }, image);
+                }
+
+                /** Using pid 1 makes pid 2 the least recently used, so it is the one the fifth process evicts. */
+                bool hit = cache.Lookup({ 1, 101 }, image);
+                image.identity = { 0x1234, 5 };
+                cache.Insert({ 5, 105 }, image);
+                if (!hit || cache.Lookup({ 2, 102 }, image) || !cache.Lookup({ 1, 101 }, image) || !cache.Lookup({ 5, 105 }, image)
+                    || cache.Size() != 4) {
+                    Bench::Fail("the cache didn't evict its least recently used entry");
+                    return;
+                }
+
+                if (cache.Lookup({ 3, 999 }, image) || !cache.Lookup({ 3, 103 }, image) || image.identity.index != 3) {
+                    Bench::Fail("a reused PID hit the entry of the process that had it before");
+                    return;
+                }
+
+                ProcessPathCache::Counters counters = cache.GetCounters();
+                if (counters.hits != 4 || counters.misses != 2 || counters.evictions != 1) {
+                    Bench::Fail("the cache counters are off: " + std::to_string(counters.hits) + " hits, " + std::to_string(counters.misses)
+                        + " misses, " + std::to_string(counters.evictions) + " evictions");
+                    return;
+                }
+            }
+
+            /** The same through the resolver: once steam's helper PID is recycled, its new image is queried, not served from the cache. */
+            uint32_t pid = fixture->os.Spawn(0, "\\Program Files (x86)\\Steam\\steam.exe", STEAM_IDENTITY);
+            ProcessImage image;
+            fixture->resolver.GetExecutableNameFromPID(pid, image);
+            fixture->os.Recycle(pid, "\\Users\\Public\\evil.exe", OTHER_IDENTITY);
+            if (fixture->resolver.GetExecutableNameFromPID(pid, image) != ResolveResult::Ok || image.identity == STEAM_IDENTITY) {
+                Bench::Fail("the resolver returned the cached image of a PID's previous process");
+            }
+        };
+    });
+}
+
+static void RegisterDevicePathCases() {
+    for (size_t volumes : { (size_t)4, (size_t)24, (size_t)64 }) {
+        /** Translating a path on the last volume, the worst case for a linear scan over the prefixes. */
+        Bench::Register(WithParameter("device_path/translate", "volumes", volumes), [volumes]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>(volumes);
+            auto path = std::make_shared<std::string>("\\Device\\HarddiskVolume" + std::to_string(volumes) + "\\Users\\Public\\evil.exe");
+            return [fixture, path](uint64_t iterations) {
+                char out[PROCESS_PATH_CAPACITY];
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(fixture->resolver.Devices().Translate(*path, out, sizeof(out)));
+                }
+            };
+        });
+
+        /** Rebuilding the prefix table after the volume set changed. */
+        Bench::Register(WithParameter("device_path/rebuild", "volumes", volumes), [volumes]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>(volumes);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    fixture->os.TouchVolumes();
+                    Bench::DoNotOptimize(fixture->resolver.Devices().Current());
+                }
+            };
+        });
+    }
+
+    /**
+     * Translations that have to come out right, checked on every iteration: the longest prefix wins and only on a component boundary
+     * ("\Device\HarddiskVolume1" never matches "\Device\HarddiskVolume10\..."), and on Linux nested and bind mounts from mountinfo
+     * resolve to the innermost mount.
+     */
+    Bench::Register("device_path/semantics", []() -> Bench::Loop {
+        std::vector<DevicePrefix> volumes = {
+            { "\\Device\\HarddiskVolume1", "C:" },
+            { "\\Device\\HarddiskVolume10", "D:" },
+            { "\\Device\\HarddiskVolume1", "E:" },
+            { "\\Device\\Mup\\server", "\\\\server" },
+            { "\\Device\\Mup\\server\\games", "G:" }
+        };
+        auto windows = std::make_shared<DevicePathTable>(volumes, 1);
+
+#ifndef _WIN32
+        static const char MOUNTINFO[] =
+            "22 1 8:2 / / rw,relatime shared:1 - ext4 /dev/sda2 rw\n"
+            "23 22 0:21 / /proc rw,nosuid shared:5 - proc proc rw\n"
+            "24 22 8:3 / /home rw,relatime shared:2 - ext4 /dev/sda3 rw\n"
+            "25 24 8:17 / /home/user/Games rw,relatime shared:3 - ext4 /dev/sdb1 rw\n"
+            "26 22 8:17 /steamapps /mnt/steam\\040apps rw,relatime shared:3 - ext4 /dev/sdb1 rw\n"
+            "27 22 0:30 / /tmp rw shared:6 - tmpfs tmpfs rw";
+        std::vector<DevicePrefix> mounts;
+        ParseMountInfo(MOUNTINFO, mounts);
+        auto linux_mounts = std::make_shared<DevicePathTable>(mounts, 1);
+        const size_t mountCount = mounts.size();
+#else
+        std::shared_ptr<DevicePathTable> linux_mounts;
+        const size_t mountCount = 0;
+#endif
+
+        return [windows, linux_mounts, mountCount](uint64_t iterations) {
+            struct Translation {
+                const DevicePathTable* table;
+                const char* path;
+                const char* expected;
+            };
+            std::vector<Translation> translations = {
+                { windows.get(), "\\Device\\HarddiskVolume1\\Windows\\explorer.exe", "C:\\Windows\\explorer.exe" },
+                { windows.get(), "\\Device\\HarddiskVolume10\\Games\\evil.exe", "D:\\Games\\evil.exe" },
+                { windows.get(), "\\Device\\HarddiskVolume1", "C:" },
+                { windows.get(), "\\Device\\HarddiskVolume100\\evil.exe", nullptr },
+                { windows.get(), "\\Device\\HarddiskVolume1evil.exe", nullptr },
+                { windows.get(), "\\Device\\Mup\\server\\games\\steam.exe", "G:\\steam.exe" },
+                { windows.get(), "\\Device\\Mup\\server\\other\\steam.exe", "\\\\server\\other\\steam.exe" }
+            };
+            if (linux_mounts) {
+                translations.push_back({ linux_mounts.get(), "/dev/sda2/usr/bin/steam", "/usr/bin/steam" });
+                translations.push_back({ linux_mounts.get(), "/dev/sda3/user/.steam/steam", "/home/user/.steam/steam" });
+                translations.push_back({ linux_mounts.get(), "/dev/sdb1/Steam/steam.sh", "/home/user/Games/Steam/steam.sh" });
+                translations.push_back({ linux_mounts.get(), "/dev/sdb1/steamapps/common/game", "/mnt/steam apps/common/game" });
+                translations.push_back({ linux_mounts.get(), "/dev/sdb1/steamappsx/game", "/home/user/Games/steamappsx/game" });
+                translations.push_back({ linux_mounts.get(), "/dev/sdc1/game", nullptr });
+            }
+
+            if (linux_mounts && mountCount != 4) {
+                Bench::Fail("mountinfo gave " + std::to_string(mountCount) + " block device mounts instead of 4");
+                return;
+            }
+
+            char out[PROCESS_PATH_CAPACITY];
+            for (uint64_t i = 0; i < iterations; i++) {
+                for (const Translation& translation : translations) {
+                    bool translated = translation.table->Translate(translation.path, out, sizeof(out));
+                    if (translated != (translation.expected != nullptr) || (translated && std::string_view(out) != translation.expected)) {
+                        Bench::Fail(std::string(translation.path) + " was translated to " + (translated ? out : "nothing"));
+                        return;
+                    }
+                }
+
+                /** A buffer that can't hold the translation fails the translation instead of truncating it. */
+                if (windows->Translate("\\Device\\HarddiskVolume1\\Windows", out, 10)) {
+                    Bench::Fail("a translation was truncated to fit its buffer");
+                    return;
+                }
+            }
+        };
+    });
+}
+
+static void RegisterResolverCases() {
+    for (size_t rows : TABLE_SIZES) {
+        /** A connection from the pinned steam.exe, decided by PID alone. */
+        Bench::Register(WithParameter("resolve_verdict/trusted_parent", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            fixture->Connect(fixture->steamPid, 1, rows);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(fixture->resolver.ResolveVerdict(fixture->connections[0]));
+                }
+            };
+        });
+
+        /** A connection from another process started from steam.exe, decided by its cached image identity. */
+        Bench::Register(WithParameter("resolve_verdict/trusted_image", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            fixture->Connect(fixture->helperPid, 1, rows);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(fixture->resolver.ResolveVerdict(fixture->connections[0]));
+                }
+            };
+        });
+    }
+
+    /**
+     * A new connection on every iteration, so every lookup misses the snapshot and pays for a refresh of the whole table.
+     * This is the cost of the first recv of a connection that wasn't seen at accept time.
+     */
+    for (size_t rows : { (size_t)10, (size_t)1000, (size_t)10000 }) {
+        Bench::Register(WithParameter("resolve_verdict/new_connection", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<GateFixture>();
+            fixture->Connect(fixture->helperPid, 1, rows);
+            return [fixture, rows](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    /** Keep the table at its size, the new connection replaces the previous one. */
+                    if (fixture->os.TcpTableSize() > rows + 64) {
+                        fixture->os.ClearTcpTable();
+                        fixture->os.FillTcpTable(rows);
+                    }
+                    TcpConnectionKey connection = fixture->os.Connect(fixture->helperPid, DEBUGGER_PORT);
+                    Bench::DoNotOptimize(fixture->resolver.ResolveVerdict(connection));
+                }
+            };
+        });
+    }
+
+    /** An untrusted process hammering the port: every connection is blocked, and most are dropped by the block budget. */
+    Bench::Register("resolve_verdict/untrusted_flood", []() -> Bench::Loop {
+        auto fixture = std::make_shared<GateFixture>();
+        fixture->Connect(fixture->otherPid, 1, 1000);
+        return [fixture](uint64_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->resolver.ResolveVerdict(fixture->connections[0]));
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            Bench::SetNote(std::to_string((uint64_t)(iterations / seconds)) + " blocks/s");
+        };
+    });
+}
+
+static void RegisterVerdictTableCases() {
+    for (size_t threads : { (size_t)1, (size_t)4, (size_t)8 }) {
+        /** Cached verdict lookups from several threads at once, each thread reading its own set of sockets. */
+        Bench::Register(WithParameter("verdict_table/lookup", "threads", threads), [threads]() -> Bench::Loop {
+            auto table = std::make_shared<SocketVerdictTable>();
+            for (uint64_t s = 0; s < 1024; s++) table->Insert(s * 4, Verdict::Allow);
+
+            return [table, threads](uint64_t iterations) {
+                std::vector<std::thread> workers;
+                uint64_t perThread = iterations / threads + 1;
+                for (size_t t = 0; t < threads; t++) {
+                    workers.emplace_back([table, perThread, t]() {
+                        for (uint64_t i = 0; i < perThread; i++) {
+                            Bench::DoNotOptimize(table->Lookup(((t * 128 + i) % 1024) * 4));
+                        }
+                    });
+                }
+                for (std::thread& worker : workers) worker.join();
+            };
+        });
+    }
+
+    /** A socket's whole life in the table: first seen, decided, closed. */
+    Bench::Register("verdict_table/acquire_publish_evict", []() -> Bench::Loop {
+        auto table = std::make_shared<SocketVerdictTable>();
+        return [table](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                bool created = false;
+                std::shared_ptr<VerdictSlot> slot = table->Acquire(i * 4, created);
+                slot->Publish(Verdict::Allow);
+                table->Evict(i * 4);
+            }
+        };
+    });
+
+    /**
+     * What the gate relies on from the table, checked on every iteration with a new socket: a pending slot is shared by everyone
+     * asking for it, the first published verdict sticks, waiting fails closed, and a handle reused after closesocket starts over.
+     */
+    Bench::Register("verdict_table/semantics", []() -> Bench::Loop {
+        auto table = std::make_shared<SocketVerdictTable>();
+        return [table](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                const uint64_t s = i * 4;
+
+                bool created = false;
+                std::shared_ptr<VerdictSlot> slot = table->Acquire(s, created);
+                bool createdAgain = true;
+                std::shared_ptr<VerdictSlot> again = table->Acquire(s, createdAgain);
+                if (!created || createdAgain || again != slot || table->Lookup(s) != Verdict::Pending) {
+                    Bench::Fail("a new socket didn't get exactly one pending slot");
+                    return;
+                }
+
+                /** Nothing publishes in time: the waiter gets Block, and the slot stays pending for the resolver. */
+                if (slot->Wait(std::chrono::milliseconds(0)) != Verdict::Block || slot->Load() != Verdict::Pending) {
+                    Bench::Fail("waiting on a pending slot didn't time out to Block");
+                    return;
+                }
+
+                Verdict continued = Verdict::Unknown;
+                if (!slot->OnPublished([&continued](Verdict verdict) { continued = verdict; })) {
+                    Bench::Fail("a continuation couldn't be registered on a pending slot");
+                    return;
+                }
+
+                Verdict waited = Verdict::Unknown;
+                std::thread waiter([&slot, &waited]() { waited = slot->Wait(std::chrono::milliseconds(2000)); });
+                slot->Publish(Verdict::Allow);
+                waiter.join();
+                if (waited != Verdict::Allow || continued != Verdict::Allow || table->Lookup(s) != Verdict::Allow) {
+                    Bench::Fail("a published verdict didn't reach the waiter, the continuation and the table");
+                    return;
+                }
+
+                slot->Publish(Verdict::Block);
+                if (table->Insert(s, Verdict::Block) != Verdict::Allow || table->Lookup(s) != Verdict::Allow
+                    || slot->OnPublished([](Verdict) {})) {
+                    Bench::Fail("a second verdict replaced the first one");
+                    return;
+                }
+
+                const size_t size = table->Size();
+                table->Evict(s);
+                if (table->Lookup(s) != Verdict::Unknown || table->Size() != size - 1) {
+                    Bench::Fail("closing a socket didn't evict its verdict");
+                    return;
+                }
+
+                /** The handle is reused by a new connection: it must be resolved again, whatever the old slot says. */
+                std::shared_ptr<VerdictSlot> reused = table->Acquire(s, created);
+                if (!created || reused == slot || reused->Load() != Verdict::Pending || slot->Load() != Verdict::Allow) {
+                    Bench::Fail("a reused handle inherited the verdict of the socket it replaced");
+                    return;
+                }
+                reused->Publish(Verdict::Block);
+                if (table->Lookup(s) != Verdict::Block) {
+                    Bench::Fail("the reused handle didn't get its own verdict");
+                    return;
+                }
+                table->Evict(s);
+            }
+        };
+    });
+}
+
+/**
+ * The decision HookedRecv makes for every successful recv, with the same table, port filter and resolver pool as main.cc.
+ * Sockets are numbered, socket N belongs to connection N of the fixture.
+ */
+struct RecvFixture {
+    GateFixture gate;
+    SocketVerdictTable verdictTable;
+    DebuggerPort debuggerPort;
+    std::unique_ptr<ResolverPool> pool;
+    LatencyHistogram latency{};
+
+    RecvFixture(size_t rows, size_t connections) {
+        gate.Connect(gate.helperPid, connections, rows);
+        debuggerPort.Configure(DEBUGGER_PORT);
+        pool.reset(new ResolverPool(2, [this](uint64_t s) {
+            return gate.resolver.ResolveVerdict(gate.connections[s % gate.connections.size()]);
+        }));
+    }
+
+    Verdict Recv(uint64_t s, uint16_t localPort) {
+        Verdict verdict = verdictTable.Lookup(s);
+        if (verdict == Verdict::Unknown && !debuggerPort.ShouldGate(localPort)) {
+            verdict = verdictTable.Insert(s, Verdict::Allow);
+        }
+
+        if (verdict == Verdict::Unknown || verdict == Verdict::Pending) {
+            bool created = false;
+            std::shared_ptr<VerdictSlot> slot = verdictTable.Acquire(s, created);
+            if (created) pool->Submit(s, slot);
+            verdict = slot->Wait(std::chrono::milliseconds(2000));
+        }
+        return verdict;
+    }
+};
+
+static void RegisterRecvCases() {
+    /** Every recv after the first: a single table lookup. */
+    Bench::Register("recv/cached_verdict", []() -> Bench::Loop {
+        auto fixture = std::make_shared<RecvFixture>(1000, 1);
+        fixture->Recv(0, DEBUGGER_PORT);
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->Recv(0, DEBUGGER_PORT));
+            }
+        };
+    });
+
+    /** The first recv of a socket that isn't on the debugger port: one port compare and the insert of its Allow verdict. */
+    Bench::Register("recv/first_recv/non_debugger", []() -> Bench::Loop {
+        auto fixture = std::make_shared<RecvFixture>(1000, 1);
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->Recv(i * 4, 443));
+                fixture->verdictTable.Evict(i * 4);
+            }
+        };
+    });
+
+    /**
+     * The steady state of the gate must not allocate: deciding a connection from steam, from another trusted process and from
+     * an untrusted one (each with its refresh of the TCP table), and every recv after the first. Only the first recv of a socket
+     * allocates, for its slot in the verdict table.
+     */
+    Bench::Register("allocations/resolve_and_recv", []() -> Bench::Loop {
+        auto fixture = std::make_shared<RecvFixture>(1000, 1);
+        fixture->gate.Connect(fixture->gate.steamPid, 1, 0);
+        fixture->gate.Connect(fixture->gate.otherPid, 1, 0);
+
+        /** The first decision for each peer fills the process image cache and the block budget. */
+        for (const TcpConnectionKey& connection : fixture->gate.connections) fixture->gate.resolver.ResolveVerdict(connection);
+        fixture->Recv(0, DEBUGGER_PORT);
+
+        return [fixture](uint64_t iterations) {
+            const std::vector<TcpConnectionKey>& connections = fixture->gate.connections;
+            const uint64_t before = Bench::AllocationCount();
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->gate.resolver.ResolveVerdict(connections[i % connections.size()]));
+                Bench::DoNotOptimize(fixture->Recv(0, DEBUGGER_PORT));
+            }
+            const uint64_t allocations = Bench::AllocationCount() - before;
+            if (allocations > 0) {
+                Bench::Fail(std::to_string(allocations) + " allocations in " + std::to_string(iterations) + " decisions and recvs");
+            }
+        };
+    });
+
+    /**
+     * The first recv of a debugger socket, resolved on the pool while recv waits, which is the worst case for the recv thread
+     * (nothing was prefetched at accept). The added recv latency is reported as percentiles.
+     */
+    for (size_t rows : { (size_t)1000, (size_t)100000 }) {
+        Bench::Register(WithParameter("recv/first_recv/debugger", "rows", rows), [rows]() -> Bench::Loop {
+            auto fixture = std::make_shared<RecvFixture>(rows, 4096);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    auto start = std::chrono::steady_clock::now();
+                    Bench::DoNotOptimize(fixture->Recv(i, DEBUGGER_PORT));
+                    fixture->latency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+                    fixture->verdictTable.Evict(i);
+                }
+                Bench::SetNote(LatencyNote(fixture->latency));
+            };
+        });
+    }
+}
+
+static void RegisterInstrumentationCases() {
+    Bench::Register("rate_limiter/consume/peers:64", []() -> Bench::Loop {
+        auto limiter = std::make_shared<PeerRateLimiter>(8, 2);
+        return [limiter](uint64_t iterations) {
+            auto now = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(limiter->Consume((uint32_t)(i % 64) * 4, now));
+            }
+        };
+    });
+
+    Bench::Register("decision_ring/push_pop", []() -> Bench::Loop {
+        auto ring = std::make_shared<DecisionRing>(4096);
+        return [ring](uint64_t iterations) {
+            DecisionRecord record = {};
+            for (uint64_t i = 0; i < iterations; i++) {
+                record.socket = i;
+                ring->TryPush(record);
+                Bench::DoNotOptimize(ring->TryPop(record));
+            }
+        };
+    });
+
+    Bench::Register("latency_histogram/record", []() -> Bench::Loop {
+        auto histogram = std::make_shared<LatencyHistogram>();
+        return [histogram](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                histogram->Record(i & 0xFFFFF);
+            }
+        };
+    });
+}
+
+/** A request as Chromium sends it for a page resource, about 500 bytes with the headers. */
+static const std::string BROWSER_REQUEST =
+    "GET /favicon.ico HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"126\", \"Not.A/Brand\";v=\"24\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Windows\"\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Referer: http://127.0.0.1:8080/\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+/**
+ * The classification HttpRequestScanner has to come to, written over the whole input at once instead of incrementally.
+ * Bytes after the end of the input are unknown, so a request cut short is classified by what it has so far.
+ * The fuzzer only sends text, which after an upgrade request is never a valid WebSocket frame: two bytes of it are denied.
+ */
+static HttpScan ReferenceScan(const std::string& input) {
+    auto isGatedTarget = [](std::string target) {
+        for (char& c : target) c = (char)tolower((unsigned char)c);
+        if (target.empty() || target[0] != '/') return true;
+        return target.compare(0, 5, "/json") == 0 || target == "/devtools";
+    };
+
+    bool gated = false;
+    const HttpScan pass = HttpScan::Pass;
+    auto partial = [&gated, pass]() { return gated ? HttpScan::Gate : pass; };
+
+    size_t position = 0;
+    const size_t end = input.size();
+    for (;;) {
+        while (position < end && (input[position] == '\r' || input[position] == '\n')) position++;
+        size_t delimiter = input.find_first_of(" \r\n", position);
+        if (delimiter == std::string::npos) return partial();
+        if (input[delimiter] != ' ' || delimiter == position) return HttpScan::Deny;
+
+        position = delimiter + 1;
+        delimiter = input.find_first_of(" \r\n", position);
+        size_t targetEnd = delimiter == std::string::npos ? end : delimiter;
+        if (targetEnd - position >= 9) {
+            if (isGatedTarget(input.substr(position, 9))) gated = true;
+            if (delimiter == std::string::npos) return partial();
+            if (input[delimiter] != ' ') return HttpScan::Deny;
+        } else {
+            if (delimiter == std::string::npos) return partial();
+            if (input[delimiter] != ' ') return HttpScan::Deny;
+            if (isGatedTarget(input.substr(position, targetEnd - position))) gated = true;
+        }
+
+        position = input.find('\n', delimiter + 1);
+        if (position == std::string::npos) return partial();
+        position++;
+
+        bool upgrade = false;
+        for (;;) {
+            if (position == end) return partial();
+            if (input[position] == '\n') {
+                position++;
+                break;
+            }
+            if (input[position] == '\r') {
+                if (position + 1 == end) return partial();
+                if (input[position + 1] != '\n') return HttpScan::Deny;
+                position += 2;
+                break;
+            }
+
+            size_t colon = input.find_first_of(":\r\n", position);
+            if (colon == std::string::npos) return partial();
+            if (input[colon] != ':') return HttpScan::Deny;
+
+            std::string name;
+            for (size_t i = position; i < colon; i++) {
+                char c = input[i];
+                if (c != ' ' && c != '\t') name += (char)tolower((unsigned char)c);
+            }
+            if (name == "content-length" || name == "transfer-encoding") return HttpScan::Deny;
+            if (name == "upgrade") gated = upgrade = true;
+
+            position = input.find('\n', colon + 1);
+            if (position == std::string::npos) return partial();
+            position++;
+        }
+
+        if (upgrade) return end - position >= 2 ? HttpScan::Deny : HttpScan::Gate;
+    }
+}
+
+/**
+ * Random request streams: one to three pipelined requests built from targets and headers around the ones that matter,
+ * with line endings, case and whitespace varied, and sometimes a few bytes replaced with delimiters.
+ */
+struct RequestFuzzer {
+    std::mt19937 random{ 0x5EED };
+
+    const char* Pick(std::initializer_list<const char*> choices) {
+        return choices.begin()[random() % choices.size()];
+    }
+
+    std::string RandomCase(std::string text) {
+        for (char& c : text) {
+            if (random() % 4 == 0) c = (char)toupper((unsigned char)c);
+        }
+        return text;
+    }
+
+    std::string Next() {
+        std::string input;
+        size_t requests = 1 + random() % 3;
+        for (size_t r = 0; r < requests; r++) {
+            const char* newline = random() % 8 == 0 ? "\n" : "\r\n";
+            input += Pick({ "GET", "POST", "PUT", "OPTIONS", "G" });
+            input += " ";
+            input += RandomCase(Pick({ "/", "/index.html", "/json", "/json/version", "/jso", "/js", "/devtools/page/1", "/devtools",
+                "/devtool", "/devtoolsx", "//json", "/favicon.ico", "http://127.0.0.1/json", "*", "/a/very/long/path/to/a/resource.png" }));
+            input += random() % 16 == 0 ? "" : Pick({ " HTTP/1.1", " HTTP/1.0" });
+            input += newline;
+
+            size_t headers = random() % 6;
+            for (size_t h = 0; h < headers; h++) {
+                if (random() % 8 == 0) input += RandomCase(Pick({ "Upgrade", "Upgrade ", "Content-Length", "Transfer-Encoding" }));
+                else input += RandomCase(Pick({ "Host", "Connection", "Accept", "X-Upgrade", "User-Agent", "Sec-WebSocket-Key",
+                    "A-Header-Name-Longer-Than-Any-We-Match" }));
+                input += Pick({ ": ", ":", " : " });
+                input += Pick({ "websocket", "127.0.0.1:8080", "0", "Upgrade", "keep-alive", "" });
+                input += newline;
+            }
+            if (random() % 8 != 0) input += newline;
+        }
+
+        size_t mutations = random() % 4 == 0 ? 1 + random() % 3 : 0;
+        for (size_t m = 0; m < mutations && !input.empty(); m++) {
+            input[random() % input.size()] = Pick({ " ", "\r", "\n", ":", "/", "\t", "j", "x" })[0];
+        }
+        return input;
+    }
+};
+
+static std::string Printable(const std::string& input) {
+    std::string printable;
+    for (char c : input) {
+        if (c == '\r') printable += "\\r";
+        else if (c == '\n') printable += "\\n";
+        else if (c == '\t') printable += "\\t";
+        else printable += c;
+    }
+    return printable;
+}
+
+static std::string ThroughputNote(size_t bytes, std::chrono::steady_clock::duration elapsed) {
+    char note[64];
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    snprintf(note, sizeof(note), "%.0f MB/s", seconds > 0 ? (double)bytes / seconds / 1e6 : 0.0);
+    return note;
+}
+
+/**
+ * Throughput of the request scanner, whole and split into single bytes (the worst case for the incremental state),
+ * and fuzz cases that check it while they run: splitting a stream anywhere must not change how it is classified,
+ * and the classification must agree with ReferenceScan. A disagreement fails the run.
+ */
+static void RegisterHttpScanCases() {
+    Bench::Register("http_scan/request/browser", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                HttpRequestScanner scanner;
+                Bench::DoNotOptimize(scanner.Feed(BROWSER_REQUEST.data(), BROWSER_REQUEST.size()));
+            }
+            Bench::SetNote(ThroughputNote(BROWSER_REQUEST.size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    Bench::Register("http_scan/request/browser/split:1", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                HttpRequestScanner scanner;
+                for (char c : BROWSER_REQUEST) Bench::DoNotOptimize(scanner.Feed(&c, 1));
+            }
+            Bench::SetNote(ThroughputNote(BROWSER_REQUEST.size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    Bench::Register("http_scan/pipelined/requests:16", []() -> Bench::Loop {
+        auto stream = std::make_shared<std::string>();
+        for (size_t i = 0; i < 16; i++) *stream += BROWSER_REQUEST;
+        return [stream](uint64_t iterations) {
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                HttpRequestScanner scanner;
+                Bench::DoNotOptimize(scanner.Feed(stream->data(), stream->size()));
+            }
+            Bench::SetNote(ThroughputNote(stream->size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    /** What a read on the DevTools port pays before the verdict lookup: the table's lock and hash on top of the scan. */
+    Bench::Register("http_scan/table/sockets:256", []() -> Bench::Loop {
+        auto table = std::make_shared<HttpScanTable>();
+        return [table](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(table->Feed(i % 256, BROWSER_REQUEST.data(), BROWSER_REQUEST.size()));
+            }
+        };
+    });
+
+    for (size_t threads : { (size_t)1, (size_t)4, (size_t)8 }) {
+        /** Gated reads from several threads at once, each thread reading its own set of sockets, which shouldn't wait on each other. */
+        Bench::Register(WithParameter("http_scan/table/sockets:256", "threads", threads), [threads]() -> Bench::Loop {
+            auto table = std::make_shared<HttpScanTable>();
+            return [table, threads](uint64_t iterations) {
+                std::vector<std::thread> workers;
+                uint64_t perThread = iterations / threads + 1;
+                for (size_t t = 0; t < threads; t++) {
+                    workers.emplace_back([table, perThread, t]() {
+                        for (uint64_t i = 0; i < perThread; i++) {
+                            Bench::DoNotOptimize(table->Feed((t * 32 + i % 32) * 4, BROWSER_REQUEST.data(), BROWSER_REQUEST.size()));
+                        }
+                    });
+                }
+                for (std::thread& worker : workers) worker.join();
+            };
+        });
+    }
+
+    Bench::Register("http_scan/fuzz/split", []() -> Bench::Loop {
+        auto fuzzer = std::make_shared<RequestFuzzer>();
+        return [fuzzer](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::string input = fuzzer->Next();
+
+                HttpRequestScanner whole;
+                HttpScan expected = whole.Feed(input.data(), input.size());
+
+                HttpRequestScanner split;
+                HttpScan actual = HttpScan::Pass;
+                for (size_t position = 0; position < input.size();) {
+                    size_t length = std::min<size_t>(input.size() - position, 1 + fuzzer->random() % 24);
+                    actual = split.Feed(input.data() + position, length);
+                    position += length;
+                }
+
+                if (actual != expected) Bench::Fail("split classification differs for \"" + Printable(input) + "\"");
+            }
+        };
+    });
+
+    Bench::Register("http_scan/fuzz/reference", []() -> Bench::Loop {
+        auto fuzzer = std::make_shared<RequestFuzzer>();
+        return [fuzzer](uint64_t iterations) {
+            uint64_t gated = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::string input = fuzzer->Next();
+
+                HttpRequestScanner scanner;
+                HttpScan actual = scanner.Feed(input.data(), input.size());
+                if (actual == HttpScan::Gate) gated++;
+
+                if (actual != ReferenceScan(input)) Bench::Fail("classification differs from the reference for \"" + Printable(input) + "\"");
+            }
+            Bench::SetNote(std::to_string(gated * 100 / iterations) + "% gated");
+        };
+    });
+}
+
+/** The WebSocket upgrade a DevTools client sends before its first frame. */
+static const std::string UPGRADE_REQUEST =
+    "GET /devtools/page/B5D1C5E3 HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8080\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+    "Sec-WebSocket-Version: 13\r\n"
+    "\r\n";
+
+/** A CDP call of the size most of a client's traffic is. */
+static const std::string SMALL_MESSAGE = "{\"id\":42,\"method\":\"DOM.getDocument\",\"params\":{\"depth\":-1,\"pierce\":true}}";
+
+/**
+ * Append a masked client frame.
+ *
+ * @param out Receives the frame.
+ * @param opcode The opcode.
+ * @param payload The payload, unmasked.
+ * @param final Whether this is the last frame of its message.
+ * @param mask The masking key.
+ */
+static void AppendFrame(std::string& out, WebSocketFrameParser::Opcode opcode, const std::string& payload, bool final, uint32_t mask) {
+    out += (char)((final ? 0x80 : 0x00) | (uint8_t)opcode);
+    if (payload.size() < 126) {
+        out += (char)(0x80 | payload.size());
+    } else if (payload.size() <= 0xFFFF) {
+        out += (char)(0x80 | 126);
+        out += (char)(payload.size() >> 8);
+        out += (char)payload.size();
+    } else {
+        out += (char)(0x80 | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) out += (char)((uint64_t)payload.size() >> shift);
+    }
+
+    uint8_t key[4] = { (uint8_t)mask, (uint8_t)(mask >> 8), (uint8_t)(mask >> 16), (uint8_t)(mask >> 24) };
+    out.append((const char*)key, sizeof(key));
+    for (size_t i = 0; i < payload.size(); i++) out += (char)(payload[i] ^ key[i & 3]);
+}
+
+/** Counts the bytes handed over, standing in for what CdpFilter does with them. */
+struct CountingSink : WebSocketFrameParser::Sink {
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+
+    void OnMessageStart(WebSocketFrameParser::Opcode) override {}
+    void OnMessageData(const char*, size_t length) override { bytes += length; }
+    void OnMessageEnd() override { messages++; }
+};
+
+/**
+ * Random DevTools sessions for the restricted mode: an upgrade request followed by messages that are fragmented over frames
+ * with random masks and interleaved with pings. Every message comes from a template whose outcome is known,
+ * including methods hidden where they don't count (nested, inside strings) and ones disguised where they do (escaped, duplicated).
+ */
+struct SessionFuzzer {
+    std::mt19937 random{ 0xCDB };
+
+    struct Session {
+        std::string stream;
+        /** Where the first message that has to be denied starts and ends in the stream, npos if every message is allowed. */
+        size_t deniedStart = std::string::npos;
+        size_t deniedEnd = std::string::npos;
+    };
+
+    std::string Method(bool& denied) {
+        static const char* DENIED_METHODS[] = { "Runtime.evaluate", "Runtime.callFunctionOn", "Input.dispatchKeyEvent", "Fetch.enable",
+            "Target.attachToTarget", "Network.getAllCookies", "Page.reload", "Debugger.setBreakpointByUrl", "DOM.setAttributeValue",
+            "Runtime.getProperties", "runtime.enable", "Runtime.enableSomething", "Network.enable" };
+        static const char* ALLOWED_METHODS[] = { "Runtime.enable", "DOM.getDocument", "DOM.querySelectorAll", "CSS.getComputedStyleForNode",
+            "Page.getFrameTree", "Log.enable", "Overlay.highlightNode", "Performance.getMetrics" };
+
+        denied = random() % 4 == 0;
+        if (denied) return DENIED_METHODS[random() % (sizeof(DENIED_METHODS) / sizeof(DENIED_METHODS[0]))];
+        return ALLOWED_METHODS[random() % (sizeof(ALLOWED_METHODS) / sizeof(ALLOWED_METHODS[0]))];
+    }
+
+    std::string Message(bool& denied) {
+        std::string method = Method(denied);
+        std::string id = std::to_string(random() % 100000);
+
+        switch (random() % 7) {
+            case 0: return "{\"id\":" + id + ",\"method\":\"" + method + "\",\"params\":{}}";
+            case 1: return "{\"params\":{\"method\":\"Runtime.evaluate\"},\"method\":\"" + method + "\",\"id\":" + id + "}";
+            case 2: return "{ \"id\" : " + id + " , \"method\" : \"" + method + "\" , \"sessionId\" : \"A1B2\" }\n";
+            case 3: return "{\"id\":" + id + ",\"params\":{\"expression\":\"\\\"method\\\":\\\"Runtime.evaluate\\\"\",\"list\":[1,{\"a\":[]}]},\"method\":\"" + method + "\"}";
+            case 4:
+                denied = true;
+                return "{\"id\":" + id + ",\"method\":\"Runtime.evalu\\u0061te\"}";
+            case 5:
+                denied = true;
+                return "{\"id\":" + id + ",\"method\":\"" + method + "\",\"method\":\"Runtime.evaluate\"}";
+            default: {
+                std::string padding(random() % 70000, 'x');
+                return "{\"id\":" + id + ",\"method\":\"" + method + "\",\"params\":{\"data\":\"" + padding + "\"}}";
+            }
+        }
+    }
+
+    Session Next() {
+        Session session;
+        session.stream = UPGRADE_REQUEST;
+
+        size_t messages = 1 + random() % 4;
+        for (size_t m = 0; m < messages; m++) {
+            bool denied = false;
+            std::string message = Message(denied);
+            size_t start = session.stream.size();
+
+            size_t fragments = 1 + random() % 3;
+            size_t offset = 0;
+            for (size_t f = 0; f < fragments; f++) {
+                size_t length = f + 1 == fragments ? message.size() - offset : std::min(message.size() - offset, (size_t)(random() % 64));
+                AppendFrame(session.stream, f == 0 ? WebSocketFrameParser::Opcode::Text : WebSocketFrameParser::Opcode::Continuation,
+                    message.substr(offset, length), f + 1 == fragments, (uint32_t)random());
+                offset += length;
+
+                if (random() % 4 == 0) AppendFrame(session.stream, WebSocketFrameParser::Opcode::Ping, "ping", true, (uint32_t)random());
+            }
+
+            if (denied && session.deniedStart == std::string::npos) {
+                session.deniedStart = start;
+                session.deniedEnd = session.stream.size();
+            }
+        }
+        return session;
+    }
+};
+
+/**
+ * The restricted mode's per-frame cost: unmasking, the deny list lookup, and whole frames through CdpFilter, small and large.
+ * The fuzz case feeds random sessions in random pieces and fails the run unless every session with a denied message is denied
+ * by the read that completes that message, and not before it started.
+ */
+static void RegisterWebSocketCases() {
+    Bench::Register("websocket/unmask/bytes:65536", []() -> Bench::Loop {
+        auto buffer = std::make_shared<std::vector<char>>(65536, 'x');
+        return [buffer](uint64_t iterations) {
+            const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                UnmaskPayload(buffer->data(), buffer->data(), buffer->size(), mask, i);
+            }
+            Bench::SetNote(ThroughputNote(buffer->size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    Bench::Register("websocket/frames/bytes:65536", []() -> Bench::Loop {
+        auto stream = std::make_shared<std::string>();
+        AppendFrame(*stream, WebSocketFrameParser::Opcode::Binary, std::string(65536, 'x'), true, 0x9ABCDEF0);
+        return [stream](uint64_t iterations) {
+            WebSocketFrameParser parser;
+            CountingSink sink;
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(parser.Feed(stream->data(), stream->size(), sink));
+            }
+            Bench::SetNote(ThroughputNote(stream->size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    Bench::Register("cdp/method/is_denied", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            static const std::string_view METHODS[] = { "Runtime.evaluate", "DOM.getDocument", "Input.dispatchMouseEvent", "Page.reload" };
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(CdpMethods::IsDenied(METHODS[i & 3]));
+            }
+        };
+    });
+
+    Bench::Register("cdp/frame/small", []() -> Bench::Loop {
+        auto frame = std::make_shared<std::string>();
+        AppendFrame(*frame, WebSocketFrameParser::Opcode::Text, SMALL_MESSAGE, true, 0x9ABCDEF0);
+        return [frame](uint64_t iterations) {
+            CdpFilter filter;
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(filter.Feed(frame->data(), frame->size()));
+            }
+        };
+    });
+
+    Bench::Register("cdp/frame/small/split:1", []() -> Bench::Loop {
+        auto frame = std::make_shared<std::string>();
+        AppendFrame(*frame, WebSocketFrameParser::Opcode::Text, SMALL_MESSAGE, true, 0x9ABCDEF0);
+        return [frame](uint64_t iterations) {
+            CdpFilter filter;
+            for (uint64_t i = 0; i < iterations; i++) {
+                for (char c : *frame) Bench::DoNotOptimize(filter.Feed(&c, 1));
+            }
+        };
+    });
+
+    Bench::Register("cdp/frame/params:65536", []() -> Bench::Loop {
+        auto frame = std::make_shared<std::string>();
+        AppendFrame(*frame, WebSocketFrameParser::Opcode::Text,
+            "{\"id\":7,\"method\":\"DOM.querySelectorAll\",\"params\":{\"selector\":\"" + std::string(65536, 'x') + "\",\"nodeId\":3}}", true, 0x9ABCDEF0);
+        return [frame](uint64_t iterations) {
+            CdpFilter filter;
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(filter.Feed(frame->data(), frame->size()));
+            }
+            Bench::SetNote(ThroughputNote(frame->size() * iterations, std::chrono::steady_clock::now() - start));
+        };
+    });
+
+    Bench::Register("cdp/fuzz/sessions", []() -> Bench::Loop {
+        auto fuzzer = std::make_shared<SessionFuzzer>();
+        return [fuzzer](uint64_t iterations) {
+            uint64_t denied = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                SessionFuzzer::Session session = fuzzer->Next();
+
+                HttpRequestScanner scanner;
+                HttpScan scan = HttpScan::Pass;
+                for (size_t position = 0; position < session.stream.size();) {
+                    size_t length = std::min<size_t>(session.stream.size() - position, 1 + fuzzer->random() % 4096);
+                    scan = scanner.Feed(session.stream.data() + position, length);
+                    position += length;
+
+                    if (position <= session.deniedStart && scan == HttpScan::Deny) {
+                        Bench::Fail("an allowed message was denied");
+                    }
+                    if (position >= UPGRADE_REQUEST.size() && scan == HttpScan::Pass) {
+                        Bench::Fail("the upgrade wasn't gated");
+                    }
+                    if (position >= session.deniedEnd && scan != HttpScan::Deny) {
+                        Bench::Fail("a denied message went through");
+                    }
+                }
+                if (scan == HttpScan::Deny) denied++;
+            }
+            Bench::SetNote(std::to_string(denied * 100 / iterations) + "% denied");
+        };
+    });
+}
+
+static std::string Hex(const Sha256Digest& digest) {
+    static const char DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    for (uint8_t byte : digest.bytes) {
+        hex += DIGITS[byte >> 4];
+        hex += DIGITS[byte & 15];
+    }
+    return hex;
+}
+
+/**
+ * SHA-256 throughput of both kernels. The vectors case checks the FIPS 180-4 examples, then random messages fed in random pieces
+ * through the best kernel against the portable one, and fails the run on any difference.
+ */
+static void RegisterSha256Cases() {
+    for (Sha256::Kernel kernel : { Sha256::Kernel::Portable, Sha256::Kernel::Best }) {
+        std::string name = kernel == Sha256::Kernel::Portable ? "sha256/kernel:portable/bytes:1048576" : "sha256/kernel:best/bytes:1048576";
+        Bench::Register(name, [kernel]() -> Bench::Loop {
+            auto buffer = std::make_shared<std::vector<char>>(1048576, 'x');
+            return [buffer, kernel](uint64_t iterations) {
+                auto start = std::chrono::steady_clock::now();
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Sha256 hasher(kernel);
+                    hasher.Update(buffer->data(), buffer->size());
+                    Bench::DoNotOptimize(hasher.Final());
+                }
+                std::string note = ThroughputNote(buffer->size() * iterations, std::chrono::steady_clock::now() - start);
+                if (kernel == Sha256::Kernel::Best) note += Sha256::Accelerated() ? ", sha extensions" : ", portable";
+                Bench::SetNote(note);
+            };
+        });
+    }
+
+    Bench::Register("sha256/vectors", []() -> Bench::Loop {
+        auto random = std::make_shared<std::mt19937>(0x5A256);
+        return [random](uint64_t iterations) {
+            static const struct {
+                std::string message;
+                const char* digest;
+            } VECTORS[] = {
+                { "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+                { "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+                { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+                { std::string(1000000, 'a'), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0" },
+            };
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                const auto& vector = VECTORS[i % 4];
+                if (Hex(Sha256::Hash(vector.message.data(), vector.message.size())) != vector.digest) Bench::Fail("wrong digest of a FIPS 180-4 example");
+
+                std::string message((*random)() % 1000, '\0');
+                for (char& c : message) c = (char)(*random)();
+
+                Sha256 best;
+                for (size_t position = 0; position < message.size();) {
+                    size_t length = std::min<size_t>(message.size() - position, (*random)() % 130);
+                    best.Update(message.data() + position, length);
+                    position += length;
+                }
+                Sha256 portable(Sha256::Kernel::Portable);
+                portable.Update(message.data(), message.size());
+                if (best.Final() != portable.Final()) Bench::Fail("the kernels disagree on a " + std::to_string(message.size()) + " byte message");
+            }
+        };
+    });
+}
+
+/** The command line steam.exe starts the gated steamwebhelper with, trimmed of a few switches. */
+static const std::string STEAMWEBHELPER_COMMAND_LINE =
+    "\"C:\\Program Files (x86)\\Steam\\bin\\cef\\cef.win7x64\\steamwebhelper.exe\" -lang=english "
+    "-cachedir=\"C:\\Users\\user\\AppData\\Local\\Steam\\htmlcache\" -steampid=4120 -buildid=1716242052 -steamid=0 "
+    "-logdir=\"C:\\Program Files (x86)\\Steam\\logs\" -uimode=7 -startcount=0 -steamuniverse=Public -realm=Global "
+    "-clientui=\"C:\\Program Files (x86)\\Steam\\clientui\" -steampath=\"C:\\Program Files (x86)\\Steam\\steam.exe\" -launcher=0 "
+    "-no-restart-on-ui-mode-change --valve-enable-site-isolation --enable-smooth-scrolling --password-store=basic "
+    "--log-file=\"C:\\Program Files (x86)\\Steam\\logs\\cef_log.txt\" --disable-quick-menu --remote-debugging-port=8080";
+
+static std::string GetSwitch(const CommandLine& commandLine, std::string_view name) {
+    std::string_view value;
+    return commandLine.Get(name, value) ? std::string(value) : std::string("<missing>");
+}
+
+/**
+ * Parsing a command line and looking up the switches the gate reads from it. The semantics case checks the rules of both parsers,
+ * and the fuzz cases parse random arguments joined the way each platform joins them, failing the run if any argument comes back different.
+ */
+static void RegisterCommandLineCases() {
+    Bench::Register("command_line/parse/windows", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                CommandLine commandLine = CommandLine::FromWindows(STEAMWEBHELPER_COMMAND_LINE);
+                Bench::DoNotOptimize(commandLine.Size());
+            }
+        };
+    });
+
+    Bench::Register("command_line/lookup", []() -> Bench::Loop {
+        auto commandLine = std::make_shared<CommandLine>(CommandLine::FromWindows(STEAMWEBHELPER_COMMAND_LINE));
+        return [commandLine](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::string_view steamPath;
+                uint16_t port = 0;
+                bool found = commandLine->Get("-steampath", steamPath) && ParseRemoteDebuggingPort(*commandLine, port);
+                if (!found || commandLine->Has("-dev")) Bench::Fail("wrong switches in the steamwebhelper command line");
+                Bench::DoNotOptimize(port);
+            }
+        };
+    });
+
+    Bench::Register("command_line/semantics", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            auto expect = [](bool condition, const char* what) {
+                if (!condition) Bench::Fail(what);
+            };
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                CommandLine steam = CommandLine::FromWindows(STEAMWEBHELPER_COMMAND_LINE);
+                uint16_t port = 0;
+                expect(steam[0] == "C:\\Program Files (x86)\\Steam\\bin\\cef\\cef.win7x64\\steamwebhelper.exe", "the quotes weren't dropped from the program");
+                expect(GetSwitch(steam, "-steampath") == "C:\\Program Files (x86)\\Steam\\steam.exe", "wrong quoted -steampath");
+                expect(ParseRemoteDebuggingPort(steam, port) && port == 8080, "wrong --remote-debugging-port");
+                expect(steam.Has("--disable-quick-menu") && !steam.Has("-dev"), "wrong flags");
+
+                CommandLine unquoted = CommandLine::FromWindows("x.exe -steampath=C:\\Program Files (x86)\\Steam\\steam.exe -launcher=0");
+                expect(GetSwitch(unquoted, "-steampath") == "C:\\Program Files (x86)\\Steam\\steam.exe", "an unquoted path with spaces was cut");
+                expect(GetSwitch(unquoted, "-launcher") == "0", "the switch after an unquoted path was lost");
+
+                CommandLine trailing = CommandLine::FromWindows("x.exe -steampath=C:\\Steam Games\\steam.exe positional");
+                expect(GetSwitch(trailing, "-steampath") == "C:\\Steam Games\\steam.exe", "an unquoted path didn't end at .exe");
+                expect(trailing.Size() == 3 && trailing[2] == "positional", "the argument after .exe was lost");
+
+                CommandLine nested = CommandLine::FromWindows("x.exe -cachedir=\"C:\\a -steampath=C:\\evil\\steam.exe\" -dev");
+                expect(!nested.Has("-steampath"), "a switch inside another argument was found");
+                expect(nested.Has("-dev") && !CommandLine::FromWindows("x.exe -devtools").Has("-dev"), "-dev isn't matched as a whole argument");
+
+                CommandLine repeated = CommandLine::FromWindows("x.exe -steampath=a.exe -steampath=b.exe --remote-debugging-port=\"0\"");
+                expect(GetSwitch(repeated, "-steampath") == "a.exe", "a repeated switch didn't keep its first value");
+                expect(ParseRemoteDebuggingPort(repeated, port) && port == 0, "a quoted port 0 wasn't accepted");
+                expect(!ParseRemoteDebuggingPort(CommandLine::FromWindows("x.exe --remote-debugging-port=80x"), port), "an invalid port was accepted");
+                expect(!ParseRemoteDebuggingPort(CommandLine::FromWindows("x.exe --remote-debugging-port=65536"), port), "an out of range port was accepted");
+
+                static const char SEPARATED[] = "steamwebhelper\0-steampath=/home/u/.steam/steam.sh\0\0-dev\0-q=\"x y\"\0";
+                CommandLine separated = CommandLine::FromNullSeparated(std::string(SEPARATED, sizeof(SEPARATED) - 1));
+                expect(separated.Size() == 5 && separated[2].empty(), "wrong null separated arguments");
+                expect(GetSwitch(separated, "-steampath") == "/home/u/.steam/steam.sh" && separated.Has("-dev"), "wrong null separated switches");
+                expect(GetSwitch(separated, "-q") == "\"x y\"", "quotes were dropped from a null separated argument");
+                expect(CommandLine::FromNullSeparated("a\0b").Size() == 1 && CommandLine::FromNullSeparated(std::string("a\0b", 3)).Size() == 2, "a missing last NUL wasn't tolerated");
+            }
+        };
+    });
+
+    Bench::Register("command_line/fuzz/null_separated", []() -> Bench::Loop {
+        auto random = std::make_shared<std::mt19937>(0xC0DE);
+        return [random](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<std::string> arguments((*random)() % 12 + 1);
+                std::string text;
+                for (std::string& argument : arguments) {
+                    argument.resize((*random)() % 24);
+                    for (char& c : argument) c = (char)((*random)() % 255 + 1);
+                    text += argument;
+                    text += '\0';
+                }
+
+                CommandLine commandLine = CommandLine::FromNullSeparated(text);
+                if (commandLine.Size() != arguments.size()) Bench::Fail("wrong number of null separated arguments");
+                for (size_t a = 0; a < arguments.size() && a < commandLine.Size(); a++) {
+                    if (commandLine[a] != arguments[a]) Bench::Fail("a null separated argument came back different");
+                }
+            }
+        };
+    });
+
+    Bench::Register("command_line/fuzz/windows", []() -> Bench::Loop {
+        auto random = std::make_shared<std::mt19937>(0xC0DF);
+        return [random](uint64_t iterations) {
+            static const char QUOTED[] = "abcXYZ019 -=\\/:.()";
+            static const char UNQUOTED[] = "abcXYZ019-=\\/:.()";
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::vector<std::string> values((*random)() % 12);
+                std::string line = "\"C:\\Program Files\\x.exe\"";
+                for (size_t v = 0; v < values.size(); v++) {
+                    bool quoted = (*random)() % 2 == 0;
+                    values[v].resize((*random)() % 24);
+                    for (char& c : values[v]) c = quoted ? QUOTED[(*random)() % (sizeof(QUOTED) - 1)] : UNQUOTED[(*random)() % (sizeof(UNQUOTED) - 1)];
+
+                    line += std::string((*random)() % 3 + 1, ' ') + "-s" + std::to_string(v) + "=";
+                    line += quoted ? "\"" + values[v] + "\"" : values[v];
+                }
+
+                CommandLine commandLine = CommandLine::FromWindows(line);
+                if (commandLine.Size() != values.size() + 1 || commandLine[0] != "C:\\Program Files\\x.exe") Bench::Fail("wrong number of arguments in " + line);
+                for (size_t v = 0; v < values.size(); v++) {
+                    if (GetSwitch(commandLine, "-s" + std::to_string(v)) != values[v]) Bench::Fail("a value came back different in " + line);
+                }
+            }
+        };
+    });
+}
+
+#ifndef _WIN32
+static const size_t LOOPBACK_CONNECTION_COUNTS[] = { 16, 256, 2048 };
+
+/**
+ * Real loopback connections from this process to itself, for the Linux lookups that can't be faked.
+ * keys[N] is the 4-tuple of client socket N, which is what the gate looks up for a peer.
+ */
+struct LoopbackFixture {
+    int listener = -1;
+    sockaddr_in listenAddress = {};
+    std::vector<int> sockets;
+    std::vector<TcpConnectionKey> keys;
+
+    explicit LoopbackFixture(size_t connections) {
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        listenAddress.sin_family = AF_INET;
+        listenAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(listenAddress);
+        bind(listener, (sockaddr*)&listenAddress, sizeof(listenAddress));
+        listen(listener, 4096);
+        getsockname(listener, (sockaddr*)&listenAddress, &length);
+
+        for (size_t i = 0; i < connections; i++) {
+            TcpConnectionKey key;
+            if (Connect(key)) keys.push_back(key);
+        }
+    }
+
+    ~LoopbackFixture() {
+        for (int s : sockets) close(s);
+        close(listener);
+    }
+
+    /** Open one connection and keep both of its ends. */
+    bool Connect(TcpConnectionKey& key) {
+        int client = -1, server = -1;
+        if (!Open(client, server, key)) return false;
+
+        sockets.push_back(client);
+        sockets.push_back(server);
+        return true;
+    }
+
+    /** Open one connection, the caller closes both ends. */
+    bool Open(int& client, int& server, TcpConnectionKey& key) {
+        client = socket(AF_INET, SOCK_STREAM, 0);
+        if (client < 0) return false;
+        if (connect(client, (sockaddr*)&listenAddress, sizeof(listenAddress)) != 0) {
+            close(client);
+            return false;
+        }
+        server = accept(listener, nullptr, nullptr);
+
+        sockaddr_in local = {};
+        socklen_t length = sizeof(local);
+        getsockname(client, (sockaddr*)&local, &length);
+        key = { ntohl(local.sin_addr.s_addr), ntohl(listenAddress.sin_addr.s_addr), ntohs(local.sin_port), ntohs(listenAddress.sin_port) };
+        return true;
+    }
+};
+
+/**
+ * The Linux resolver against the real kernel: sock_diag and the socket owner index, compared with the /proc scans they replace.
+ * The connections parameter is how many connections exist on the machine (all of them ours), which is what the scans grow with.
+ */
+static void RegisterLinuxLookupCases() {
+    for (size_t connections : LOOPBACK_CONNECTION_COUNTS) {
+        Bench::Register(WithParameter("linux_inode/proc_net_tcp", "connections", connections), [connections]() -> Bench::Loop {
+            auto fixture = std::make_shared<LoopbackFixture>(connections);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint64_t inode = 0;
+                    Bench::DoNotOptimize(SockDiag::ScanInode(fixture->keys[i % fixture->keys.size()], inode));
+                }
+            };
+        });
+
+        Bench::Register(WithParameter("linux_inode/sock_diag", "connections", connections), [connections]() -> Bench::Loop {
+            auto fixture = std::make_shared<LoopbackFixture>(connections);
+            return [fixture](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint64_t inode = 0;
+                    Bench::DoNotOptimize(SockDiag::QueryInode(fixture->keys[i % fixture->keys.size()], inode));
+                }
+            };
+        });
+
+        Bench::Register(WithParameter("linux_owner/proc_scan", "connections", connections), [connections]() -> Bench::Loop {
+            auto fixture = std::make_shared<LoopbackFixture>(connections);
+            auto inodes = std::make_shared<std::vector<uint64_t>>();
+            for (const TcpConnectionKey& key : fixture->keys) {
+                uint64_t inode = 0;
+                if (SockDiag::ScanInode(key, inode)) inodes->push_back(inode);
+            }
+            return [fixture, inodes](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint32_t owners[SocketOwnerIndex::MAX_HOLDERS];
+                    size_t count = 0;
+                    Bench::DoNotOptimize(SocketOwnerIndex::ScanOwners((*inodes)[i % inodes->size()], owners, count));
+                }
+            };
+        });
+
+        /** Sockets that are already indexed, each hit still costs one readlink to confirm it. */
+        Bench::Register(WithParameter("linux_owner/index", "connections", connections), [connections]() -> Bench::Loop {
+            auto fixture = std::make_shared<LoopbackFixture>(connections);
+            auto index = std::make_shared<SocketOwnerIndex>();
+            auto inodes = std::make_shared<std::vector<uint64_t>>();
+            for (const TcpConnectionKey& key : fixture->keys) {
+                uint64_t inode = 0;
+                uint32_t owners[SocketOwnerIndex::MAX_HOLDERS];
+                size_t count = 0;
+                bool complete = false;
+                if (SockDiag::ScanInode(key, inode) && index->FindOwners(inode, owners, count, true, complete)) inodes->push_back(inode);
+            }
+            return [fixture, index, inodes](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    uint32_t owners[SocketOwnerIndex::MAX_HOLDERS];
+                    size_t count = 0;
+                    bool complete = false;
+                    Bench::DoNotOptimize(index->FindOwners((*inodes)[i % inodes->size()], owners, count, true, complete));
+                }
+            };
+        });
+
+        /**
+         * What the gate pays for a new connection from a peer that connected before: open it, then find its inode and owner.
+         * The naive case scans /proc/net/tcp and every process, the indexed one asks sock_diag and rescans the recent owners.
+         */
+        for (bool indexed : { false, true }) {
+            std::string name = indexed ? "linux_resolve/new_connection/indexed" : "linux_resolve/new_connection/naive";
+            Bench::Register(WithParameter(name.c_str(), "connections", connections), [connections, indexed]() -> Bench::Loop {
+                auto fixture = std::make_shared<LoopbackFixture>(connections);
+                auto index = std::make_shared<SocketOwnerIndex>();
+                return [fixture, index, indexed](uint64_t iterations) {
+                    for (uint64_t i = 0; i < iterations; i++) {
+                        int client, server;
+                        TcpConnectionKey key;
+                        if (!fixture->Open(client, server, key)) continue;
+
+                        uint64_t inode = 0;
+                        uint32_t owners[SocketOwnerIndex::MAX_HOLDERS];
+                        size_t count = 0;
+                        bool complete = false;
+                        if (indexed) {
+                            Bench::DoNotOptimize(SockDiag::QueryInode(key, inode) == SockDiag::Result::Found && index->FindOwners(inode, owners, count, false, complete));
+                        } else {
+                            Bench::DoNotOptimize(SockDiag::ScanInode(key, inode) && SocketOwnerIndex::ScanOwners(inode, owners, count));
+                        }
+                        close(client);
+                        close(server);
+                    }
+                };
+            });
+        }
+    }
+}
+
+/**
+ * Child processes of the bench, each holding the only client end of a connection to a listener of ours and kept alive
+ * until they are killed. This is the process tree the gate sees: a parent it pins, and other processes connecting next to it.
+ */
+struct ProcessTreeFixture {
+    int listener = -1;
+    sockaddr_in listenAddress = {};
+    std::vector<int> servers;
+    SocketOwnerIndex owners;
+
+    ProcessTreeFixture() {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        listenAddress.sin_family = AF_INET;
+        listenAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(listenAddress);
+        bind(listener, (sockaddr*)&listenAddress, sizeof(listenAddress));
+        listen(listener, 64);
+        getsockname(listener, (sockaddr*)&listenAddress, &length);
+    }
+
+    ~ProcessTreeFixture() {
+        for (int s : servers) close(s);
+        close(listener);
+    }
+
+    /**
+     * Start a child that does nothing until it is killed.
+     *
+     * @param key If not null, the child also owns the client end of a new connection, whose 4-tuple is stored here.
+     * @param sharedClient If not null, we keep holding the client end too, and its descriptor is stored here.
+     * @return The PID of the child, or -1.
+     */
+    pid_t Spawn(TcpConnectionKey* key = nullptr, int* sharedClient = nullptr) {
+        int client = -1;
+        if (key) {
+            client = socket(AF_INET, SOCK_STREAM, 0);
+            if (client < 0 || connect(client, (sockaddr*)&listenAddress, sizeof(listenAddress)) != 0) {
+                if (client >= 0) close(client);
+                return -1;
+            }
+            servers.push_back(accept(listener, nullptr, nullptr));
+
+            sockaddr_in local = {};
+            socklen_t length = sizeof(local);
+            getsockname(client, (sockaddr*)&local, &length);
+            *key = { ntohl(local.sin_addr.s_addr), ntohl(listenAddress.sin_addr.s_addr), ntohs(local.sin_port), ntohs(listenAddress.sin_port) };
+        }
+
+        pid_t child = fork();
+        if (child == 0) {
+            for (;;) pause();
+        }
+        if (sharedClient) *sharedClient = client;
+        else if (client >= 0) close(client);
+        return child;
+    }
+
+    /** Find the processes holding the client end of a connection, the way the Linux resolver does. */
+    bool Resolve(const TcpConnectionKey& key, uint32_t* holders, size_t& count, bool all, bool& complete) {
+        uint64_t inode = 0;
+        return SockDiag::QueryInode(key, inode) == SockDiag::Result::Found && owners.FindOwners(inode, holders, count, all, complete);
+    }
+
+    /** Find the one process holding the client end of a connection, with every holder looked for. */
+    bool Resolve(const TcpConnectionKey& key, uint32_t& owningPid) {
+        uint32_t holders[SocketOwnerIndex::MAX_HOLDERS];
+        size_t count = 0;
+        bool complete = false;
+        if (!Resolve(key, holders, count, true, complete) || !complete || count != 1) return false;
+
+        owningPid = holders[0];
+        return true;
+    }
+
+    static void Kill(pid_t child) {
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+    }
+};
+
+/** @return true if this kernel has pidfd_open, without which TrustedProcess falls back to comparing start times. */
+static bool HasPidfd() {
+#ifdef SYS_pidfd_open
+    int pidfd = (int)syscall(SYS_pidfd_open, getpid(), 0);
+    if (pidfd < 0) return false;
+    close(pidfd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Fork a child on a given PID by setting the last PID handed out in our PID namespace, which needs CAP_SYS_ADMIN.
+ *
+ * @param processId The PID the child should get.
+ * @return The PID of the child, which is another one if the PID was taken in between or ns_last_pid couldn't be written, or -1.
+ */
+static pid_t ForkOnPid(pid_t processId) {
+    FILE* lastPid = fopen("/proc/sys/kernel/ns_last_pid", "w");
+    if (lastPid) {
+        fprintf(lastPid, "%d", (int)processId - 1);
+        fclose(lastPid);
+    }
+
+    pid_t child = fork();
+    if (child == 0) {
+        for (;;) pause();
+    }
+    return child;
+}
+
+/** TrustedProcess against real processes: which connections it matches, and that it stops matching once the pinned process is gone. */
+static void RegisterTrustedProcessCases() {
+    /** The pinned parent and an unrelated process each own a connection, only the parent's may match. */
+    Bench::Register("trusted_process/process_tree", []() -> Bench::Loop {
+        struct Tree {
+            ProcessTreeFixture fixture;
+            TrustedProcess parent;
+            pid_t parentPid = -1;
+            pid_t otherPid = -1;
+            TcpConnectionKey parentConnection = {};
+            TcpConnectionKey otherConnection = {};
+
+            ~Tree() {
+                if (parentPid > 0) ProcessTreeFixture::Kill(parentPid);
+                if (otherPid > 0) ProcessTreeFixture::Kill(otherPid);
+            }
+        };
+        auto tree = std::make_shared<Tree>();
+        tree->parentPid = tree->fixture.Spawn(&tree->parentConnection);
+        tree->otherPid = tree->fixture.Spawn(&tree->otherConnection);
+        if (tree->parentPid <= 0 || tree->otherPid <= 0 || !tree->parent.Pin((uint32_t)tree->parentPid)) {
+            return [](uint64_t) { Bench::Fail("the process tree couldn't be started"); };
+        }
+
+        return [tree](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                uint32_t parentOwner = 0, otherOwner = 0;
+                if (!tree->fixture.Resolve(tree->parentConnection, parentOwner) || !tree->fixture.Resolve(tree->otherConnection, otherOwner)) {
+                    Bench::Fail("a connection of the process tree couldn't be resolved");
+                    return;
+                }
+                if (parentOwner != (uint32_t)tree->parentPid || !tree->parent.Matches(parentOwner)) {
+                    Bench::Fail("the pinned parent's connection didn't match it");
+                    return;
+                }
+                if (otherOwner != (uint32_t)tree->otherPid || tree->parent.Matches(otherOwner) || tree->parent.Matches(0)) {
+                    Bench::Fail("another process matched the pinned parent");
+                    return;
+                }
+            }
+        };
+    });
+
+    /**
+     * We connect and fork a child that inherits the socket, as a client would to pass its connection off as that of a trusted child.
+     * Every lookup that calls its answer complete has to name both holders, and once we let go of the socket only the child is left.
+     */
+    Bench::Register("socket_owner/shared_socket", []() -> Bench::Loop {
+        auto fixture = std::make_shared<ProcessTreeFixture>();
+        return [fixture](uint64_t iterations) {
+            const uint32_t self = (uint32_t)getpid();
+            for (uint64_t i = 0; i < iterations; i++) {
+                TcpConnectionKey key = {};
+                int client = -1;
+                pid_t child = fixture->Spawn(&key, &client);
+                if (child <= 0) {
+                    Bench::Fail("a child sharing a connection couldn't be started");
+                    return;
+                }
+
+                auto holds = [](const uint32_t* holders, size_t count, uint32_t processId) {
+                    return std::find(holders, holders + count, processId) != holders + count;
+                };
+
+                const char* failure = nullptr;
+                uint32_t holders[SocketOwnerIndex::MAX_HOLDERS];
+                size_t count = 0;
+                bool complete = false;
+                for (bool all : { false, true }) {
+                    if (!fixture->Resolve(key, holders, count, all, complete)) failure = "a shared connection couldn't be resolved";
+                    else if (all && !complete) failure = "a lookup for every holder came back incomplete";
+                    else if (complete && (count != 2 || !holds(holders, count, self) || !holds(holders, count, (uint32_t)child))) {
+                        failure = "a complete lookup left out a process holding the connection";
+                    }
+                    if (failure) break;
+                }
+
+                uint32_t owningPid = 0;
+                close(client);
+                if (!failure && (!fixture->Resolve(key, owningPid) || owningPid != (uint32_t)child)) {
+                    failure = "the child wasn't found as the only holder once we closed the connection";
+                }
+                ProcessTreeFixture::Kill(child);
+                if (failure) {
+                    Bench::Fail(failure);
+                    return;
+                }
+            }
+        };
+    });
+
+    /**
+     * The pinned process exits: it must stop matching as soon as it has exited, while it is still a zombie with a readable /proc/<pid>/stat
+     * (which the pidfd tells apart, comparing start times can't), and once its PID is handed to a new process.
+     * Forcing the PID onto the new process needs CAP_SYS_ADMIN, without it only the exited process is checked.
+     */
+    Bench::Register("trusted_process/pid_reuse", []() -> Bench::Loop {
+        auto fixture = std::make_shared<ProcessTreeFixture>();
+        const bool hasPidfd = HasPidfd();
+        return [fixture, hasPidfd](uint64_t iterations) {
+            uint64_t reused = 0;
+            for (uint64_t i = 0; i < iterations; i++) {
+                pid_t child = fixture->Spawn();
+                if (child <= 0) {
+                    Bench::Fail("a child couldn't be started");
+                    return;
+                }
+
+                TrustedProcess pinned;
+                if (!pinned.Pin((uint32_t)child) || pinned.Pin((uint32_t)child) || !pinned.Matches((uint32_t)child)) {
+                    Bench::Fail("a running child couldn't be pinned exactly once");
+                    ProcessTreeFixture::Kill(child);
+                    return;
+                }
+
+                kill(child, SIGKILL);
+                siginfo_t info = {};
+                waitid(P_PID, (id_t)child, &info, WEXITED | WNOWAIT);
+                if (hasPidfd && pinned.Matches((uint32_t)child)) {
+                    Bench::Fail("an exited (zombie) process still matched its pin");
+                    waitpid(child, nullptr, 0);
+                    return;
+                }
+                waitpid(child, nullptr, 0);
+                if (pinned.Matches((uint32_t)child)) {
+                    Bench::Fail("a reaped process still matched its pin");
+                    return;
+                }
+
+                pid_t successor = ForkOnPid(child);
+                if (successor <= 0) continue;
+                if (successor == child) {
+                    reused++;
+                    if (pinned.Matches((uint32_t)successor)) {
+                        Bench::Fail("a new process on a reused PID matched the pin of the process that had it before");
+                        ProcessTreeFixture::Kill(successor);
+                        return;
+                    }
+                }
+                ProcessTreeFixture::Kill(successor);
+            }
+            Bench::SetNote("PID reused " + std::to_string(reused) + "/" + std::to_string(iterations) + (hasPidfd ? "" : ", no pidfd"));
+        };
+    });
+}
+
+/**
+ * The overlapped read path of HookedWSARecv, with a CompletionPort standing in for the IOCP and a socket pair for the connection.
+ * One thread plays the completion port thread: it issues reads and dequeues their completions, and never waits on a verdict.
+ */
+struct CompletionFixture {
+    GateFixture gate;
+    SocketVerdictTable verdictTable;
+    DeferredReads deferredReads;
+    std::unique_ptr<ResolverPool> pool;
+    CompletionPort port;
+    int sockets[2];
+    char buffer[64];
+    /** How long issuing a read took, which is what the completion port thread pays. */
+    LatencyHistogram issueLatency{};
+    /** From issuing a read to dequeuing its completion. */
+    LatencyHistogram completionLatency{};
+
+    /**
+     * @param resolveDelay Extra time each resolve takes, standing in for the cost of resolving a real peer.
+     */
+    explicit CompletionFixture(std::chrono::microseconds resolveDelay = std::chrono::microseconds(0)) {
+        gate.Connect(gate.helperPid, 1, 1000);
+        pool.reset(new ResolverPool(2, [this, resolveDelay](uint64_t) {
+            if (resolveDelay.count() > 0) std::this_thread::sleep_for(resolveDelay);
+            return gate.resolver.ResolveVerdict(gate.connections[0]);
+        }));
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
+        port.Associate(sockets[0], 1);
+    }
+
+    ~CompletionFixture() {
+        pool->Shutdown(true);
+        close(sockets[0]);
+        close(sockets[1]);
+    }
+
+    /** Resume a parked read, like OverlappedReads::Resume: issue it for real if allowed, fail it through the port otherwise. */
+    void Resume(int fd, Verdict verdict) {
+        if (verdict == Verdict::Allow) {
+            port.Read(fd, buffer, sizeof(buffer), buffer);
+        } else {
+            port.Post({ 1, 0, buffer, verdict == Verdict::Unknown ? ECANCELED : ECONNABORTED });
+        }
+    }
+
+    /** HookedWSARecv for an overlapped read on a debugger socket. */
+    void Read(int fd) {
+        Verdict verdict = verdictTable.Lookup((uint64_t)fd);
+        if (verdict == Verdict::Unknown || verdict == Verdict::Pending) {
+            bool created = false;
+            std::shared_ptr<VerdictSlot> slot = verdictTable.Acquire((uint64_t)fd, created);
+            if (created) pool->Submit((uint64_t)fd, slot);
+
+            if (deferredReads.Defer((uint64_t)fd, slot, [this, fd](Verdict verdict) { Resume(fd, verdict); })) return;
+            verdict = slot->Load();
+        }
+        Resume(fd, verdict);
+    }
+
+    /** Send a byte, read it through the gate and wait for the completion. */
+    bool RoundTrip(bool gated) {
+        char byte = 'x';
+        if (send(sockets[1], &byte, 1, 0) != 1) return false;
+
+        auto start = std::chrono::steady_clock::now();
+        if (gated) Read(sockets[0]);
+        else port.Read(sockets[0], buffer, sizeof(buffer), buffer);
+        auto issued = std::chrono::steady_clock::now();
+
+        CompletionPort::Packet packet;
+        bool completed = port.GetQueued(packet, 2000) && packet.bytes == 1;
+        auto end = std::chrono::steady_clock::now();
+
+        issueLatency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(issued - start).count());
+        completionLatency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return completed;
+    }
+};
+
+/**
+ * The completion port read path on the epoll stand-in. The trusted read is the steady state: one lookup on top of the ungated read.
+ * The first read of a debugger socket is parked while the pool resolves it; the note shows that issuing it costs a few
+ * microseconds while the completion only arrives once the slow resolve is done.
+ */
+static void RegisterCompletionCases() {
+    Bench::Register("completion/read/ungated", []() -> Bench::Loop {
+        auto fixture = std::make_shared<CompletionFixture>();
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->RoundTrip(false));
+            }
+        };
+    });
+
+    Bench::Register("completion/read/trusted", []() -> Bench::Loop {
+        auto fixture = std::make_shared<CompletionFixture>();
+        fixture->verdictTable.Insert((uint64_t)fixture->sockets[0], Verdict::Allow);
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->RoundTrip(true));
+            }
+        };
+    });
+
+    Bench::Register("completion/first_read/debugger/resolve:200us", []() -> Bench::Loop {
+        auto fixture = std::make_shared<CompletionFixture>(std::chrono::microseconds(200));
+        return [fixture](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                Bench::DoNotOptimize(fixture->RoundTrip(true));
+                fixture->deferredReads.Cancel((uint64_t)fixture->sockets[0]);
+                fixture->verdictTable.Evict((uint64_t)fixture->sockets[0]);
+            }
+            Bench::SetNote("issue " + LatencyNote(fixture->issueLatency) + ", completion " + LatencyNote(fixture->completionLatency));
+        };
+    });
+}
+
+static const size_t POLICY_SIZES[] = { 64, 4096, 65536 };
+
+/**
+ * A policy of the given size, half exact paths and half directory prefixes, plus the identity of this executable.
+ * Path N is /opt/tools/N/tool and prefix N is /opt/vendor/N.
+ */
+static std::string PolicyText(size_t entries) {
+    std::string text = "# generated\nidentity /proc/self/exe\n";
+    for (size_t i = 0; i < entries / 2; i++) text += "path /opt/tools/" + std::to_string(i) + "/tool\n";
+    for (size_t i = 0; i < entries / 2; i++) text += "prefix /opt/vendor/" + std::to_string(i) + "\n";
+    return text;
+}
+
+static ProcessImage ImageAt(const std::string& path) {
+    ProcessImage image;
+    image.path.Assign(path);
+    return image;
+}
+
+static std::unique_ptr<const TrustPolicy> CompilePolicy(const std::string& text) {
+    size_t errorLine = 0;
+    std::unique_ptr<const TrustPolicy> policy = TrustPolicy::Compile(text, errorLine);
+    if (!policy) Bench::Fail("the policy doesn't compile, line " + std::to_string(errorLine));
+    return policy;
+}
+
+static void WriteFile(const std::string& path, const std::string& text) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return;
+    fwrite(text.data(), 1, text.size(), file);
+    fclose(file);
+}
+
+/**
+ * The trust policy: compiling it, looking up peers in it (alone and while it is being republished), and reloading its file.
+ * The semantics and reload cases check what they do and fail the run if the policy decides differently than expected.
+ */
+static void RegisterPolicyCases() {
+    for (size_t entries : POLICY_SIZES) {
+        Bench::Register(WithParameter("policy/compile", "entries", entries), [entries]() -> Bench::Loop {
+            auto text = std::make_shared<std::string>(PolicyText(entries));
+            return [text](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(CompilePolicy(*text)->Size());
+                }
+            };
+        });
+
+        Bench::Register(WithParameter("policy/lookup/path", "entries", entries), [entries]() -> Bench::Loop {
+            std::shared_ptr<const TrustPolicy> policy = CompilePolicy(PolicyText(entries));
+            auto image = std::make_shared<ProcessImage>(ImageAt("/opt/tools/" + std::to_string(entries / 4) + "/tool"));
+            return [policy, image](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(policy->Trusts(*image));
+                }
+            };
+        });
+
+        Bench::Register(WithParameter("policy/lookup/prefix", "entries", entries), [entries]() -> Bench::Loop {
+            std::shared_ptr<const TrustPolicy> policy = CompilePolicy(PolicyText(entries));
+            auto image = std::make_shared<ProcessImage>(ImageAt("/opt/vendor/" + std::to_string(entries / 4) + "/bin/helper"));
+            return [policy, image](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(policy->Trusts(*image));
+                }
+            };
+        });
+
+        Bench::Register(WithParameter("policy/lookup/identity", "entries", entries), [entries]() -> Bench::Loop {
+            std::shared_ptr<const TrustPolicy> policy = CompilePolicy(PolicyText(entries));
+            auto image = std::make_shared<ProcessImage>(ImageAt("/somewhere/else"));
+            GetFileIdentity("/proc/self/exe", image->identity);
+            return [policy, image](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(policy->Trusts(*image));
+                }
+            };
+        });
+
+        /** The common case for an untrusted peer: every set is looked at and nothing matches. */
+        Bench::Register(WithParameter("policy/lookup/miss", "entries", entries), [entries]() -> Bench::Loop {
+            std::shared_ptr<const TrustPolicy> policy = CompilePolicy(PolicyText(entries));
+            auto image = std::make_shared<ProcessImage>(ImageAt("/opt/vendorx/1/bin/helper"));
+            image->identity = OTHER_IDENTITY;
+            return [policy, image](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; i++) {
+                    Bench::DoNotOptimize(policy->Trusts(*image));
+                }
+            };
+        });
+    }
+
+    for (size_t writers : { (size_t)0, (size_t)1 }) {
+        /** Lookups through the epoch pointer, with a writer republishing the policy as fast as it can or without one. */
+        Bench::Register(WithParameter("policy/read/epoch", "writers", writers), [writers]() -> Bench::Loop {
+            auto pointer = std::make_shared<EpochPointer<TrustPolicy>>();
+            auto text = std::make_shared<std::string>(PolicyText(4096));
+            pointer->Publish(CompilePolicy(*text));
+
+            return [pointer, text, writers](uint64_t iterations) {
+                std::atomic<bool> done{false};
+                std::atomic<uint64_t> published{0};
+                std::thread writer;
+                if (writers) {
+                    writer = std::thread([&]() {
+                        while (!done.load(std::memory_order_acquire)) {
+                            pointer->Publish(CompilePolicy(*text));
+                            published.fetch_add(1, std::memory_order_relaxed);
+                        }
+                    });
+                }
+
+                ProcessImage image = ImageAt("/opt/vendor/7/bin/helper");
+                for (uint64_t i = 0; i < iterations; i++) {
+                    auto policy = pointer->Read();
+                    if (!policy || !policy->Trusts(image)) Bench::Fail("a reader saw a policy that was freed or not published");
+                }
+
+                done.store(true, std::memory_order_release);
+                if (writer.joinable()) writer.join();
+                if (writers) Bench::SetNote(std::to_string(published.load()) + " policies published");
+            };
+        });
+    }
+
+    Bench::Register("policy/semantics", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            const std::string text =
+                "# tools\r\n"
+                "\r\n"
+                "  path /usr/bin/tool  \r\n"
+                "path /opt/my tools/helper\n"
+                "prefix /opt/a\n"
+                "prefix /opt/a/b\n"
+                "prefix /opt/c/\n"
+                "identity /nonexistent/praesidium/tool\n"
+                "sha256 BA7816BF8F01CFEA414140DE5DAE2223B00361A396177A9CB410FF61F20015AD\n";
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                std::unique_ptr<const TrustPolicy> policy = CompilePolicy(text);
+                if (!policy) return;
+
+                static const struct {
+                    const char* path;
+                    bool trusted;
+                } CASES[] = {
+                    { "/usr/bin/tool", true },
+                    { "/usr/bin/tool2", false },
+                    { "/usr/bin", false },
+                    { "/opt/my tools/helper", true },
+                    { "/opt/a/x", true },
+                    { "/opt/a/b/c/x", true },
+                    { "/opt/a", false },
+                    { "/opt/ab/x", false },
+                    { "/opt/b/x", false },
+                    { "/opt/c/x", true },
+                    { "/opt/cc/x", false },
+                    { "/", false },
+                };
+                for (const auto& check : CASES) {
+                    if (policy->Trusts(ImageAt(check.path)) != check.trusted) Bench::Fail(std::string("wrong decision for ") + check.path);
+                }
+
+                if (!policy->TrustsDigest(Sha256::Hash("abc", 3)) || policy->TrustsDigest(Sha256::Hash("abd", 3))) {
+                    Bench::Fail("wrong decision for a digest");
+                }
+
+                /** Two paths, two prefixes (/opt/a/b is covered by /opt/a) and a digest. */
+                if (policy->Size() != 5 || policy->MissingIdentities() != 1) Bench::Fail("wrong number of entries");
+
+                size_t errorLine = 0;
+                if (TrustPolicy::Compile("path /a\nallow /b\n", errorLine) || errorLine != 2) Bench::Fail("an unknown entry was accepted");
+                if (TrustPolicy::Compile("path\n", errorLine) || errorLine != 1) Bench::Fail("an entry without a value was accepted");
+                if (TrustPolicy::Compile("sha256 ba7816bf\n", errorLine) || errorLine != 1) Bench::Fail("a short digest was accepted");
+            }
+        };
+    });
+
+    /** A whole edit cycle of the file: changed, unchanged, broken, removed. */
+    Bench::Register("policy/file/reload", []() -> Bench::Loop {
+        char pattern[] = "/tmp/praesidium-policy-XXXXXX";
+        int fd = mkstemp(pattern);
+        if (fd >= 0) close(fd);
+        auto path = std::make_shared<std::string>(pattern);
+
+        return [path](uint64_t iterations) {
+            TrustPolicyFile file(*path);
+            ProcessImage first = ImageAt("/opt/first/tool");
+            ProcessImage second = ImageAt("/opt/second/tool");
+
+            for (uint64_t i = 0; i < iterations; i++) {
+                WriteFile(*path, "path /opt/first/tool\n");
+                if (!file.Reload() || !file.Trusts(first)) Bench::Fail("a new policy wasn't loaded");
+                if (file.Reload()) Bench::Fail("an unchanged policy was loaded again");
+
+                WriteFile(*path, "path /opt/second/tool\n# " + std::to_string(i) + "\n");
+                if (!file.Reload() || file.Trusts(first) || !file.Trusts(second)) Bench::Fail("a changed policy wasn't loaded");
+
+                WriteFile(*path, "path /opt/first/tool\ntrust everything\n");
+                if (file.Reload() || !file.Trusts(second)) Bench::Fail("an invalid policy replaced a valid one");
+
+                unlink(path->c_str());
+                if (!file.Reload() || file.Trusts(second)) Bench::Fail("a removed policy is still trusted");
+            }
+        };
+    });
+}
+
+/** A temporary file of random content, removed with the fixture. */
+struct TemporaryFile {
+    std::string path;
+
+    explicit TemporaryFile(size_t size) {
+        char pattern[] = "/tmp/praesidium-hash-XXXXXX";
+        int fd = mkstemp(pattern);
+        if (fd >= 0) close(fd);
+        path = pattern;
+        Rewrite(size, 1);
+    }
+
+    ~TemporaryFile() { unlink(path.c_str()); }
+
+    void Rewrite(size_t size, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::string content(size, '\0');
+        for (char& c : content) c = (char)random();
+        WriteFile(path, content);
+    }
+};
+
+/**
+ * The cost of hashing a peer's executable: cold is a digest that isn't cached yet (the file itself is in the page cache),
+ * warm is the open, stat and lookup every later check pays. The invalidation case fails the run if a rewritten file keeps its old digest,
+ * even with its write time put back. A file that was just written isn't cached, so the warm and invalidation cases wait that out.
+ */
+static void RegisterFileHashCases() {
+    for (size_t size : { (size_t)1 << 20, (size_t)16 << 20, (size_t)64 << 20 }) {
+        Bench::Register(WithParameter("file_hash/cold", "bytes", size), [size]() -> Bench::Loop {
+            auto file = std::make_shared<TemporaryFile>(size);
+            return [file, size](uint64_t iterations) {
+                auto start = std::chrono::steady_clock::now();
+                for (uint64_t i = 0; i < iterations; i++) {
+                    FileHashCache cache;
+                    Sha256Digest digest;
+                    if (!cache.Hash(file->path.c_str(), digest)) Bench::Fail("the file couldn't be hashed");
+                }
+                Bench::SetNote(ThroughputNote(size * iterations, std::chrono::steady_clock::now() - start));
+            };
+        });
+    }
+
+    Bench::Register("file_hash/warm/bytes:67108864", []() -> Bench::Loop {
+        auto file = std::make_shared<TemporaryFile>((size_t)64 << 20);
+        auto cache = std::make_shared<FileHashCache>();
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        Sha256Digest primed;
+        cache->Hash(file->path.c_str(), primed);
+        return [file, cache](uint64_t iterations) {
+            Sha256Digest digest;
+            for (uint64_t i = 0; i < iterations; i++) {
+                if (!cache->Hash(file->path.c_str(), digest)) Bench::Fail("the file couldn't be hashed");
+            }
+            if (cache->GetCounters().misses != 1) Bench::Fail("a warm lookup hashed the file again");
+        };
+    });
+
+    Bench::Register("file_hash/invalidation", []() -> Bench::Loop {
+        auto file = std::make_shared<TemporaryFile>(4096);
+        return [file](uint64_t iterations) {
+            FileHashCache cache;
+            for (uint64_t i = 0; i < iterations; i++) {
+                file->Rewrite(4096, (uint32_t)i + 2);
+                std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                Sha256Digest first, second;
+                if (!cache.Hash(file->path.c_str(), first) || !cache.Hash(file->path.c_str(), second) || first != second) {
+                    Bench::Fail("the file couldn't be hashed");
+                }
+                if (cache.GetCounters().hits != i + 1) Bench::Fail("a file that settled wasn't cached");
+
+                /** Rewrite it in place at the same size and put its times back, as its owner can. */
+                struct stat before = {};
+                stat(file->path.c_str(), &before);
+                file->Rewrite(4096, (uint32_t)i + 3);
+                std::this_thread::sleep_for(std::chrono::milliseconds(150));
+                struct timespec times[2] = { before.st_atim, before.st_mtim };
+                utimensat(AT_FDCWD, file->path.c_str(), times, 0);
+                if (!cache.Hash(file->path.c_str(), second) || first == second) Bench::Fail("a rewritten file kept its old digest");
+            }
+        };
+    });
+}
+
+/** What DllMain pays for on every load, with /proc standing in for the process snapshot. */
+static void RegisterStartupCases() {
+    Bench::Register("startup/probe", []() -> Bench::Loop {
+        return [](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; i++) {
+                StartupProbe probe;
+                if (!CaptureStartupProbe(probe)) Bench::Fail("the current process couldn't be probed");
+                if (probe.parentId != (uint32_t)getppid() || probe.parentName.empty()) Bench::Fail("the parent wasn't found");
+                if (probe.developerMode || probe.ShouldGate()) Bench::Fail("the bench would be gated");
+                Bench::DoNotOptimize(probe);
+            }
+        };
+    });
+
+    /**
+     * Starting a process with the shim preloaded, against starting it without. Everything Steam starts inherits LD_PRELOAD,
+     * so the inactive case is what every process that isn't gated pays, and the active one is a gated process that exits right away.
+     */
+    static const struct {
+        const char* name;
+        const char* preload;
+        const char* trustedExe;
+    } SPAWN_MODES[] = {
+        { "startup/spawn/preload:none", nullptr, nullptr },
+        { "startup/spawn/preload:inactive", PRAESIDIUM_PRELOAD_PATH, nullptr },
+        { "startup/spawn/preload:active", PRAESIDIUM_PRELOAD_PATH, "/bin/true" },
+    };
+    for (const auto& mode : SPAWN_MODES) {
+        Bench::Register(mode.name, [mode]() -> Bench::Loop {
+            auto environment = std::make_shared<std::vector<std::string>>();
+            for (char** variable = environ; *variable; variable++) {
+                std::string_view entry(*variable);
+                if (entry.compare(0, 11, "LD_PRELOAD=") != 0 && entry.compare(0, 11, "PRAESIDIUM_") != 0) environment->push_back(*variable);
+            }
+            if (mode.preload) environment->push_back(std::string("LD_PRELOAD=") + mode.preload);
+            if (mode.trustedExe) environment->push_back(std::string("PRAESIDIUM_TRUSTED_EXE=") + mode.trustedExe);
+
+            return [environment](uint64_t iterations) {
+                std::vector<char*> envp;
+                for (std::string& variable : *environment) envp.push_back(&variable[0]);
+                envp.push_back(nullptr);
+                char* argv[] = { (char*)"/bin/true", nullptr };
+
+                for (uint64_t i = 0; i < iterations; i++) {
+                    pid_t pid;
+                    if (posix_spawn(&pid, "/bin/true", nullptr, nullptr, argv, envp.data()) != 0) Bench::Fail("/bin/true couldn't be started");
+
+                    int status = 0;
+                    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) Bench::Fail("/bin/true failed");
+                }
+            };
+        });
+    }
+}
+#endif
+
+int main(int argc, char** argv) {
+    RegisterTcpSnapshotCases();
+    RegisterProcessCases();
+    RegisterDevicePathCases();
+    RegisterResolverCases();
+    RegisterVerdictTableCases();
+    RegisterRecvCases();
+    RegisterInstrumentationCases();
+    RegisterHttpScanCases();
+    RegisterWebSocketCases();
+    RegisterSha256Cases();
+    RegisterCommandLineCases();
+#ifndef _WIN32
+    RegisterLinuxLookupCases();
+    RegisterTrustedProcessCases();
+    RegisterCompletionCases();
+    RegisterPolicyCases();
+    RegisterFileHashCases();
+    RegisterStartupCases();
+#endif
+    return Bench::RunAll(argc, argv);
+}
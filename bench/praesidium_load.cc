@@ -0,0 +1,676 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <latency_histogram.h>
+
+/**
+ * End to end load test of the Linux gate.
+ *
+ * Runs a small server mimicking the CEF DevTools endpoint (HTTP /json and a WebSocket speaking CDP) with libpraesidium.so preloaded,
+ * and drives it from trusted and untrusted client processes. Trusted clients run this executable, which the gate is told to trust.
+ * Untrusted clients run a byte for byte copy of it, which has a different file identity and so must be blocked.
+ *
+ * Usage: praesidium_load [--trusted N] [--untrusted M] [--rate connections/s per client] [--duration seconds]
+ *                        [--messages CDP messages per WebSocket] [--preload path] [--gate read|accept] [--no-gate]
+ *
+ * The same executable also runs the server and the clients, selected by its first argument ("server" or "client").
+ */
+
+#ifndef PRAESIDIUM_PRELOAD_PATH
+#define PRAESIDIUM_PRELOAD_PATH "libpraesidium.so"
+#endif
+
+static const size_t MAX_MESSAGE = 16 * 1024;
+
+struct Options {
+    int trusted = 4;
+    int untrusted = 2;
+    double rate = 50;
+    double duration = 5;
+    int messages = 4;
+    uint16_t port = 0;
+    std::string preload = PRAESIDIUM_PRELOAD_PATH;
+    bool gate = true;
+    /** Passed to the server as PRAESIDIUM_GATE. */
+    std::string gateMode = "read";
+};
+
+/** What happened to the connections of one client process. */
+struct ClientTotals {
+    uint64_t connections = 0;
+    /** Every request on the connection got its response. */
+    uint64_t served = 0;
+    /** The connection was reset or closed before the first response byte, which is what the gate does to untrusted peers. */
+    uint64_t blocked = 0;
+    /** Anything else: timeouts, partial responses, failed connects. */
+    uint64_t errors = 0;
+    uint64_t requests = 0;
+};
+
+/** SHA-1, only needed for the Sec-WebSocket-Accept header of the handshake. */
+static void Sha1(const uint8_t* data, size_t length, uint8_t digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    auto rotate = [](uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+
+    std::vector<uint8_t> message(data, data + length);
+    message.push_back(0x80);
+    while (message.size() % 64 != 56) message.push_back(0);
+    uint64_t bits = (uint64_t)length * 8;
+    for (int i = 7; i >= 0; i--) message.push_back((uint8_t)(bits >> (i * 8)));
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = &message[chunk + i * 4];
+            w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+            uint32_t temp = rotate(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rotate(b, 30); b = a; a = temp;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) digest[i * 4 + j] = (uint8_t)(h[i] >> (24 - j * 8));
+    }
+}
+
+static std::string Base64(const uint8_t* data, size_t length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t value = (uint32_t)data[i] << 16;
+        if (i + 1 < length) value |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < length) value |= data[i + 2];
+
+        out += alphabet[(value >> 18) & 63];
+        out += alphabet[(value >> 12) & 63];
+        out += i + 1 < length ? alphabet[(value >> 6) & 63] : '=';
+        out += i + 2 < length ? alphabet[value & 63] : '=';
+    }
+    return out;
+}
+
+static bool SendAll(int s, const void* data, size_t length) {
+    const char* p = (const char*)data;
+    while (length > 0) {
+        ssize_t sent = send(s, p, length, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        p += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+/**
+ * Read until the end of an HTTP header block.
+ *
+ * @return The number of bytes read (header included), 0 on a clean close, -1 on an error (errno is kept).
+ */
+static ssize_t ReadHeaders(int s, char* buffer, size_t size, size_t& headerLength) {
+    size_t length = 0;
+    while (length < size - 1) {
+        ssize_t received = recv(s, buffer + length, size - 1 - length, 0);
+        if (received <= 0) return length == 0 ? received : -1;
+        length += (size_t)received;
+        buffer[length] = '\0';
+
+        const char* end = strstr(buffer, "\r\n\r\n");
+        if (end) {
+            headerLength = (size_t)(end - buffer) + 4;
+            return (ssize_t)length;
+        }
+    }
+    errno = EMSGSIZE;
+    return -1;
+}
+
+static bool ReadExactly(int s, void* data, size_t length) {
+    char* p = (char*)data;
+    while (length > 0) {
+        ssize_t received = recv(s, p, length, 0);
+        if (received <= 0) return false;
+        p += received;
+        length -= (size_t)received;
+    }
+    return true;
+}
+
+/**
+ * Write one WebSocket text frame. Clients have to mask their frames, servers must not.
+ */
+static bool SendFrame(int s, const std::string& payload, bool mask) {
+    uint8_t header[14];
+    size_t headerLength = 2;
+    header[0] = 0x81;
+    header[1] = mask ? 0x80 : 0;
+
+    if (payload.size() < 126) {
+        header[1] |= (uint8_t)payload.size();
+    } else {
+        header[1] |= 126;
+        header[2] = (uint8_t)(payload.size() >> 8);
+        header[3] = (uint8_t)payload.size();
+        headerLength = 4;
+    }
+
+    std::string frame((const char*)header, headerLength);
+    if (mask) {
+        uint8_t key[4] = { 0x12, 0x34, 0x56, 0x78 };
+        frame.append((const char*)key, 4);
+        for (size_t i = 0; i < payload.size(); i++) frame += (char)(payload[i] ^ key[i % 4]);
+    } else {
+        frame += payload;
+    }
+    return SendAll(s, frame.data(), frame.size());
+}
+
+/**
+ * Read one WebSocket frame, unmasking it if needed.
+ *
+ * @return false if the connection failed or the frame is too large.
+ */
+static bool ReadFrame(int s, std::string& payload) {
+    uint8_t header[2];
+    if (!ReadExactly(s, header, 2)) return false;
+
+    uint64_t length = header[1] & 0x7F;
+    if (length == 126) {
+        uint8_t extended[2];
+        if (!ReadExactly(s, extended, 2)) return false;
+        length = ((uint64_t)extended[0] << 8) | extended[1];
+    } else if (length == 127) {
+        return false;
+    }
+    if (length > MAX_MESSAGE) return false;
+
+    uint8_t key[4] = { 0, 0, 0, 0 };
+    bool masked = (header[1] & 0x80) != 0;
+    if (masked && !ReadExactly(s, key, 4)) return false;
+
+    payload.resize((size_t)length);
+    if (length && !ReadExactly(s, &payload[0], (size_t)length)) return false;
+    if (masked) {
+        for (size_t i = 0; i < payload.size(); i++) payload[i] ^= (char)key[i % 4];
+    }
+    return true;
+}
+
+/**
+ * Serve one connection: /json requests get a target list, /devtools/ upgrades to a WebSocket that answers every CDP message by its id.
+ */
+static void ServeConnection(int s, uint16_t port) {
+    char request[4096];
+    size_t headerLength = 0;
+
+    for (;;) {
+        if (ReadHeaders(s, request, sizeof(request), headerLength) <= 0) break;
+
+        if (strncmp(request, "GET /devtools/", 14) == 0) {
+            const char* keyHeader = strcasestr(request, "Sec-WebSocket-Key:");
+            if (!keyHeader) break;
+
+            keyHeader += 18;
+            while (*keyHeader == ' ') keyHeader++;
+            std::string key(keyHeader, strcspn(keyHeader, "\r\n"));
+            key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+            uint8_t digest[20];
+            Sha1((const uint8_t*)key.data(), key.size(), digest);
+            std::string response = "HTTP/1.1 101 WebSocket Protocol Handshake\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: "
+                + Base64(digest, sizeof(digest)) + "\r\n\r\n";
+            if (!SendAll(s, response.data(), response.size())) break;
+
+            std::string message;
+            while (ReadFrame(s, message)) {
+                const char* id = strstr(message.c_str(), "\"id\":");
+                std::string reply = "{\"id\":" + std::to_string(id ? atoi(id + 5) : 0) + ",\"result\":{\"result\":{\"type\":\"number\",\"value\":2}}}";
+                if (!SendFrame(s, reply, false)) break;
+            }
+            break;
+        }
+
+        std::string body = "[{\"description\":\"\",\"devtoolsFrontendUrl\":\"/devtools/inspector.html?ws=127.0.0.1:" + std::to_string(port)
+            + "/devtools/page/1\",\"id\":\"1\",\"title\":\"Steam\",\"type\":\"page\",\"url\":\"https://steamloopback.host/\",\"webSocketDebuggerUrl\":\"ws://127.0.0.1:"
+            + std::to_string(port) + "/devtools/page/1\"}]";
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json; charset=UTF-8\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+        if (!SendAll(s, response.data(), response.size())) break;
+    }
+    close(s);
+}
+
+/**
+ * Accept connections until SIGTERM. The signal is taken with sigwait and the server exits normally, so the gate's destructor
+ * runs and removes its metrics segment.
+ */
+static int RunServer(uint16_t port) {
+    sigset_t terminate;
+    sigemptyset(&terminate);
+    sigaddset(&terminate, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &terminate, nullptr);
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1024) != 0) {
+        perror("praesidium_load server");
+        return 1;
+    }
+
+    std::thread([listener, port]() {
+        for (;;) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                perror("praesidium_load server accept");
+                exit(1);
+            }
+            std::thread(ServeConnection, client, port).detach();
+        }
+    }).detach();
+
+    int signal = 0;
+    sigwait(&terminate, &signal);
+    return 0;
+}
+
+static int Connect(uint16_t port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return -1;
+
+    timeval timeout = { 2, 0 };
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int noDelay = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (connect(s, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+enum class Outcome { Served, Blocked, Error };
+
+/** The read gate answers untrusted peers with a 403. */
+static bool IsForbidden(const char* response) {
+    return strncmp(response, "HTTP/1.1 403", 12) == 0;
+}
+
+/** A failure before any response byte arrived is the accept gate's doing (or the read gate's, once a peer is over its block budget). */
+static Outcome Failed(bool gotResponse) {
+    if (gotResponse) return Outcome::Error;
+    return errno == ECONNRESET || errno == EPIPE || errno == 0 ? Outcome::Blocked : Outcome::Error;
+}
+
+/**
+ * One client connection, alternating between what a DevTools frontend does: list the targets over HTTP,
+ * or attach to one over a WebSocket and send it CDP messages. Every round trip is recorded in the histogram.
+ */
+static Outcome RunConnection(uint16_t port, bool websocket, int messages, LatencyHistogram& latency, uint64_t& requests) {
+    int s = Connect(port);
+    if (s < 0) return Outcome::Error;
+
+    auto start = std::chrono::steady_clock::now();
+    auto record = [&]() {
+        auto now = std::chrono::steady_clock::now();
+        latency.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count());
+        start = now;
+        requests++;
+    };
+
+    char response[8192];
+    size_t headerLength = 0;
+    errno = 0;
+
+    if (!websocket) {
+        const char request[] = "GET /json/list HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+        if (!SendAll(s, request, sizeof(request) - 1) || ReadHeaders(s, response, sizeof(response), headerLength) <= 0) {
+            Outcome outcome = Failed(false);
+            close(s);
+            return outcome;
+        }
+        close(s);
+        if (IsForbidden(response)) return Outcome::Blocked;
+
+        record();
+        return strncmp(response, "HTTP/1.1 200", 12) == 0 ? Outcome::Served : Outcome::Error;
+    }
+
+    const char request[] = "GET /devtools/page/1 HTTP/1.1\r\nHost: 127.0.0.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    if (!SendAll(s, request, sizeof(request) - 1) || ReadHeaders(s, response, sizeof(response), headerLength) <= 0) {
+        Outcome outcome = Failed(false);
+        close(s);
+        return outcome;
+    }
+    if (IsForbidden(response)) {
+        close(s);
+        return Outcome::Blocked;
+    }
+    record();
+    if (!strstr(response, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=")) {
+        close(s);
+        return Outcome::Error;
+    }
+
+    for (int i = 1; i <= messages; i++) {
+        std::string message = "{\"id\":" + std::to_string(i) + ",\"method\":\"Runtime.evaluate\",\"params\":{\"expression\":\"1+1\"}}";
+        std::string reply;
+        if (!SendFrame(s, message, true) || !ReadFrame(s, reply)) {
+            close(s);
+            return Outcome::Error;
+        }
+        record();
+    }
+
+    close(s);
+    return Outcome::Served;
+}
+
+/**
+ * Open connections at a fixed rate for the given duration, then print the totals and the latency histogram to stdout
+ * for the parent to merge: one "totals" line, then one "bucket <index> <count>" line per non-empty bucket.
+ */
+static int RunClient(uint16_t port, double rate, double duration, int messages) {
+    std::unique_ptr<LatencyHistogram> latency(new LatencyHistogram());
+    ClientTotals totals;
+
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(duration));
+    auto next = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; std::chrono::steady_clock::now() < end; i++) {
+        std::this_thread::sleep_until(next);
+        next += interval;
+
+        totals.connections++;
+        switch (RunConnection(port, i % 2 == 1, messages, *latency, totals.requests)) {
+            case Outcome::Served: totals.served++; break;
+            case Outcome::Blocked: totals.blocked++; break;
+            case Outcome::Error: totals.errors++; break;
+        }
+    }
+
+    printf("totals %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", totals.connections, totals.served, totals.blocked, totals.errors, totals.requests);
+
+    std::unique_ptr<LatencyHistogram::Snapshot> snapshot(new LatencyHistogram::Snapshot());
+    latency->Read(*snapshot);
+    for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; i++) {
+        if (snapshot->counts[i]) printf("bucket %zu %" PRIu64 "\n", i, snapshot->counts[i]);
+    }
+    return 0;
+}
+
+/** A process started by the parent, with its stdout connected to a pipe. */
+struct Child {
+    pid_t pid = -1;
+    int output = -1;
+    bool trusted = true;
+};
+
+static Child Spawn(const std::string& executable, const std::vector<std::string>& arguments, const std::vector<std::string>& environment, bool captureOutput) {
+    int pipeFds[2] = { -1, -1 };
+    if (captureOutput && pipe(pipeFds) != 0) return {};
+
+    Child child;
+    child.pid = fork();
+    if (child.pid == 0) {
+        if (captureOutput) {
+            dup2(pipeFds[1], STDOUT_FILENO);
+            close(pipeFds[0]);
+            close(pipeFds[1]);
+        }
+
+        std::vector<char*> argv;
+        argv.push_back((char*)executable.c_str());
+        for (const std::string& argument : arguments) argv.push_back((char*)argument.c_str());
+        argv.push_back(nullptr);
+
+        for (const std::string& variable : environment) putenv((char*)variable.c_str());
+        execv(executable.c_str(), argv.data());
+        _exit(127);
+    }
+
+    if (captureOutput) {
+        close(pipeFds[1]);
+        child.output = pipeFds[0];
+    }
+    return child;
+}
+
+static std::string ReadAll(int fd) {
+    std::string output;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) output.append(buffer, (size_t)length);
+    close(fd);
+    return output;
+}
+
+static bool CopyFile(const std::string& from, const std::string& to) {
+    int in = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) return false;
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0755);
+    if (out < 0) {
+        close(in);
+        return false;
+    }
+
+    char buffer[65536];
+    ssize_t length;
+    bool ok = true;
+    while ((length = read(in, buffer, sizeof(buffer))) > 0) {
+        if (write(out, buffer, (size_t)length) != length) {
+            ok = false;
+            break;
+        }
+    }
+    close(in);
+    close(out);
+    return ok && length == 0;
+}
+
+static uint16_t PickFreePort() {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(s, (sockaddr*)&address, sizeof(address));
+
+    socklen_t length = sizeof(address);
+    getsockname(s, (sockaddr*)&address, &length);
+    close(s);
+    return ntohs(address.sin_port);
+}
+
+static bool WaitForServer(uint16_t port) {
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int s = Connect(port);
+        if (s >= 0) {
+            close(s);
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return false;
+}
+
+static void PrintLatency(const char* label, const LatencyHistogram::Snapshot& snapshot) {
+    printf("%-10s p50 %8.1fus  p90 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus\n", label, snapshot.ValueAtQuantile(0.5) / 1e3,
+        snapshot.ValueAtQuantile(0.9) / 1e3, snapshot.ValueAtQuantile(0.99) / 1e3, snapshot.ValueAtQuantile(0.999) / 1e3, snapshot.max / 1e3);
+}
+
+static int RunLoad(const Options& options) {
+    char self[4096];
+    ssize_t selfLength = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (selfLength <= 0) return 1;
+    const std::string trustedExecutable(self, (size_t)selfLength);
+
+    /** A copy has the same contents but a different inode, so the gate has to tell the two apart by identity. */
+    const std::string untrustedExecutable = "/tmp/praesidium_load_untrusted_" + std::to_string(getpid());
+    if (options.untrusted > 0 && !CopyFile(trustedExecutable, untrustedExecutable)) {
+        fprintf(stderr, "praesidium_load: can't copy %s to %s\n", trustedExecutable.c_str(), untrustedExecutable.c_str());
+        return 1;
+    }
+
+    const uint16_t port = options.port ? options.port : PickFreePort();
+    const std::string portArgument = std::to_string(port);
+
+    std::vector<std::string> serverEnvironment;
+    if (options.gate) {
+        serverEnvironment.push_back("LD_PRELOAD=" + options.preload);
+        serverEnvironment.push_back("PRAESIDIUM_TRUSTED_EXE=" + trustedExecutable);
+        serverEnvironment.push_back("PRAESIDIUM_GATE=" + options.gateMode);
+    }
+    Child server = Spawn(trustedExecutable, { "server", portArgument, "--remote-debugging-port=" + portArgument }, serverEnvironment, false);
+    if (server.pid < 0 || !WaitForServer(port)) {
+        fprintf(stderr, "praesidium_load: the server didn't start\n");
+        if (server.pid > 0) kill(server.pid, SIGKILL);
+        unlink(untrustedExecutable.c_str());
+        return 1;
+    }
+
+    const std::vector<std::string> clientArguments = { "client", portArgument, std::to_string(options.rate), std::to_string(options.duration), std::to_string(options.messages) };
+    std::vector<Child> clients;
+    for (int i = 0; i < options.trusted + options.untrusted; i++) {
+        bool trusted = i < options.trusted;
+        Child client = Spawn(trusted ? trustedExecutable : untrustedExecutable, clientArguments, {}, true);
+        client.trusted = trusted;
+        clients.push_back(client);
+    }
+
+    ClientTotals totals[2];
+    std::unique_ptr<LatencyHistogram::Snapshot> latency[2] = { std::unique_ptr<LatencyHistogram::Snapshot>(new LatencyHistogram::Snapshot()),
+                                                               std::unique_ptr<LatencyHistogram::Snapshot>(new LatencyHistogram::Snapshot()) };
+    for (auto& snapshot : latency) memset(snapshot.get(), 0, sizeof(LatencyHistogram::Snapshot));
+
+    /** Each pipe has to be drained for its client to exit, they are read in order since every client runs for the same duration. */
+    for (Child& client : clients) {
+        std::string output = ReadAll(client.output);
+        waitpid(client.pid, nullptr, 0);
+
+        ClientTotals& classTotals = totals[client.trusted ? 0 : 1];
+        LatencyHistogram::Snapshot& classLatency = *latency[client.trusted ? 0 : 1];
+
+        const char* line = output.c_str();
+        while (*line) {
+            ClientTotals clientTotals;
+            size_t index;
+            uint64_t count;
+            if (sscanf(line, "totals %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64, &clientTotals.connections, &clientTotals.served,
+                    &clientTotals.blocked, &clientTotals.errors, &clientTotals.requests) == 5) {
+                classTotals.connections += clientTotals.connections;
+                classTotals.served += clientTotals.served;
+                classTotals.blocked += clientTotals.blocked;
+                classTotals.errors += clientTotals.errors;
+                classTotals.requests += clientTotals.requests;
+            } else if (sscanf(line, "bucket %zu %" SCNu64, &index, &count) == 2 && index < LatencyHistogram::BUCKET_COUNT) {
+                classLatency.counts[index] += count;
+                classLatency.count += count;
+                uint64_t bound = LatencyHistogram::BucketUpperBound(index);
+                if (bound > classLatency.max) classLatency.max = bound;
+            }
+
+            const char* next = strchr(line, '\n');
+            if (!next) break;
+            line = next + 1;
+        }
+    }
+
+    kill(server.pid, SIGTERM);
+    waitpid(server.pid, nullptr, 0);
+    unlink(untrustedExecutable.c_str());
+
+    const char* labels[2] = { "trusted", "untrusted" };
+    printf("gate %s, %d trusted and %d untrusted clients at %.0f connections/s each for %.1fs\n\n", options.gate ? options.gateMode.c_str() : "off",
+        options.trusted, options.untrusted, options.rate, options.duration);
+    for (int i = 0; i < 2; i++) {
+        printf("%-10s connections %" PRIu64 ", served %" PRIu64 ", blocked %" PRIu64 ", errors %" PRIu64 ", %.0f requests/s\n", labels[i], totals[i].connections,
+            totals[i].served, totals[i].blocked, totals[i].errors, totals[i].requests / options.duration);
+    }
+    printf("\n");
+    PrintLatency("trusted", *latency[0]);
+
+    /** With the gate on, trusted clients must never be blocked and untrusted ones must never be served. */
+    bool correct = totals[0].blocked == 0 && (!options.gate || totals[1].served == 0);
+    printf("\nblock correctness: %s (trusted blocked %" PRIu64 ", untrusted served %" PRIu64 ")\n", correct ? "ok" : "FAILED", totals[0].blocked, totals[1].served);
+    return correct ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "server") == 0) {
+        return RunServer((uint16_t)atoi(argv[2]));
+    }
+    if (argc >= 6 && strcmp(argv[1], "client") == 0) {
+        return RunClient((uint16_t)atoi(argv[2]), atof(argv[3]), atof(argv[4]), atoi(argv[5]));
+    }
+
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        const char* argument = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (strcmp(argument, "--no-gate") == 0) { options.gate = false; continue; }
+        if (!value) {
+            fprintf(stderr, "praesidium_load: %s needs a value\n", argument);
+            return 2;
+        }
+
+        if (strcmp(argument, "--trusted") == 0) options.trusted = atoi(value);
+        else if (strcmp(argument, "--untrusted") == 0) options.untrusted = atoi(value);
+        else if (strcmp(argument, "--rate") == 0) options.rate = atof(value);
+        else if (strcmp(argument, "--duration") == 0) options.duration = atof(value);
+        else if (strcmp(argument, "--messages") == 0) options.messages = atoi(value);
+        else if (strcmp(argument, "--port") == 0) options.port = (uint16_t)atoi(value);
+        else if (strcmp(argument, "--preload") == 0) options.preload = value;
+        else if (strcmp(argument, "--gate") == 0) options.gateMode = value;
+        else {
+            fprintf(stderr, "praesidium_load: unknown option %s\n", argument);
+            return 2;
+        }
+        i++;
+    }
+
+    if (options.rate <= 0 || options.duration <= 0) {
+        fprintf(stderr, "praesidium_load: --rate and --duration have to be positive\n");
+        return 2;
+    }
+    return RunLoad(options);
+}
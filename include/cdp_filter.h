@@ -0,0 +1,232 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <websocket_frames.h>
+
+/**
+ * The DevTools protocol methods that peers in restricted mode can call, looked up through a perfect hash built at compile time.
+ * Every other method is denied, including ones added to the protocol later.
+ *
+ * The list only has methods that inspect the page without changing it or running anything in it: the DOM and styles, the frame tree,
+ * console and log messages, performance counters. Runtime.getProperties isn't in it, reading a property can run a getter.
+ * Nothing touches the network, cookies, storage, input, script sources or breakpoints, or reaches another target.
+ */
+namespace CdpMethods {
+    constexpr std::string_view ALLOWED[] = {
+        "Browser.getVersion",
+        "Schema.getDomains",
+        "Inspector.enable",
+        "Inspector.disable",
+        "Runtime.enable",
+        "Runtime.disable",
+        "Runtime.discardConsoleEntries",
+        "Runtime.getHeapUsage",
+        "Runtime.getIsolateId",
+        "Runtime.releaseObject",
+        "Runtime.releaseObjectGroup",
+        "Log.enable",
+        "Log.disable",
+        "Log.clear",
+        "Console.enable",
+        "Console.disable",
+        "Performance.enable",
+        "Performance.disable",
+        "Performance.getMetrics",
+        "Memory.getDOMCounters",
+        "Page.enable",
+        "Page.disable",
+        "Page.getFrameTree",
+        "Page.getLayoutMetrics",
+        "Page.getNavigationHistory",
+        "DOM.enable",
+        "DOM.disable",
+        "DOM.getDocument",
+        "DOM.requestChildNodes",
+        "DOM.describeNode",
+        "DOM.querySelector",
+        "DOM.querySelectorAll",
+        "DOM.getAttributes",
+        "DOM.getBoxModel",
+        "DOM.getOuterHTML",
+        "CSS.enable",
+        "CSS.disable",
+        "CSS.getComputedStyleForNode",
+        "CSS.getInlineStylesForNode",
+        "CSS.getMatchedStylesForNode",
+        "Overlay.enable",
+        "Overlay.disable",
+        "Overlay.highlightNode",
+        "Overlay.hideHighlight",
+        "Target.getTargetInfo",
+        "Target.getTargets"
+    };
+
+    constexpr size_t ALLOWED_COUNT = sizeof(ALLOWED) / sizeof(ALLOWED[0]);
+    constexpr size_t TABLE_SIZE = 256;
+    constexpr uint8_t EMPTY_SLOT = 0xFF;
+
+    static_assert(ALLOWED_COUNT < TABLE_SIZE && ALLOWED_COUNT < EMPTY_SLOT, "the allow list doesn't fit its table");
+
+    /** FNV-1a, with a seed mixed in so a seed without collisions can be searched for. */
+    constexpr uint32_t Hash(std::string_view name, uint32_t seed) {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : name) {
+            hash ^= (uint8_t)c;
+            hash *= 16777619u;
+        }
+        return hash ^ (hash >> 15);
+    }
+
+    constexpr bool IsPerfect(uint32_t seed) {
+        bool used[TABLE_SIZE] = {};
+        for (size_t i = 0; i < ALLOWED_COUNT; i++) {
+            uint32_t slot = Hash(ALLOWED[i], seed) & (TABLE_SIZE - 1);
+            if (used[slot]) return false;
+            used[slot] = true;
+        }
+        return true;
+    }
+
+    constexpr uint32_t FindSeed() {
+        for (uint32_t seed = 1; seed < 100000; seed++) {
+            if (IsPerfect(seed)) return seed;
+        }
+        return 0;
+    }
+
+    constexpr uint32_t SEED = FindSeed();
+    static_assert(SEED != 0, "no seed hashes the allow list without collisions, grow TABLE_SIZE");
+
+    struct Table {
+        uint8_t slots[TABLE_SIZE];
+        size_t longest;
+    };
+
+    constexpr Table BuildTable() {
+        Table table = {};
+        for (size_t i = 0; i < TABLE_SIZE; i++) table.slots[i] = EMPTY_SLOT;
+        for (size_t i = 0; i < ALLOWED_COUNT; i++) {
+            table.slots[Hash(ALLOWED[i], SEED) & (TABLE_SIZE - 1)] = (uint8_t)i;
+            if (ALLOWED[i].size() > table.longest) table.longest = ALLOWED[i].size();
+        }
+        return table;
+    }
+
+    constexpr Table TABLE = BuildTable();
+
+    /** @return The length of the longest entry, method names longer than that are always denied. */
+    constexpr size_t LongestEntry() { return TABLE.longest; }
+
+    /**
+     * @param method The method of a message, e.g. "DOM.getDocument". Compared case-sensitively, like the protocol does.
+     * @return true unless the method is on the allow list.
+     */
+    constexpr bool IsDenied(std::string_view method) {
+        if (method.size() > TABLE.longest) return true;
+
+        uint8_t index = TABLE.slots[Hash(method, SEED) & (TABLE_SIZE - 1)];
+        return index == EMPTY_SLOT || ALLOWED[index] != method;
+    }
+
+    static_assert(!IsDenied("Runtime.enable") && !IsDenied("DOM.getDocument") && IsDenied("Runtime.evaluate") && IsDenied("Fetch.enable")
+        && IsDenied("Debugger.setBreakpoint") && IsDenied("Debugger.setBreakpointByUrl") && IsDenied("Page.reload")
+        && IsDenied("DOM.setAttributeValue") && IsDenied("DOM.setAttributesAsText") && IsDenied("Runtime.queryObjects")
+        && IsDenied("Runtime.getProperties") && IsDenied("runtime.enable") && IsDenied("Runtime.enable2") && IsDenied(""),
+        "the allow list lookup is broken");
+}
+
+/**
+ * Streaming scanner of one DevTools protocol message (JSON), finding the "method" members of its top-level object.
+ *
+ * Only the structure of the message is followed: strings are skipped with SIMD up to their closing quote, and everything outside of them
+ * up to the next quote, brace, bracket or comma. A method value is kept in a small fixed buffer while it is compared against the allow list.
+ *
+ * Whatever could make the protocol's own parser see a different method than we do is refused: escapes in top-level keys or in a method,
+ * comments, a top-level value that isn't an object, anything after it, and a message that ends before its object does.
+ */
+class CdpMethodScanner {
+public:
+    /** Start scanning a new message. */
+    void Start();
+
+    /**
+     * Scan the next piece of the message.
+     *
+     * @param data The unmasked bytes.
+     * @param length How many bytes.
+     */
+    void Feed(const char* data, size_t length);
+
+    /**
+     * End the message.
+     *
+     * @return true if the message can go through, false if it calls a method that isn't allowed or was refused.
+     */
+    bool Finish();
+
+    /** @return true once the message called a denied method or was refused, which is already known before it ends. */
+    bool Denied() const { return denied || refused; }
+
+private:
+    /** What the string being scanned is. */
+    enum class Role : uint8_t {
+        Other,
+        Key,
+        Method
+    };
+
+    static constexpr size_t METHOD_CAPACITY = 64;
+    static_assert(METHOD_CAPACITY >= CdpMethods::LongestEntry(), "the method buffer can't hold every allowed method");
+
+    void StringContent(const char* data, size_t length);
+    void EndString();
+    void Structural(char c);
+
+    uint32_t depth = 0;
+    bool started = false;
+    bool done = false;
+    bool inString = false;
+    bool escapePending = false;
+    Role role = Role::Other;
+    /** At depth 1 the next string is a key (after the opening brace or a comma). */
+    bool expectKey = false;
+    /** The key just read was "method", so the next value at depth 1 is a method. */
+    bool methodValue = false;
+    /** How much of the current key was read, and whether it is still "method" so far. */
+    uint8_t keyLength = 0;
+    bool keyMatches = false;
+    uint8_t methodLength = 0;
+    bool methodOverflow = false;
+    char method[METHOD_CAPACITY];
+    bool denied = false;
+    bool refused = false;
+};
+
+/**
+ * Follows the WebSocket side of a DevTools connection and checks every message against the allow list.
+ * Binary messages are refused, the protocol is text and a binary message could carry CBOR that we don't parse.
+ */
+class CdpFilter : private WebSocketFrameParser::Sink {
+public:
+    /**
+     * Inspect the next bytes of the connection.
+     *
+     * @param data The bytes, exactly as they were read.
+     * @param length How many bytes were read.
+     * @return false once the connection sent a denied method, or something that couldn't be inspected.
+     */
+    bool Feed(const char* data, size_t length);
+
+    /** @return true once the connection sent a denied method, or something that couldn't be inspected. */
+    bool Denied() const { return denied; }
+
+private:
+    void OnMessageStart(WebSocketFrameParser::Opcode opcode) override;
+    void OnMessageData(const char* data, size_t length) override;
+    void OnMessageEnd() override;
+
+    WebSocketFrameParser frames;
+    CdpMethodScanner methods;
+    bool denied = false;
+};
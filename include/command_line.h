@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The arguments of a process, split once and indexed by switch name.
+ *
+ * Every argument and value is a view into the command line, which the table owns and never changes, so parsing copies nothing
+ * and a lookup is one hash of the name. Switches are the arguments starting with '-', indexed by the part before '=':
+ * "-steampath=C:\Steam\steam.exe" is found as "-steampath" and "-dev" as "-dev". Only the first of repeated switches is kept,
+ * like the scans of the raw command line that this replaces.
+ */
+class CommandLine {
+public:
+    CommandLine(CommandLine&&) = default;
+    CommandLine& operator=(CommandLine&&) = default;
+
+    /**
+     * Parse a Windows command line (GetCommandLineW, converted to UTF-8).
+     *
+     * Arguments are separated by whitespace outside of double quotes, and the quotes around a whole argument or a whole value are
+     * dropped. Backslash escapes aren't interpreted. Steam passes some paths unquoted even when they have spaces in them, so
+     * the unquoted value of a switch only ends at whitespace that is followed by another switch, or that follows ".exe".
+     *
+     * @param line The command line.
+     */
+    static CommandLine FromWindows(std::string line);
+
+    /**
+     * Parse a command line made of arguments that each end with a NUL byte, as read from /proc/<pid>/cmdline.
+     *
+     * @param text The command line. A missing NUL after the last argument is tolerated.
+     */
+    static CommandLine FromNullSeparated(std::string text);
+
+    /** @return The number of arguments, including the program. */
+    size_t Size() const { return arguments.size(); }
+
+    /** @return An argument, with its quotes dropped. */
+    std::string_view operator[](size_t index) const { return arguments[index]; }
+
+    /**
+     * @param name The switch, with its dashes: "-dev".
+     * @return true if the switch was passed, with or without a value.
+     */
+    bool Has(std::string_view name) const;
+
+    /**
+     * @param name The switch, with its dashes and without the '=': "-steampath".
+     * @param value Receives the value of the switch, empty if it was passed without one.
+     * @return true if the switch was passed.
+     */
+    bool Get(std::string_view name, std::string_view& value) const;
+
+private:
+    explicit CommandLine(std::string text);
+
+    /** Make room for up to count arguments, so building the table allocates once per container. */
+    void Reserve(size_t count);
+
+    /**
+     * Add an argument, and index it if it is a switch.
+     *
+     * @param argument The argument.
+     * @param stripQuotes Whether quotes around the argument or its value are dropped, which they are on Windows only.
+     */
+    void Add(std::string_view argument, bool stripQuotes);
+
+    /** Held through a pointer so the views stay valid when the table is moved. */
+    std::unique_ptr<const std::string> text;
+    std::vector<std::string_view> arguments;
+    std::unordered_map<std::string_view, std::string_view> switches;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <command_line.h>
+
+/**
+ * The local port of the DevTools listener, which is the only port that needs gating.
+ *
+ * Every other socket of the process (update checks, CDN downloads, ...) is passed through after comparing its local port
+ * against this one. Until the port is known every socket is gated, so not knowing it is never less safe than not scoping at all.
+ */
+class DebuggerPort {
+public:
+    /**
+     * Set the port from configuration, e.g. the --remote-debugging-port argument. Takes precedence over a learned port.
+     *
+     * @param port The listener port, 0 is ignored.
+     */
+    void Configure(uint16_t port);
+
+    /**
+     * Learn the port from a listening socket. Only the first port learned sticks, and only if none was configured.
+     *
+     * @param port The local port of a socket that started listening on loopback.
+     * @return true if this port is now the debugger port.
+     */
+    bool Learn(uint16_t port);
+
+    /** @return The debugger port, or 0 if it isn't known yet. */
+    uint16_t Get() const { return port.load(std::memory_order_relaxed); }
+
+    /**
+     * Check whether a socket has to go through the gate.
+     *
+     * @param localPort The local port of the socket, in host byte order.
+     * @return true if the socket belongs to the debugger listener, or if the listener port isn't known yet.
+     */
+    bool ShouldGate(uint16_t localPort) const {
+        uint16_t current = Get();
+        return current == 0 || current == localPort;
+    }
+
+private:
+    std::atomic<uint16_t> port{0};
+};
+
+/**
+ * Find the --remote-debugging-port argument in a command line.
+ *
+ * @param commandLine The command line.
+ * @param port Receives the port. Chromium picks a free port when it is 0.
+ * @return true if the argument was found with a valid port.
+ */
+bool ParseRemoteDebuggingPort(const CommandLine& commandLine, uint16_t& port);
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <resolve_trace.h>
+#include <verdict_cache.h>
+
+/**
+ * One verdict, as written to the decision log. The layout is the on-disk format, so fields are only ever appended
+ * (into the reserved space) and the version in the file header is bumped when their meaning changes.
+ */
+struct DecisionRecord {
+    /** Nanoseconds since the Unix epoch. */
+    uint64_t timestamp;
+    uint64_t socket;
+    /** Our end of the connection is local, the peer's end is remote. Host byte order. */
+    uint32_t localIP;
+    uint32_t remoteIP;
+    uint16_t localPort;
+    uint16_t remotePort;
+    uint32_t owningPid;
+    uint8_t verdict;
+    uint8_t reserved[3];
+    uint32_t phaseNanoseconds[RESOLVE_PHASE_COUNT];
+    uint32_t totalNanoseconds;
+};
+
+static_assert(sizeof(DecisionRecord) == 64, "DecisionRecord is an on-disk format");
+
+/** Header at the start of every log file. */
+struct DecisionLogHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t phaseCount;
+    uint32_t reserved;
+};
+
+static constexpr char DECISION_LOG_MAGIC[4] = { 'P', 'R', 'D', 'L' };
+static constexpr uint16_t DECISION_LOG_VERSION = 1;
+
+/**
+ * Bounded lock-free multi-producer queue of decision records (Vyukov's bounded queue, used with a single consumer).
+ * Pushing never blocks and never allocates: when the ring is full the record is refused and the caller counts it as dropped.
+ */
+class DecisionRing {
+public:
+    /** @param capacity The number of records the ring holds, rounded up to a power of two. */
+    explicit DecisionRing(size_t capacity);
+
+    DecisionRing(const DecisionRing&) = delete;
+    DecisionRing& operator=(const DecisionRing&) = delete;
+
+    /** @return false if the ring is full. */
+    bool TryPush(const DecisionRecord& record);
+
+    /** @return false if the ring is empty. */
+    bool TryPop(DecisionRecord& record);
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        DecisionRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) std::atomic<size_t> dequeuePosition{0};
+};
+
+/**
+ * Records every verdict into a DecisionRing and has a background thread write them to a rotating binary log.
+ * The thread deciding the verdict only copies a 64 byte record into the ring, all file I/O happens on the writer thread.
+ *
+ * The log is written to <directory>/praesidium.log. Once it reaches the size limit it is renamed to praesidium.1.log
+ * (replacing the previous one) and a new file is started, so the logs never take more than twice the limit.
+ */
+class DecisionLog {
+public:
+    DecisionLog(std::string directory, size_t ringCapacity = 4096, uint64_t maxFileBytes = 4 * 1024 * 1024);
+    ~DecisionLog();
+
+    DecisionLog(const DecisionLog&) = delete;
+    DecisionLog& operator=(const DecisionLog&) = delete;
+
+    /**
+     * Record a verdict along with what the resolution found.
+     *
+     * @param socket The socket the verdict is for.
+     * @param verdict The verdict.
+     * @param trace The trace of the resolution that decided it.
+     * @param totalNanoseconds How long the whole decision took.
+     */
+    void Record(uint64_t socket, Verdict verdict, const ResolveTrace& trace, uint64_t totalNanoseconds);
+
+    /**
+     * Stop the writer after it wrote out everything still in the ring.
+     *
+     * @param join Whether to wait for the writer to exit, which can't be done under the Windows loader lock.
+     */
+    void Shutdown(bool join = true);
+
+    /** @return How many records were dropped because the ring was full. */
+    uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+    /** @return How many records were written to disk. */
+    uint64_t Written() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    void WriterLoop();
+    bool OpenFile();
+    void Rotate();
+
+    std::string directory;
+    std::string path;
+    std::string rotatedPath;
+    uint64_t maxFileBytes;
+
+    DecisionRing ring;
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<bool> stopping{false};
+
+    /** Only touched by the writer thread. */
+    FILE* file = nullptr;
+    uint64_t fileBytes = 0;
+
+    std::thread writer;
+};
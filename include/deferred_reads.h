@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <verdict_cache.h>
+
+/**
+ * Reads that were issued on a socket before its verdict was known, parked until the resolver publishes it.
+ *
+ * An overlapped read is issued from a completion port thread that must never wait, so instead of waiting on the verdict
+ * the read is parked here and the call reports that the I/O is pending. Once the verdict is published the read is resumed on the publishing
+ * (resolver) thread: allowed reads are issued for real and complete through the normal completion path, blocked ones are completed with an error.
+ *
+ * Socket handles are treated as opaque integers, like in SocketVerdictTable.
+ */
+class DeferredReads {
+public:
+    /**
+     * Resumes a parked read.
+     * Called with Verdict::Allow, Verdict::Block, Verdict::Drop or Verdict::Restrict once the verdict is published,
+     * or with Verdict::Unknown if the socket is being closed, in which case the read has to be completed as aborted without touching the socket.
+     */
+    using Resume = std::function<void(Verdict verdict)>;
+
+    /**
+     * Park a read until the verdict in the slot is published.
+     *
+     * @param socket The socket the read was issued on.
+     * @param slot The slot the socket's verdict gets published into.
+     * @param resume Resumes the read.
+     * @return true if the read was parked, false if the verdict was published in the meantime (the caller then goes on with the read itself).
+     */
+    bool Defer(uint64_t socket, const std::shared_ptr<VerdictSlot>& slot, Resume resume);
+
+    /**
+     * Resume every read parked on a socket with Verdict::Unknown. This has to be called when the socket is closed, before its verdict is evicted.
+     *
+     * @param socket The socket being closed.
+     * @return The number of reads that were resumed.
+     */
+    size_t Cancel(uint64_t socket);
+
+    /** @return The number of reads currently parked. */
+    size_t Size() const;
+
+private:
+    struct Entry {
+        /** The slot the reads wait on. A socket handle can be reused, the slot tells two connections with the same handle apart. */
+        std::shared_ptr<VerdictSlot> slot;
+        std::vector<Resume> reads;
+    };
+
+    void Release(uint64_t socket, const VerdictSlot* slot, Verdict verdict);
+
+    mutable std::mutex lock;
+    std::unordered_map<uint64_t, Entry> entries;
+    size_t parked = 0;
+};
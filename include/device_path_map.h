@@ -0,0 +1,118 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/** Maps a device namespace prefix (e.g. "\Device\HarddiskVolume3") to the DOS prefix it is mounted as (e.g. "C:"). */
+struct DevicePrefix {
+    std::string device;
+    std::string dos;
+};
+
+/**
+ * An immutable prefix table translating device paths into DOS paths.
+ * Prefixes are grouped by length and looked up longest first, so a lookup costs one hash probe per distinct prefix length
+ * instead of a compare against every entry.
+ */
+class DevicePathTable {
+public:
+    DevicePathTable(std::vector<DevicePrefix> prefixes, uint64_t signature);
+    /** The index holds views into the prefix strings, so the table can't be copied. */
+    DevicePathTable(const DevicePathTable&) = delete;
+    DevicePathTable& operator=(const DevicePathTable&) = delete;
+
+    /**
+     * Translate a device path using the longest prefix that matches it on a path component boundary.
+     *
+     * @param path The device path to translate.
+     * @param out A buffer to receive the translated, null terminated path.
+     * @param outSize The size of the buffer.
+     * @return true if a prefix matched and the result fit into the buffer.
+     */
+    bool Translate(std::string_view path, char* out, size_t outSize) const;
+
+    uint64_t Signature() const { return signature; }
+    size_t Size() const { return prefixes.size(); }
+
+private:
+    std::vector<DevicePrefix> prefixes;
+    std::unordered_map<std::string_view, size_t> index;
+    std::vector<size_t> lengths;
+    uint64_t signature;
+};
+
+/**
+ * Keeps a DevicePathTable up to date with the volumes mounted on the system.
+ *
+ * Building the table is expensive (one QueryDosDevice per drive on Windows), so it is only rebuilt when the volume set signature changes,
+ * or at most once per refresh interval when a device path doesn't match any known prefix.
+ */
+class DevicePathMap {
+public:
+    /** Fills the vector with every device prefix currently mounted. */
+    using Loader = std::function<bool(std::vector<DevicePrefix>& prefixes)>;
+    /** Returns a value that changes whenever the set of mounted volumes changes. It is called on every lookup, so it has to be cheap. */
+    using SignatureSource = std::function<uint64_t()>;
+
+    DevicePathMap(Loader loader, SignatureSource signatureSource, std::chrono::milliseconds missRefreshInterval = std::chrono::seconds(1));
+
+    /**
+     * Translate a device path into a DOS path.
+     *
+     * @param path The device path to translate.
+     * @param out A buffer to receive the translated, null terminated path.
+     * @param outSize The size of the buffer.
+     * @return true if the path was translated.
+     */
+    bool Translate(std::string_view path, char* out, size_t outSize);
+
+    /** @return The current table, building it if needed. */
+    std::shared_ptr<const DevicePathTable> Current();
+
+    /** @return How many times the table has been built. */
+    uint64_t LoadCount() const;
+
+private:
+    std::shared_ptr<const DevicePathTable> Acquire(uint64_t signature);
+    std::shared_ptr<const DevicePathTable> Rebuild(uint64_t signature);
+
+    Loader loader;
+    SignatureSource signatureSource;
+    std::chrono::milliseconds missRefreshInterval;
+
+    mutable std::mutex lock;
+    std::shared_ptr<const DevicePathTable> table;
+    std::chrono::steady_clock::time_point lastBuild;
+    bool lastBuildFailed = false;
+    uint64_t loadCount = 0;
+};
+
+/**
+ * Load the device prefixes of the current system.
+ * On Windows these are the targets of every drive letter. On Linux they come from /proc/self/mountinfo, mapping the mount source
+ * plus the mounted root (e.g. "/dev/sda2/home") to the mount point (e.g. "/home").
+ */
+bool LoadSystemDevicePrefixes(std::vector<DevicePrefix>& prefixes);
+
+#ifndef _WIN32
+/**
+ * Parse the contents of a mountinfo file into device prefixes, see LoadSystemDevicePrefixes. Lines that aren't block device mounts are skipped.
+ *
+ * @param content The whole file.
+ * @param prefixes Receives a prefix per block device mount, in the order of the file.
+ */
+void ParseMountInfo(std::string_view content, std::vector<DevicePrefix>& prefixes);
+#endif
+
+/**
+ * Get a value that changes whenever volumes are mounted or unmounted.
+ * On Windows this is the logical drive bitmask. On Linux it is a counter bumped when /proc/self/mountinfo reports a change through poll().
+ */
+uint64_t GetVolumeSetSignature();
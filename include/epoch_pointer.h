@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * A pointer to an immutable value that is replaced as a whole, RCU style: readers never take a lock or allocate,
+ * the writer publishes a new value and frees the old one once no reader can still be using it.
+ *
+ * Readers register in the counter of the current epoch. Publishing swaps the pointer, moves to the next epoch and waits
+ * for the counter of the previous one to drain, so only readers that may have loaded the old pointer are waited for.
+ * Read sections must be short, a writer spins until they end.
+ */
+template <typename T>
+class EpochPointer {
+public:
+    /** Keeps the value it was handed alive until it is destroyed. */
+    class ReadGuard {
+    public:
+        ReadGuard(ReadGuard&& other) : counter(other.counter), value(other.value) {
+            other.counter = nullptr;
+            other.value = nullptr;
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard() {
+            if (counter) counter->fetch_sub(1, std::memory_order_release);
+        }
+
+        const T* Get() const { return value; }
+        const T* operator->() const { return value; }
+        explicit operator bool() const { return value != nullptr; }
+
+    private:
+        friend class EpochPointer;
+        ReadGuard(std::atomic<uint32_t>* counter, const T* value) : counter(counter), value(value) {}
+
+        std::atomic<uint32_t>* counter;
+        const T* value;
+    };
+
+    EpochPointer() = default;
+    ~EpochPointer() { delete current.load(std::memory_order_acquire); }
+
+    EpochPointer(const EpochPointer&) = delete;
+    EpochPointer& operator=(const EpochPointer&) = delete;
+
+    /** @return A guard on the current value, which may be null. */
+    ReadGuard Read() const {
+        for (;;) {
+            uint64_t observed = epoch.load(std::memory_order_seq_cst);
+            std::atomic<uint32_t>& counter = readers[observed & 1].count;
+            counter.fetch_add(1, std::memory_order_seq_cst);
+
+            /** The writer moved on between the two loads, it may not wait for this counter anymore. */
+            if (epoch.load(std::memory_order_seq_cst) != observed) {
+                counter.fetch_sub(1, std::memory_order_release);
+                continue;
+            }
+            return ReadGuard(&counter, current.load(std::memory_order_acquire));
+        }
+    }
+
+    /**
+     * Replace the value, freeing the previous one once its last reader is done. Writers are serialized.
+     *
+     * @param next The new value, may be null.
+     */
+    void Publish(std::unique_ptr<const T> next) {
+        std::lock_guard<std::mutex> guard(writer);
+
+        const T* previous = current.exchange(next.release(), std::memory_order_acq_rel);
+        uint64_t observed = epoch.fetch_add(1, std::memory_order_seq_cst);
+
+        while (readers[observed & 1].count.load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+        delete previous;
+    }
+
+private:
+    /** Each counter on its own cache line, readers of one epoch don't slow down the other. */
+    struct alignas(64) Readers {
+        std::atomic<uint32_t> count{0};
+    };
+
+    mutable Readers readers[2];
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<const T*> current{nullptr};
+    std::mutex writer;
+};
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <file_identity.h>
+#include <process_path.h>
+#include <sha256.h>
+
+/**
+ * What a file is and which version of it: its identity, size and a mark of its last change.
+ *
+ * The owner of a file can set its write time back to anything, so the mark is one only the system moves: the status change time
+ * on Linux, which every write and every change of times sets to the current time, and the USN the change journal gave
+ * the last change on Windows. A digest cached under a stamp stays valid for as long as the stamp does.
+ */
+struct FileStamp {
+    FileIdentity identity;
+    uint64_t size = 0;
+    /** 0 if the change can't be told: on a Windows volume without a change journal, or right after a change on Linux. */
+    uint64_t changed = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return identity == other.identity && size == other.size && changed == other.changed;
+    }
+};
+
+struct FileStampHash {
+    size_t operator()(const FileStamp& stamp) const {
+        uint64_t hash = FileIdentityHash()(stamp.identity) ^ (stamp.changed * 0x9E3779B97F4A7C15ull) ^ stamp.size;
+        return (size_t)(hash ^ (hash >> 29));
+    }
+};
+
+/**
+ * SHA-256 digests of executables, cached by FileStamp so each binary is hashed once per change.
+ *
+ * A file is opened and stamped on every call, which is a couple of system calls. Only a file whose stamp isn't cached is read,
+ * by mapping it a piece at a time and hashing straight from the mapping. The lock is only held around the cache, not while hashing.
+ * A file whose last change can't be told is hashed every time.
+ */
+class FileHashCache {
+public:
+    struct Counters {
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    /** @param capacity The number of digests kept. When it is reached the cache starts over. */
+    explicit FileHashCache(size_t capacity = 64);
+
+    /**
+     * Get the digest of a file.
+     *
+     * @param path The file.
+     * @param digest Receives the digest.
+     * @return false if the file couldn't be opened or read.
+     */
+    bool Hash(const char* path, Sha256Digest& digest);
+
+    /**
+     * Get the digest of the executable a process was started from.
+     * On Linux it is read through /proc/<pid>/exe, which keeps pointing at the file the process was started from.
+     * On Windows it is read from the path the process was started from, and only if the file there is still the image of the process:
+     * a running executable can be renamed and another file put in its place.
+     *
+     * @param processId The process.
+     * @param image Its image, as resolved by SocketProcessResolver.
+     * @param digest Receives the digest.
+     * @return false if the executable couldn't be opened or read.
+     */
+    bool HashProcessImage(uint32_t processId, const ProcessImage& image, Sha256Digest& digest);
+
+    Counters GetCounters() const;
+
+private:
+    /** @return true if a digest is cached under the stamp. */
+    bool Lookup(const FileStamp& stamp, Sha256Digest& digest);
+    void Store(const FileStamp& stamp, const Sha256Digest& digest);
+
+    size_t capacity;
+    mutable std::mutex lock;
+    std::unordered_map<FileStamp, Sha256Digest, FileStampHash> digests;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
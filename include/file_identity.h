@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Identifies a file independently of the path used to reach it: the volume serial number and file index on Windows,
+ * the device and inode numbers on Linux. Two paths name the same file exactly when their identities are equal,
+ * so comparing identities replaces normalising and comparing path strings.
+ */
+struct FileIdentity {
+    uint64_t volume = 0;
+    uint64_t index = 0;
+
+    bool IsValid() const { return volume != 0 || index != 0; }
+
+    bool operator==(const FileIdentity& other) const { return volume == other.volume && index == other.index; }
+    bool operator!=(const FileIdentity& other) const { return !(*this == other); }
+};
+
+struct FileIdentityHash {
+    size_t operator()(const FileIdentity& identity) const {
+        uint64_t hash = (identity.volume * 0x9E3779B97F4A7C15ull) ^ identity.index;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        return (size_t)(hash ^ (hash >> 31));
+    }
+};
+
+/**
+ * Get the identity of the file at a path.
+ *
+ * @param path The path of the file.
+ * @param identity Receives the identity of the file.
+ * @return true if successful, false if the file doesn't exist or can't be opened.
+ */
+bool GetFileIdentity(const char* path, FileIdentity& identity);
+
+/**
+ * Get the identity of the executable image a process was started from.
+ * On Linux this is read straight from /proc/<pid>/exe, which keeps pointing at the original file even if it is renamed.
+ * On Windows it is the file now at the path the process was started from. A running executable can be renamed and another file
+ * put in its place, so there it only identifies the image together with that path, see SecurityCheck::IsSteamProcess.
+ *
+ * @param processId The ID of the process.
+ * @param identity Receives the identity of the executable.
+ * @return true if successful, false if the process doesn't exist or can't be queried.
+ */
+bool GetProcessFileIdentity(uint32_t processId, FileIdentity& identity);
+
+#ifdef _WIN32
+#include <string>
+
+/**
+ * Get the path of a file as the file system spells it, which is how Windows reports the path a process was started from.
+ *
+ * @param path The path of the file.
+ * @param finalPath Receives the path, as UTF-8 and without the \\?\ prefix.
+ * @return true if successful, false if the file doesn't exist or can't be opened.
+ */
+bool GetFinalPath(const char* path, std::string& finalPath);
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <cdp_filter.h>
+
+/**
+ * What the bytes read from a connection mean for the gate.
+ * Pass: nothing read so far asks for a DevTools endpoint, the bytes can be handed over without a verdict.
+ * Gate: the connection asked for /json or /devtools, or for a WebSocket upgrade. It needs its verdict.
+ * Deny: the connection sent something we can't follow, or a DevTools method that is denied in restricted mode (see CdpFilter).
+ * It needs its verdict too, and a restricted peer can't have it.
+ */
+enum class HttpScan : uint8_t {
+    Pass,
+    Gate,
+    Deny
+};
+
+/**
+ * Incremental scanner of the HTTP/1.1 requests sent over one connection, fed with the buffers recv already filled.
+ *
+ * Nothing is copied or buffered: a request line or header split across reads is picked up where the last read stopped,
+ * and only the first bytes of the target and of each header name are kept. The rest of each line is skipped with SIMD
+ * (SSE2 where available) looking for the next space or line end.
+ *
+ * A request is gated if its target starts with /json or /devtools (compared case-insensitively), if it isn't a path, or if it has
+ * an Upgrade header. Once gated a connection stays gated. Requests that pass are followed by the next one on the same connection,
+ * so a pipelined DevTools request is still caught. Anything that could throw us out of sync with the server's own parser
+ * is denied: a request with a body (Content-Length or Transfer-Encoding), or a malformed line.
+ *
+ * After the header block of an upgrade request the rest of the connection is WebSocket frames, which are handed to a CdpFilter.
+ *
+ * The server doesn't act on a request before its header block is complete, so passing the bytes of a request whose target
+ * isn't known yet is safe: the read that completes it is the one that gets gated.
+ */
+class HttpRequestScanner {
+public:
+    /**
+     * Scan the next bytes of the connection.
+     *
+     * @param data The bytes, exactly as they were read.
+     * @param length How many bytes were read.
+     * @return HttpScan::Deny or HttpScan::Gate if the connection needs its verdict, HttpScan::Pass otherwise.
+     */
+    HttpScan Feed(const char* data, size_t length);
+
+    /** @return true once the connection was upgraded to a WebSocket. */
+    bool Upgraded() const { return state == State::WebSocket; }
+
+    /** @return How many requests went by without needing a verdict. */
+    uint32_t PassedRequests() const { return passedRequests; }
+
+private:
+    enum class State : uint8_t {
+        /** Before or in the method, empty lines before a request are skipped. */
+        Method,
+        /** In the first bytes of the target, which are kept to be matched. */
+        TargetPrefix,
+        /** In the rest of the target, which is skipped. */
+        Target,
+        /** In the HTTP version, skipped up to the end of the request line. */
+        Version,
+        /** At the start of a header line or of the empty line ending the headers. */
+        LineStart,
+        /** In a header name, which is kept to be matched. */
+        HeaderName,
+        /** In a header value, skipped up to the end of the line. */
+        HeaderValue,
+        /** After the CR of the empty line ending the headers. */
+        HeadersEnd,
+        /** Past the header block of an upgrade request, in WebSocket frames. */
+        WebSocket,
+        /** Something we can't follow was sent. */
+        Invalid
+    };
+
+    /** Enough for "/devtools", the longest target prefix we match. */
+    static constexpr size_t TARGET_PREFIX_LENGTH = 9;
+    /** Enough for "transfer-encoding", the longest header name we match. */
+    static constexpr size_t HEADER_NAME_LENGTH = 17;
+
+    /** @return true if the target prefix kept so far asks for a DevTools endpoint, or isn't a path at all. */
+    bool IsGatedTarget() const;
+    /** Act on the header name kept so far. */
+    void EndHeaderName();
+    /** The header block of a request is complete. */
+    void EndRequest();
+    void StartRequest();
+
+    State state = State::Method;
+    bool gated = false;
+    /** The current request has an Upgrade header. */
+    bool upgrade = false;
+    uint8_t length = 0;
+    /** The header name overflowed its buffer, so it is none of the names we match. */
+    bool overflow = false;
+    char kept[HEADER_NAME_LENGTH];
+    uint32_t passedRequests = 0;
+    CdpFilter cdp;
+};
+
+/**
+ * The request scanner of every gated connection, keyed by socket handle like SocketVerdictTable.
+ * Entries are created on the first read and have to be evicted when the socket is closed, as handles are reused.
+ * A scanner is fed under its shard's lock, so the table is split into shards the same way to keep reads from different sockets apart.
+ */
+class HttpScanTable {
+public:
+    /**
+     * Scan the next bytes read from a socket.
+     *
+     * @param socket The socket.
+     * @param data The bytes read.
+     * @param length How many bytes were read.
+     * @return What the bytes mean for the gate, see HttpScan.
+     */
+    HttpScan Feed(uint64_t socket, const char* data, size_t length);
+
+    /**
+     * Forget the scanner of a socket.
+     *
+     * @param socket The socket being closed, or the handle of a socket that was just accepted.
+     */
+    void Evict(uint64_t socket);
+
+    /** @return The number of sockets with a scanner. */
+    size_t Size() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct alignas(64) Shard {
+        mutable std::mutex lock;
+        std::unordered_map<uint64_t, HttpRequestScanner> scanners;
+    };
+
+    Shard& ShardFor(uint64_t socket) const;
+
+    mutable Shard shards[SHARD_COUNT];
+};
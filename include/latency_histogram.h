@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A log-linear latency histogram in the style of HdrHistogram: every power of two is split into 16 linear sub-buckets,
+ * so any recorded value is off by at most 1/16 (~6%) of itself, from nanoseconds up to ~18 minutes.
+ *
+ * Recording is a couple of relaxed atomic adds, so it is safe to record from any thread without locking. The histogram is a plain block of
+ * atomics without pointers, which lets it live in shared memory and be read by another process while it is being written.
+ */
+class LatencyHistogram {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKET_COUNT = 1u << SUB_BUCKET_BITS;
+    /** Values are clamped to 2^40 ns. */
+    static constexpr uint32_t MAX_EXPONENT = 40;
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    /** A consistent-enough copy of a histogram to compute percentiles from. */
+    struct Snapshot {
+        uint64_t counts[BUCKET_COUNT];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t max;
+
+        /**
+         * @param quantile The quantile, between 0 and 1 (e.g. 0.99 for p99).
+         * @return The highest value equivalent to the quantile's bucket, or 0 if nothing was recorded.
+         */
+        uint64_t ValueAtQuantile(double quantile) const;
+
+        uint64_t Mean() const { return count ? sum / count : 0; }
+    };
+
+    /** @param nanoseconds The latency to record. */
+    void Record(uint64_t nanoseconds);
+
+    /** Copy the histogram. Concurrent records may or may not be included, but every bucket is read atomically. */
+    void Read(Snapshot& snapshot) const;
+
+    /** @return The index of the bucket a value is counted in. */
+    static size_t BucketIndex(uint64_t value);
+
+    /** @return The highest value counted in a bucket. */
+    static uint64_t BucketUpperBound(size_t index);
+
+private:
+    std::atomic<uint64_t> counts[BUCKET_COUNT];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+};
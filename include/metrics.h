@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <latency_histogram.h>
+#include <resolve_trace.h>
+#include <verdict_cache.h>
+
+struct MetricsHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t processId;
+    uint32_t size;
+};
+
+static constexpr char METRICS_MAGIC[4] = { 'P', 'R', 'M', 'S' };
+static constexpr uint32_t METRICS_VERSION = 3;
+
+/**
+ * Everything we measure, laid out to be shared with praesidium-stat through a named shared memory segment.
+ * The version in the header has to be bumped whenever this layout changes.
+ */
+struct SharedMetrics {
+    MetricsHeader header;
+    /** Time spent in each resolve phase, per resolution that went through it. */
+    LatencyHistogram phases[RESOLVE_PHASE_COUNT];
+    /** Time to decide a verdict, from the start of the resolution to the verdict. */
+    LatencyHistogram total;
+    std::atomic<uint64_t> allowed;
+    std::atomic<uint64_t> blocked;
+    /** Blocks of peers over their block budget, which were reset without a response. Not included in blocked. */
+    std::atomic<uint64_t> dropped;
+    /** Untrusted peers let in with restricted access, in restricted mode. */
+    std::atomic<uint64_t> restricted;
+    /** Restricted connections that were reset for sending a denied method, or something that couldn't be inspected. */
+    std::atomic<uint64_t> denied;
+    /** Time to capture the StartupProbe when we were loaded. */
+    std::atomic<uint64_t> probeNanoseconds;
+    /** Time spent in DllMain (or the preload constructor) when we were loaded, including the probe. */
+    std::atomic<uint64_t> attachNanoseconds;
+    /** Time to start the gate and install its hooks, which on Windows happens on its own thread once DllMain has returned. */
+    std::atomic<uint64_t> startNanoseconds;
+};
+
+/**
+ * Always-on metrics of the gate, published in shared memory named after our PID:
+ * "Local\Praesidium-<pid>" on Windows and "/praesidium-<pid>" (POSIX shm) on Linux.
+ */
+namespace Metrics {
+    /**
+     * Create the shared segment for the current process. If it can't be created, metrics are still recorded into process memory.
+     *
+     * @return true if the segment was created.
+     */
+    bool Initialize();
+
+    /** Remove the segment name, on Linux the segment would otherwise outlive the process. */
+    void Shutdown();
+
+    /**
+     * Stop publishing into the shared segment and record into process memory again, without removing the segment.
+     * A forked child calls this, as the segment it inherited belongs to its parent.
+     */
+    void Detach();
+
+    /**
+     * Record a decided verdict and the phase timings of its resolution.
+     *
+     * @param verdict The verdict.
+     * @param trace The trace of the resolution.
+     * @param totalNanoseconds How long the whole decision took.
+     */
+    void RecordDecision(Verdict verdict, const ResolveTrace& trace, uint64_t totalNanoseconds);
+
+    /** Record a restricted connection reset for what it sent. */
+    void RecordDenied();
+
+    /**
+     * Record how long loading the gate took, see SharedMetrics.
+     *
+     * @param probeNanoseconds Time to capture the StartupProbe.
+     * @param attachNanoseconds Time spent in DllMain or the preload constructor.
+     * @param startNanoseconds Time to start the gate.
+     */
+    void RecordStartup(uint64_t probeNanoseconds, uint64_t attachNanoseconds, uint64_t startNanoseconds);
+
+    /** @return The metrics of the current process. */
+    const SharedMetrics& Current();
+
+    /**
+     * Map the metrics segment of another process, read only.
+     *
+     * @param processId The ID of the process running the gate.
+     * @return The metrics, or null if the process has no segment or it has a different layout.
+     */
+    const SharedMetrics* OpenSegment(uint32_t processId);
+}
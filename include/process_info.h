@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Get the time a process was started, used together with the PID to tell apart two processes that got the same PID.
+ * The unit is platform specific (FILETIME ticks on Windows, clock ticks since boot on Linux), so values should only be compared
+ * with other values from this function.
+ *
+ * @param processId The ID of the process to query.
+ * @param startTime Receives the start time of the process.
+ * @return true if successful, false if the process doesn't exist or can't be queried.
+ */
+bool GetProcessStartTime(uint32_t processId, uint64_t& startTime);
+
+/**
+ * Get the ID of the process that created a process.
+ *
+ * @param processId The ID of the process to query.
+ * @param parentId Receives the ID of the parent process.
+ * @return true if successful, false if the process doesn't exist or can't be queried.
+ */
+bool GetParentProcessId(uint32_t processId, uint32_t& parentId);
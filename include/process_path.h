@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <file_identity.h>
+
+/** Large enough for any MAX_PATH path, including the extra bytes UTF-8 may need. */
+constexpr size_t PROCESS_PATH_CAPACITY = 520;
+
+/**
+ * A fixed capacity, inline path value. Resolving a peer happens on the recv path, so results are passed around
+ * by value in this instead of heap allocated strings.
+ */
+struct ProcessPath {
+    char data[PROCESS_PATH_CAPACITY];
+    uint16_t length;
+
+    ProcessPath() : length(0) { data[0] = '\0'; }
+
+    /**
+     * Replace the contents of the path.
+     *
+     * @param value The new path.
+     * @return false if the value didn't fit, in which case the path is left empty.
+     */
+    bool Assign(std::string_view value) {
+        if (value.size() >= PROCESS_PATH_CAPACITY) {
+            Clear();
+            return false;
+        }
+        memcpy(data, value.data(), value.size());
+        length = (uint16_t)value.size();
+        data[length] = '\0';
+        return true;
+    }
+
+    void Clear() {
+        length = 0;
+        data[0] = '\0';
+    }
+
+    bool Empty() const { return length == 0; }
+    const char* CStr() const { return data; }
+    std::string_view View() const { return std::string_view(data, length); }
+};
+
+/**
+ * Compare two paths the way the file system does: case-insensitively on Windows, with '/' and '\' treated alike, exactly on Linux.
+ * Only ASCII letters are folded, like TrustPolicy does.
+ */
+inline bool IsSamePath(std::string_view a, std::string_view b) {
+#ifdef _WIN32
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        char x = a[i] == '/' ? '\\' : (a[i] >= 'A' && a[i] <= 'Z') ? (char)(a[i] - 'A' + 'a') : a[i];
+        char y = b[i] == '/' ? '\\' : (b[i] >= 'A' && b[i] <= 'Z') ? (char)(b[i] - 'A' + 'a') : b[i];
+        if (x != y) return false;
+    }
+    return true;
+#else
+    return a == b;
+#endif
+}
+
+/** The outcome of resolving the process on the other end of a socket. */
+enum class ResolveResult : uint8_t {
+    Ok = 0,
+    /** The socket isn't connected, or isn't an IPv4 socket. */
+    NoPeerAddress,
+    /** No row in the TCP table matched the connection. */
+    ConnectionNotFound,
+    /** The connection is owned by the System or Idle process, which have no image path. */
+    SystemProcess,
+    /** The owning process couldn't be opened or queried. */
+    ProcessQueryFailed,
+    /** The image path didn't fit into a ProcessPath. */
+    PathTooLong
+};
+
+/** The executable a process was started from, by path and by file identity. */
+struct ProcessImage {
+    ProcessPath path;
+    FileIdentity identity;
+};
+
+/** The processes holding the other end of a socket, which can be several through fork, inherited descriptors or SCM_RIGHTS. */
+struct SocketHolders {
+    static constexpr size_t CAPACITY = 8;
+
+    uint32_t processIds[CAPACITY];
+    size_t count = 0;
+    /** Whether these are all of the holders, rather than those found so far. */
+    bool complete = false;
+};
+
+/** The process on the other end of a socket. */
+struct RemoteProcess {
+    uint32_t processId = 0;
+    ProcessImage image;
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <process_path.h>
+
+/**
+ * Identifies a process instance. PIDs are recycled by the OS, so the start time is part of the key to make sure
+ * a new process that got an old PID never sees the path of the process that used it before.
+ */
+struct ProcessKey {
+    uint32_t processId;
+    uint64_t startTime;
+
+    bool operator==(const ProcessKey& other) const {
+        return processId == other.processId && startTime == other.startTime;
+    }
+};
+
+struct ProcessKeyHash {
+    size_t operator()(const ProcessKey& key) const {
+        uint64_t hash = (key.startTime ^ ((uint64_t)key.processId << 32 | key.processId)) * 0x9E3779B97F4A7C15ull;
+        return (size_t)(hash ^ (hash >> 31));
+    }
+};
+
+/**
+ * Bounded least-recently-used cache of process images (path and file identity).
+ * The peers connecting to the debugger are nearly always the same handful of processes, so most resolutions never have to query the process image.
+ */
+class ProcessPathCache {
+public:
+    struct Counters {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+    };
+
+    explicit ProcessPathCache(size_t capacity);
+
+    /**
+     * Look up the image of a process, marking it as recently used.
+     *
+     * @param key The process to look up.
+     * @param image Receives the cached image on a hit.
+     * @return true on a hit, false on a miss.
+     */
+    bool Lookup(const ProcessKey& key, ProcessImage& image);
+
+    /**
+     * Add or replace the image of a process, evicting the least recently used entry if the cache is full.
+     * Once the cache is full, the evicted entry's storage is reused for the new one, so inserting doesn't allocate either.
+     *
+     * @param key The process the image belongs to.
+     * @param image The image of the process.
+     */
+    void Insert(const ProcessKey& key, const ProcessImage& image);
+
+    /** @return A snapshot of the hit, miss and eviction counters. */
+    Counters GetCounters() const;
+
+    size_t Size() const;
+
+private:
+    using Entry = std::pair<ProcessKey, ProcessImage>;
+
+    size_t capacity;
+
+    mutable std::mutex lock;
+    std::list<Entry> entries;
+    std::unordered_map<ProcessKey, std::list<Entry>::iterator, ProcessKeyHash> index;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+};
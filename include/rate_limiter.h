@@ -0,0 +1,59 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * Token bucket per peer process, limiting how much work a single process can make us do by connecting over and over.
+ *
+ * Buckets live in a fixed table, so a flood from many PIDs can't grow memory: once the table is full,
+ * the bucket that was idle the longest is handed to the new peer.
+ */
+class PeerRateLimiter {
+public:
+    struct Counters {
+        uint64_t passed;
+        uint64_t limited;
+    };
+
+    /**
+     * @param burst How many events a peer can have in a row before it is limited.
+     * @param refillPerSecond How many events per second a peer gets back after that.
+     */
+    PeerRateLimiter(uint32_t burst, uint32_t refillPerSecond);
+
+    /**
+     * Take one token from a peer's bucket.
+     *
+     * @param peerId The ID of the peer process, 0 if it couldn't be resolved (all unresolved peers share a bucket).
+     * @param now The current time.
+     * @return true if the peer is within its budget, false if it is over it.
+     */
+    bool Consume(uint32_t peerId, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /** @return A snapshot of the passed and limited counters. */
+    Counters GetCounters() const;
+
+private:
+    static constexpr size_t BUCKET_COUNT = 64;
+
+    struct Bucket {
+        uint32_t peerId = 0;
+        bool used = false;
+        double tokens = 0;
+        std::chrono::steady_clock::time_point lastRefill;
+    };
+
+    Bucket& FindBucket(uint32_t peerId, std::chrono::steady_clock::time_point now);
+
+    double burst;
+    double refillPerSecond;
+
+    std::mutex lock;
+    Bucket buckets[BUCKET_COUNT];
+
+    std::atomic<uint64_t> passed{0};
+    std::atomic<uint64_t> limited{0};
+};
@@ -0,0 +1,55 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <tcp_snapshot.h>
+
+/** The steps of resolving the peer of a socket that we keep timings for. */
+enum class ResolvePhase : uint8_t {
+    PeerAddress = 0,
+    TcpTable,
+    MatchProcess,
+    ProcessImage,
+    DevicePath,
+    Count
+};
+
+static constexpr size_t RESOLVE_PHASE_COUNT = (size_t)ResolvePhase::Count;
+
+/** @return The name of a phase as used by the tools, e.g. "tcp_table". */
+const char* ResolvePhaseName(ResolvePhase phase);
+
+/**
+ * What one resolution found out and how long each of its phases took, collected on the resolving thread.
+ * Phases can nest (refreshing the TCP table happens inside matching the process), so the timings don't add up to the total.
+ */
+struct ResolveTrace {
+    /** The connection from our side: local is our end, remote is the peer's. */
+    TcpConnectionKey connection;
+    uint32_t owningPid;
+    uint32_t phaseNanoseconds[RESOLVE_PHASE_COUNT];
+
+    void Reset();
+
+    /** @return The trace of the calling thread. */
+    static ResolveTrace& Current();
+
+    /** Reset the trace of the calling thread before starting a new resolution. */
+    static ResolveTrace& Begin();
+};
+
+/**
+ * Adds the time until it goes out of scope to a phase of the calling thread's trace.
+ */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(ResolvePhase phase) : phase(phase), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    ResolvePhase phase;
+    std::chrono::steady_clock::time_point start;
+};
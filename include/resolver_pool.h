@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <verdict_cache.h>
+
+/**
+ * A small pool of worker threads resolving socket verdicts off the thread that reads from the socket.
+ *
+ * Sockets are queued as soon as they are first seen, and the verdict is published into their VerdictSlot once resolved.
+ * By the time CEF reads from a socket the verdict is usually ready, and the reader only has to wait on it when it isn't.
+ */
+class ResolverPool {
+public:
+    /** Decides the verdict for a socket, Allow or Block. Runs on a worker thread. */
+    using Resolver = std::function<Verdict(uint64_t socket)>;
+
+    ResolverPool(size_t workerCount, Resolver resolver);
+    ~ResolverPool();
+
+    ResolverPool(const ResolverPool&) = delete;
+    ResolverPool& operator=(const ResolverPool&) = delete;
+
+    /**
+     * Queue a socket for resolution.
+     *
+     * @param socket The socket handle.
+     * @param slot The slot the verdict gets published into.
+     */
+    void Submit(uint64_t socket, std::shared_ptr<VerdictSlot> slot);
+
+    /**
+     * Stop the workers. Sockets still queued are published as blocked, so nobody waits on them until their timeout.
+     * Joins the workers unless join is false, which is needed where joining can deadlock (e.g. under the Windows loader lock).
+     *
+     * @param join Whether to wait for the workers to exit.
+     */
+    void Shutdown(bool join = true);
+
+    /** @return The number of sockets waiting for a worker. */
+    size_t QueueDepth() const;
+
+private:
+    void WorkerLoop();
+
+    Resolver resolver;
+
+    mutable std::mutex lock;
+    std::condition_variable work;
+    std::deque<std::pair<uint64_t, std::shared_ptr<VerdictSlot>>> queue;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+};
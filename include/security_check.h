@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <socket_trace.h>
+
+/**
+ * The trust decision shared by every gate (recv, accept) and platform.
+ * A peer is trusted if it is our pinned parent process, if its executable is the same file as the trusted one,
+ * or if the trust policy lists its executable (see TrustPolicy).
+ */
+namespace SecurityCheck {
+    /**
+     * Resolve the identity of the trusted executable, and pin our parent process if it was started from it.
+     * Must be called once at startup, before any socket is checked.
+     * 
+     * @param trustedPath The path of the trusted executable.
+     * @param parentPid The ID of our parent process, or 0 if unknown.
+     * @return true if the trusted identity was resolved, false if every connection will be blocked.
+     */
+    bool Initialize(const std::string& trustedPath, uint32_t parentPid);
+
+    /**
+     * Load the trust policy file and keep reloading it when it changes. Optional, without it only the trusted executable is trusted.
+     * Must be called at startup, before any socket is checked.
+     *
+     * @param policyPath The path of the policy file, which doesn't have to exist yet.
+     */
+    void InitializePolicy(const std::string& policyPath);
+
+    /**
+     * Stop reloading the trust policy, the last policy loaded stays in effect.
+     *
+     * @param join Whether to wait for the reloader thread to exit, which can't be done under the Windows loader lock.
+     */
+    void ShutdownPolicy(bool join);
+
+    /** 
+     * Check if the process on the other end of a socket is the trusted executable, or is trusted by the policy.
+     * 
+     * @param s The socket to check.
+     * @return true if the peer is trusted.
+     */
+    bool IsSteamProcess(SocketHandle s);
+
+    /** 
+     * Check if the process on the other end of a socket is the trusted executable, or is trusted by the policy.
+     * 
+     * @param s The socket to check.
+     * @param peerPid Receives the ID of the peer process, or 0 if it couldn't be resolved.
+     * @return true if the peer is trusted.
+     */
+    bool IsSteamProcess(SocketHandle s, uint32_t& peerPid);
+}
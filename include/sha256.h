@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+/** A SHA-256 digest. */
+struct Sha256Digest {
+    uint8_t bytes[32];
+
+    bool operator==(const Sha256Digest& other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) == 0; }
+    bool operator!=(const Sha256Digest& other) const { return !(*this == other); }
+
+    /**
+     * Parse a digest written as 64 hex digits, in either case.
+     *
+     * @param hex The digits.
+     * @param digest Receives the digest.
+     * @return false if the text isn't 64 hex digits.
+     */
+    static bool FromHex(std::string_view hex, Sha256Digest& digest);
+};
+
+struct Sha256DigestHash {
+    /** The digest is already uniformly distributed, any 8 bytes of it make a good hash. */
+    size_t operator()(const Sha256Digest& digest) const {
+        uint64_t hash;
+        memcpy(&hash, digest.bytes, sizeof(hash));
+        return (size_t)hash;
+    }
+};
+
+/**
+ * Streaming SHA-256 (FIPS 180-4).
+ *
+ * Blocks are compressed with the x86 SHA extensions when the CPU has them, which is checked once at runtime,
+ * and with portable code otherwise.
+ */
+class Sha256 {
+public:
+    enum class Kernel : uint8_t {
+        /** The SHA extensions if the CPU has them, else the portable code. */
+        Best,
+        Portable
+    };
+
+    explicit Sha256(Kernel kernel = Kernel::Best);
+
+    /**
+     * Hash the next bytes of the message.
+     *
+     * @param data The bytes.
+     * @param length How many bytes.
+     */
+    void Update(const void* data, size_t length);
+
+    /** @return The digest of the whole message. The hasher can't be updated afterwards. */
+    Sha256Digest Final();
+
+    /** @return The digest of a whole message. */
+    static Sha256Digest Hash(const void* data, size_t length);
+
+    /** @return true if the CPU has the SHA extensions, so Kernel::Best uses them. */
+    static bool Accelerated();
+
+private:
+    using Compress = void (*)(uint32_t state[8], const uint8_t* blocks, size_t count);
+
+    Compress compress;
+    uint32_t state[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    uint64_t totalLength = 0;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <tcp_snapshot.h>
+
+/**
+ * Linux lookups of the socket inode behind a TCP connection.
+ *
+ * The kernel can answer for exactly one connection over NETLINK_SOCK_DIAG, which costs the same whether the machine has ten
+ * connections or a hundred thousand. /proc/net/tcp prints every connection in the network namespace and has to be parsed line by line,
+ * it is only kept as the fallback for kernels without sock_diag and as the baseline the benchmarks compare against.
+ */
+namespace SockDiag {
+    enum class Result {
+        Found,
+        NotFound,
+        /** The netlink socket couldn't be opened or queried, the caller has to fall back to /proc/net/tcp. */
+        Unavailable
+    };
+
+    /**
+     * Ask the kernel for the inode of one IPv4 TCP connection.
+     *
+     * @param key The 4-tuple of the socket, from the owner's point of view.
+     * @param inode Receives the inode of the socket.
+     * @return Result::Found if the socket exists, Result::NotFound if it doesn't, Result::Unavailable if sock_diag can't be used.
+     */
+    Result QueryInode(const TcpConnectionKey& key, uint64_t& inode);
+
+    /**
+     * Find the inode of one IPv4 TCP connection by scanning /proc/net/tcp.
+     *
+     * @param key The 4-tuple of the socket, from the owner's point of view.
+     * @param inode Receives the inode of the socket.
+     * @return true if the socket was found.
+     */
+    bool ScanInode(const TcpConnectionKey& key, uint64_t& inode);
+}
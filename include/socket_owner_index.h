@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * Maps socket inodes to the processes holding them, from the "socket:[inode]" links in /proc/<pid>/fd.
+ *
+ * Scanning every descriptor of every process is by far the slowest part of resolving a peer on Linux, so the result of a scan is kept.
+ * A hit is confirmed with a single readlink of each descriptor it was found on. A new connection misses, but the peers of the debugger
+ * are nearly always the same few processes, so the processes that owned recent sockets are rescanned first and the full scan
+ * is only paid for a peer that hasn't connected before.
+ *
+ * A socket can be held by several processes at once, through fork, inherited descriptors or SCM_RIGHTS, so every holder is kept.
+ * Only a scan of every process finds them all: holders found by rescanning recent owners are enough to block a peer,
+ * but trusting one takes a lookup that asks for every holder, which rescans every process unless the last full scan saw the socket.
+ */
+class SocketOwnerIndex {
+public:
+    /** A socket held by more processes than this isn't resolved at all. */
+    static constexpr size_t MAX_HOLDERS = 8;
+
+    struct Counters {
+        /** Found in the index. */
+        uint64_t hits;
+        /** Found by rescanning the recent owners. */
+        uint64_t ownerRescans;
+        /** Needed a scan of every process. */
+        uint64_t fullRescans;
+    };
+
+    /**
+     * Find the processes holding a socket inode.
+     *
+     * @param inode The inode of the socket.
+     * @param owners Receives the IDs of the processes holding it, MAX_HOLDERS at most.
+     * @param count Receives the number of processes found.
+     * @param all Whether every holder has to be found. Otherwise the lookup may stop at the holders found among the recent owners.
+     * @param complete Receives whether every holder was found.
+     * @return true if at least one process holding the socket was found, and no more than MAX_HOLDERS.
+     */
+    bool FindOwners(uint64_t inode, uint32_t* owners, size_t& count, bool all, bool& complete);
+
+    /**
+     * Find the processes holding a socket inode without any index, by reading every descriptor of every process.
+     *
+     * @param inode The inode of the socket.
+     * @param owners Receives the IDs of the processes holding it, MAX_HOLDERS at most.
+     * @param count Receives the number of processes found.
+     * @return true if at least one process holding the socket was found, and no more than MAX_HOLDERS.
+     */
+    static bool ScanOwners(uint64_t inode, uint32_t* owners, size_t& count);
+
+    /** @return A snapshot of the hit and rescan counters. */
+    Counters GetCounters() const;
+
+    /** @return The number of sockets in the index. */
+    size_t Size() const;
+
+private:
+    static constexpr size_t RECENT_OWNER_COUNT = 8;
+    /** Rescanning recent owners only ever adds entries, past this size the next miss rebuilds the index from scratch. */
+    static constexpr size_t MAX_ENTRIES = 1 << 16;
+
+    struct Holder {
+        uint32_t processId;
+        int fd;
+    };
+
+    struct Holders {
+        Holder holders[MAX_HOLDERS];
+        uint8_t count = 0;
+        /** More processes hold the socket than fit. */
+        bool overflow = false;
+        /** Found by a scan of every process, rather than by rescanning recent owners. */
+        bool complete = false;
+    };
+
+    enum class Lookup { Missing, Found, Incomplete, Overflow };
+
+    bool IsHeldBy(uint64_t inode, const Holder& holder) const;
+    void AddHolder(uint64_t inode, uint32_t processId, int fd);
+    /** Index the sockets of a process, stopping early at the wanted inode. @return true if the wanted inode was found. */
+    bool ScanProcess(uint32_t processId, uint64_t wanted);
+    void Rebuild();
+    void NoteOwner(uint32_t processId);
+    /** Confirm the indexed holders of a socket, dropping those that let go of it. */
+    Lookup Confirm(uint64_t inode, uint32_t* owners, size_t& count, bool all, bool& complete);
+
+    mutable std::mutex lock;
+    std::unordered_map<uint64_t, Holders> holders;
+    /** Most recent first. */
+    uint32_t recentOwners[RECENT_OWNER_COUNT] = {};
+    size_t recentOwnerCount = 0;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> ownerRescans{0};
+    std::atomic<uint64_t> fullRescans{0};
+};
@@ -1,3 +1,5 @@
+#pragma once
+#ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
 #include <psapi.h>
@@ -5,29 +7,69 @@
 #include <vector>
 #include <WS2tcpip.h>
 #include <iphlpapi.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <tcp_snapshot.h>
+#include <device_path_map.h>
+#include <process_info.h>
+#include <file_identity.h>
+#include <process_path.h>
+#include <process_path_cache.h>
+#ifndef _WIN32
+#include <socket_owner_index.h>
+#endif
+
+#ifdef _WIN32
+/** The native socket handle type, so code shared between the Windows and Linux builds can name it. */
+typedef SOCKET SocketHandle;
 
 class SocketProcessResolver {
 private:
-    static void FreeProcessPath(char* path);
-    static char* GetExecutableNameFromPID(DWORD processId);
-    static char* AllocateString(const char* str);
+    static ProcessPathCache& GetProcessPathCache();
     static HANDLE OpenProcessForQuery(DWORD processId);
     static BOOL GetProcessPath(HANDLE hProcess, char* processPath, DWORD pathSize);
     static BOOL IsDevicePath(const char* path);
-    static char* ConvertSingleDevicePath(const char* devicePath, const char* deviceName, const char* driveLetter);
-    static char* TryConvertDevicePath(const char* devicePath, const char* drive);
-    static char* ConvertDevicePathToDosPath(char* devicePath);
-    static char* ProcessDevicePathIfNeeded(char* fullPath);
+    static DevicePathMap& GetDevicePathMap();
+    static BOOL ConvertDevicePathToDosPath(ProcessPath& path);
+    static void ProcessDevicePathIfNeeded(ProcessPath& path);
     static int GetPeerAddress(SOCKET s, struct sockaddr_in* remoteAddr);
-    static PMIB_TCPTABLE_OWNER_PID GetTcpTable(DWORD* tableSize);
+    static bool GetTcpTable(std::vector<TcpTableRow>& rows);
+    static TcpSnapshotProvider& GetTcpSnapshot();
     static void GetLocalSocketInfo(SOCKET s, DWORD* localPort, DWORD* localIP);
-    static void ExtractRowInfo(const MIB_TCPROW_OWNER_PID* row, DWORD* tableLocalPort, DWORD* tableLocalIP, DWORD* tableRemotePort, DWORD* tableRemoteIP);
-    static BOOL IsMatchingConnection(DWORD tableLocalPort, DWORD tableLocalIP, DWORD tableRemotePort, DWORD tableRemoteIP, DWORD ourLocalPort, DWORD ourLocalIP, DWORD remotePort, DWORD remoteIP) ;
-    static char* FindMatchingProcess(PMIB_TCPTABLE_OWNER_PID pTcpTable, DWORD remotePort, DWORD remoteIP, DWORD ourLocalPort, DWORD ourLocalIP);
+    static void ExtractRowInfo(const MIB_TCPROW_OWNER_PID* row, TcpTableRow* tableRow);
+    static BOOL FindMatchingProcess(DWORD remotePort, DWORD remoteIP, DWORD ourLocalPort, DWORD ourLocalIP, uint64_t mark, DWORD* owningPid);
+
+public:
+    static ResolveResult ResolveRemoteProcessId(SOCKET s, uint32_t* owningPid);
+    static ResolveResult ResolveRemoteHolders(SOCKET s, SocketHolders& holders, bool all);
+    static ResolveResult GetExecutableNameFromPID(uint32_t processId, ProcessImage& image);
+    static ResolveResult ResolveRemoteProcess(SOCKET s, RemoteProcess& process);
+};
+
+#else
+typedef int SocketHandle;
+
+/**
+ * Linux backend of the resolver. It exposes the same public interface as the Windows one,
+ * asking sock_diag for the inode of the peer's socket and then looking up the process holding that inode in an index of /proc/<pid>/fd.
+ */
+class SocketProcessResolver {
+private:
+    static ProcessPathCache& GetProcessPathCache();
+    static SocketOwnerIndex& GetSocketOwnerIndex();
+    static bool FindSocketInode(const TcpConnectionKey& key, uint64_t* inode);
+    static bool FindInodeOwners(uint64_t inode, SocketHolders& holders, bool all);
+    static ResolveResult FindPeerInode(SocketHandle s, uint64_t* inode);
 
 public:
-    static char* GetRemoteProcessFullPath(SOCKET s);
-};
\ No newline at end of file
+    static ResolveResult ResolveRemoteProcessId(SocketHandle s, uint32_t* owningPid);
+    static ResolveResult ResolveRemoteHolders(SocketHandle s, SocketHolders& holders, bool all);
+    static ResolveResult GetExecutableNameFromPID(uint32_t processId, ProcessImage& image);
+    static ResolveResult ResolveRemoteProcess(SocketHandle s, RemoteProcess& process);
+};
+#endif
@@ -0,0 +1,133 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * The 4-tuple identifying a TCP connection, seen from the side that owns the row.
+ * Addresses and ports are in host byte order.
+ */
+struct TcpConnectionKey {
+    uint32_t localIP;
+    uint32_t remoteIP;
+    uint16_t localPort;
+    uint16_t remotePort;
+
+    bool operator==(const TcpConnectionKey& other) const {
+        return localIP == other.localIP && remoteIP == other.remoteIP && localPort == other.localPort && remotePort == other.remotePort;
+    }
+};
+
+struct TcpConnectionKeyHash {
+    size_t operator()(const TcpConnectionKey& key) const {
+        uint64_t ports = ((uint64_t)key.localPort << 16) | key.remotePort;
+        uint64_t hash = (((uint64_t)key.localIP << 32) | key.remoteIP) * 0x9E3779B97F4A7C15ull;
+        hash ^= (hash >> 29) ^ (ports * 0xBF58476D1CE4E5B9ull);
+        return (size_t)(hash ^ (hash >> 32));
+    }
+};
+
+/** A single row of the system TCP table, reduced to what the resolver needs. */
+struct TcpTableRow {
+    TcpConnectionKey key;
+    uint32_t owningPid;
+};
+
+/**
+ * An immutable, indexed copy of the system TCP table.
+ * Lookups by 4-tuple are a single hash probe instead of a scan over every connection on the machine.
+ *
+ * The index is an open addressed table over a copy of the rows, so a snapshot the provider no longer hands out
+ * can be rebuilt in place from the next load without allocating.
+ */
+class TcpTableSnapshot {
+public:
+    TcpTableSnapshot(const std::vector<TcpTableRow>& rows, uint64_t generation);
+
+    /**
+     * Find the process owning a connection.
+     *
+     * @param key The 4-tuple of the connection, from the owner's point of view.
+     * @param owningPid Receives the owning process ID if the connection is found.
+     * @return true if the connection is in the snapshot.
+     */
+    bool FindOwningPid(const TcpConnectionKey& key, uint32_t& owningPid) const;
+
+    uint64_t Generation() const { return generation; }
+    size_t Size() const { return rows.size(); }
+
+private:
+    friend class TcpSnapshotProvider;
+
+    /** Replace the contents with a new load. Only called while nothing else holds the snapshot. */
+    void Assign(const std::vector<TcpTableRow>& loaded, uint64_t loadGeneration);
+
+    /** The rows, without duplicated 4-tuples (the first row of a 4-tuple wins). */
+    std::vector<TcpTableRow> rows;
+    /** Index + 1 of the row hashed to each bucket, 0 for an empty bucket. The size is a power of two. */
+    std::vector<uint32_t> buckets;
+    uint64_t generation = 0;
+};
+
+/**
+ * Shares one TCP table snapshot between all resolving threads.
+ *
+ * A 4-tuple can be closed and reused by another process between two snapshots, so a row is only trusted from a snapshot
+ * whose load started after the connection being resolved existed: lookups pass a Mark() taken once they have the socket,
+ * and anything older is re-checked against a refresh. Since a connection that is already readable has to be in any table
+ * taken after that, one refresh is enough. Threads that need one at the same time share a single load instead
+ * of each dumping the table themselves.
+ */
+class TcpSnapshotProvider {
+public:
+    /** Fills the row vector with the current system TCP table. The vector is reused between calls, so loaders should clear it first. */
+    using Loader = std::function<bool(std::vector<TcpTableRow>& rows)>;
+
+    explicit TcpSnapshotProvider(Loader loader);
+
+    /**
+     * Find the process owning a connection, refreshing the snapshot once if the current one was loaded before the mark
+     * or doesn't have the connection.
+     *
+     * @param key The 4-tuple of the connection, from the owner's point of view.
+     * @param mark The Mark() taken after the connection was known to exist.
+     * @param owningPid Receives the owning process ID if the connection is found.
+     * @return true if the connection was found.
+     */
+    bool FindOwningPid(const TcpConnectionKey& key, uint64_t mark, uint32_t& owningPid);
+
+    /** @return A mark that only snapshots loaded from now on are newer than. */
+    uint64_t Mark() const;
+
+    /** @return The current snapshot, or null if the table has never been loaded. */
+    std::shared_ptr<const TcpTableSnapshot> Current() const;
+
+    /**
+     * Get a snapshot taken after this call started, sharing the load with any other thread refreshing at the same time.
+     *
+     * @return The refreshed snapshot, or null if the table could not be loaded.
+     */
+    std::shared_ptr<const TcpTableSnapshot> Refresh();
+
+    /** @return How many times the loader has been called. */
+    uint64_t LoadCount() const;
+
+private:
+    Loader loader;
+
+    mutable std::mutex lock;
+    std::condition_variable refreshed;
+    std::shared_ptr<TcpTableSnapshot> current;
+    /** The snapshot current was loaded over, rebuilt by the next load once every reader has let go of it. */
+    std::shared_ptr<TcpTableSnapshot> spare;
+    bool refreshing = false;
+    uint64_t loadCount = 0;
+    uint64_t completedGeneration = 0;
+
+    /** Scratch buffer for the loader, only touched by the thread performing the refresh. */
+    std::vector<TcpTableRow> rows;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <epoch_pointer.h>
+#include <file_identity.h>
+#include <process_path.h>
+#include <sha256.h>
+
+/**
+ * Executables trusted besides steam.exe, compiled from a policy file. One entry per line, '#' starts a comment:
+ *
+ *     identity C:\Tools\millennium.exe    the file at that path, however it is reached (compared by FileIdentity)
+ *     path C:\Tools\helper.exe            that exact path
+ *     prefix C:\Tools\bin                 any executable inside that directory, at any depth
+ *     sha256 9f86d081884c7d65...          any executable with that content, wherever it is
+ *
+ * Paths are compared case-insensitively on Windows, with '/' and '\' treated alike. Identities are resolved when the policy is compiled,
+ * an identity whose file doesn't exist is skipped. On Windows a running executable can be renamed and a hard link put in its place,
+ * so there an identity entry also requires the process to have been started from the path of its file.
+ *
+ * A compiled policy is immutable. Identities, paths and digests live in hash sets, prefixes in a sorted array from which prefixes
+ * covered by a shorter one were removed, so at most one prefix can match a path and a binary search finds it.
+ * Looking up an image doesn't allocate.
+ */
+class TrustPolicy {
+public:
+    TrustPolicy(const TrustPolicy&) = delete;
+    TrustPolicy& operator=(const TrustPolicy&) = delete;
+
+    /**
+     * Compile the text of a policy file.
+     *
+     * @param text The policy.
+     * @param errorLine Receives the line number (from 1) of the first invalid line.
+     * @return The policy, or nullptr if a line is invalid.
+     */
+    static std::unique_ptr<const TrustPolicy> Compile(std::string_view text, size_t& errorLine);
+
+    /**
+     * @param image The executable of a peer process.
+     * @return true if the policy trusts the executable.
+     */
+    bool Trusts(const ProcessImage& image) const;
+
+    /**
+     * @param digest The SHA-256 digest of the executable of a peer process.
+     * @return true if the policy trusts executables with that content.
+     */
+    bool TrustsDigest(const Sha256Digest& digest) const { return digests.count(digest) != 0; }
+
+    /** @return true if the policy has sha256 entries, so a peer it doesn't trust otherwise is worth hashing. */
+    bool HasDigests() const { return !digests.empty(); }
+
+    /** @return How many entries the policy holds, after skipped identities and covered prefixes were left out. */
+    size_t Size() const { return identities.size() + paths.size() + prefixes.size() + digests.size(); }
+
+    /** @return How many identity lines were skipped because their file doesn't exist. */
+    size_t MissingIdentities() const { return missingIdentities; }
+
+private:
+    TrustPolicy() = default;
+
+    bool MatchesPrefix(std::string_view path) const;
+
+    /** The identities, with the normalized path of their file on Windows, where both have to match. */
+    std::unordered_map<FileIdentity, std::string, FileIdentityHash> identities;
+    /** The normalized paths and prefixes. The sets below point into them, so they are never touched after compiling. */
+    std::vector<std::string> pathStorage;
+    std::vector<std::string> prefixStorage;
+    std::unordered_set<std::string_view> paths;
+    std::vector<std::string_view> prefixes;
+    std::unordered_set<Sha256Digest, Sha256DigestHash> digests;
+    size_t missingIdentities = 0;
+};
+
+/**
+ * The trust policy of a file, reloaded when the file changes.
+ *
+ * A background thread polls the file's size and modification time and compiles it again when they change. The new policy is published
+ * through an EpochPointer, so lookups never wait on a reload. If the file becomes invalid the previous policy stays in place,
+ * if it is removed nothing is trusted through it anymore.
+ */
+class TrustPolicyFile {
+public:
+    /**
+     * @param path The policy file.
+     * @param interval How often the file is checked for changes.
+     */
+    explicit TrustPolicyFile(std::string path, std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    ~TrustPolicyFile();
+
+    TrustPolicyFile(const TrustPolicyFile&) = delete;
+    TrustPolicyFile& operator=(const TrustPolicyFile&) = delete;
+
+    /**
+     * Load the file if it changed since it was last loaded. Called by the reloader thread, and can be called directly.
+     *
+     * @return true if a new policy was published.
+     */
+    bool Reload();
+
+    /** Start the reloader thread. */
+    void Start();
+
+    /**
+     * Stop the reloader thread.
+     *
+     * @param join Whether to wait for the thread to exit, which can't be done under the Windows loader lock.
+     */
+    void Shutdown(bool join = true);
+
+    /**
+     * @param image The executable of a peer process.
+     * @return true if the current policy trusts the executable.
+     */
+    bool Trusts(const ProcessImage& image) const {
+        auto policy = current.Read();
+        return policy && policy->Trusts(image);
+    }
+
+    /** @return A guard on the current policy, which is null if the file was never loaded. */
+    EpochPointer<TrustPolicy>::ReadGuard Read() const { return current.Read(); }
+
+    /** @return How many times a policy was published. */
+    uint64_t Loads() const { return loads.load(std::memory_order_relaxed); }
+
+private:
+    void ReloaderLoop();
+
+    std::string path;
+    std::chrono::milliseconds interval;
+    EpochPointer<TrustPolicy> current;
+    std::atomic<uint64_t> loads{0};
+    std::atomic<bool> stopping{false};
+
+    /** The size and modification time of the file as it was last loaded, guarded by reloadLock. */
+    std::mutex reloadLock;
+    bool loaded = false;
+    uint64_t loadedSize = 0;
+    uint64_t loadedTime = 0;
+
+    std::thread reloader;
+};
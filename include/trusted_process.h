@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * A single process we trust without looking at its image, pinned at startup.
+ *
+ * Once pinned, checking whether a PID belongs to the pinned process doesn't open the process or query its path:
+ * on Windows we keep a handle to it open, which stops the PID from being reused for as long as we hold it.
+ * On Linux we hold a pidfd and only have to poll it to know the process hasn't exited (a PID can't be reused before that).
+ */
+class TrustedProcess {
+public:
+    TrustedProcess() = default;
+    ~TrustedProcess();
+
+    TrustedProcess(const TrustedProcess&) = delete;
+    TrustedProcess& operator=(const TrustedProcess&) = delete;
+
+    /**
+     * Pin a process. Should only be called once, before any thread calls Matches.
+     *
+     * @param processId The ID of the process to trust.
+     * @return true if the process was pinned.
+     */
+    bool Pin(uint32_t processId);
+
+    /**
+     * Check whether a PID belongs to the pinned process.
+     *
+     * @param processId The PID to check, typically the owning PID of a TCP table row.
+     * @return true if the PID is the pinned process and it is still the same process.
+     */
+    bool Matches(uint32_t processId) const;
+
+    bool IsPinned() const { return pinnedId != 0; }
+    uint32_t ProcessId() const { return pinnedId; }
+    uint64_t StartTime() const { return startTime; }
+
+private:
+    uint32_t pinnedId = 0;
+    uint64_t startTime = 0;
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int pidfd = -1;
+#endif
+};
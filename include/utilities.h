@@ -1,6 +1,56 @@
+#pragma once
 #include <string>
-#include <wtypes.h>
+#include <cstdint>
 
-std::string GetSteamPath();
-BOOL IsDeveloperMode();
-BOOL IsSteamWebHelper();
\ No newline at end of file
+/**
+ * What the gate needs to know about the process it was loaded into: who we are, who started us and what we were started with.
+ *
+ * It is captured once, when the library is loaded, in a single pass: one process snapshot and one read of the command line on Windows,
+ * one read of each /proc file on Linux. On Windows this runs under the loader lock, which every other thread loading a DLL waits on.
+ * The Linux build implements the same probe on /proc, see src/linux/utilities.cc.
+ */
+struct StartupProbe {
+    uint32_t processId = 0;
+    uint32_t parentId = 0;
+    /** The executable names, lowercased on Windows. */
+    std::string processName;
+    /** Empty if the parent is gone, or if its PID now belongs to a process started after us. */
+    std::string parentName;
+    /** Whether "-dev" was passed. */
+    bool developerMode = false;
+    /** The path passed with "-steampath=", empty if it wasn't. */
+    std::string steamPath;
+    /** Whether "--remote-debugging-port=" was passed. */
+    bool hasDebuggingPort = false;
+    /** The port passed with it, 0 if Chromium is told to pick one itself. */
+    uint16_t debuggingPort = 0;
+
+    /** @return true if we are the steamwebhelper started by steam. */
+    bool IsSteamWebHelper() const;
+
+    /**
+     * Steam actually spawns 3 different web helpers at startup, but only the one owned by steam handles remote debugging.
+     * In developer mode everything is left as it is.
+     *
+     * @return true if the gate should be turned on in this process.
+     */
+    bool ShouldGate() const { return IsSteamWebHelper() && !developerMode; }
+};
+
+/**
+ * Capture the startup probe of the current process.
+ *
+ * @param probe Receives what was found, anything that couldn't be read is left empty.
+ * @return false if the current process itself couldn't be looked up.
+ */
+bool CaptureStartupProbe(StartupProbe& probe);
+
+#ifdef _WIN32
+/**
+ * Converts a wide string to a UTF-8 encoded string.
+ *
+ * @param wstr The wide string to convert.
+ * @return The UTF-8 encoded string, empty if it couldn't be converted.
+ */
+std::string WideStringToUTF8(const std::wstring& wstr);
+#endif
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The outcome of a security check for a single socket.
+ * Unknown means the socket has not been checked yet (or was evicted after being closed),
+ * Pending means a check has been queued but hasn't finished yet.
+ * Drop is a block for a peer that went over its block budget, its connection is reset without sending it a response.
+ * Restrict is given to untrusted peers in restricted mode (Linux only) instead of Block: they can use DevTools, but only the methods on its allow list (see CdpFilter).
+ */
+enum class Verdict : uint8_t {
+    Unknown = 0,
+    Allow,
+    Block,
+    Pending,
+    Drop,
+    Restrict
+};
+
+/**
+ * Where the verdict for one socket gets published. The resolver publishes into it from a worker thread,
+ * and any thread that needs the verdict before it is ready can wait on it.
+ */
+class VerdictSlot {
+public:
+    explicit VerdictSlot(Verdict initial = Verdict::Pending) : verdict(initial) {}
+
+    /** @return The current verdict, Verdict::Pending if it hasn't been published yet. */
+    Verdict Load() const { return verdict.load(std::memory_order_acquire); }
+
+    /**
+     * Publish the verdict and wake every waiter. Only the first published verdict is kept.
+     *
+     * @param value The verdict, Allow, Block, Drop or Restrict.
+     */
+    void Publish(Verdict value);
+
+    /**
+     * Wait for the verdict to be published. Fails closed: if nothing is published in time the socket is treated as blocked.
+     *
+     * @param timeout How long to wait at most.
+     * @return The published verdict, or Verdict::Block on timeout.
+     */
+    Verdict Wait(std::chrono::milliseconds timeout);
+
+    /**
+     * Run a callback once the verdict is published, on the thread that publishes it. This is how work that can't wait
+     * (e.g. an overlapped read on a completion port thread) is picked up again once the verdict is known.
+     *
+     * @param callback Called with the published verdict.
+     * @return true if the callback was registered, false if the verdict is already published (the callback is then not kept or called).
+     */
+    bool OnPublished(std::function<void(Verdict)> callback);
+
+private:
+    std::atomic<Verdict> verdict;
+    std::mutex lock;
+    std::condition_variable ready;
+    std::vector<std::function<void(Verdict)>> continuations;
+};
+
+/**
+ * Concurrent table mapping a socket handle to the verdict that was computed for it.
+ *
+ * The verdict for a connection never changes for the lifetime of the socket, so we only have to resolve the peer process once
+ * and every later recv on the same socket is a single hash lookup under a shared lock.
+ * The table is split into shards so threads reading from different sockets rarely touch the same lock.
+ *
+ * Socket handles are treated as opaque integers, which keeps this portable between SOCKET on Windows and file descriptors elsewhere.
+ */
+class SocketVerdictTable {
+public:
+    /**
+     * Get the cached verdict for a socket.
+     *
+     * @param socket The socket handle to look up.
+     * @return The cached verdict, Verdict::Pending if a check is still running, or Verdict::Unknown if the socket has not been seen yet.
+     */
+    Verdict Lookup(uint64_t socket) const;
+
+    /**
+     * Store a final verdict for a socket. If the socket already has a slot (pending or not), its first published verdict is kept.
+     *
+     * @param socket The socket handle.
+     * @param verdict The verdict to store.
+     * @return The verdict that is now in the table for the socket.
+     */
+    Verdict Insert(uint64_t socket, Verdict verdict);
+
+    /**
+     * Get the slot of a socket, creating a pending one if the socket has not been seen yet.
+     *
+     * @param socket The socket handle.
+     * @param created Set to true if the slot was created by this call, in which case the caller is responsible for getting it resolved.
+     * @return The slot of the socket.
+     */
+    std::shared_ptr<VerdictSlot> Acquire(uint64_t socket, bool& created);
+
+    /**
+     * Forget the verdict for a socket. This has to be called when the socket is closed, as the handle value can be reused by a new connection.
+     *
+     * @param socket The socket handle to evict.
+     */
+    void Evict(uint64_t socket);
+
+    /** @return The number of sockets currently tracked. */
+    size_t Size() const;
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex lock;
+        std::unordered_map<uint64_t, std::shared_ptr<VerdictSlot>> entries;
+    };
+
+    Shard& ShardFor(uint64_t socket) const;
+
+    mutable Shard shards[SHARD_COUNT];
+};
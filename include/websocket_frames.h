@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Unmask a piece of a WebSocket payload, 16 bytes at a time with SSE2 where it is available.
+ *
+ * @param input The masked bytes.
+ * @param output Receives the unmasked bytes, may be the same as input.
+ * @param length How many bytes to unmask.
+ * @param mask The masking key of the frame.
+ * @param offset The offset of the first byte within the frame's payload, which selects the byte of the key it starts with.
+ */
+void UnmaskPayload(const char* input, char* output, size_t length, const uint8_t mask[4], uint64_t offset);
+
+/**
+ * Streaming parser of what a client sends over a WebSocket connection (RFC 6455), fed with the buffers recv already filled.
+ *
+ * Frame headers split across reads are reassembled in a few bytes of state, and payloads are unmasked in pieces into a buffer
+ * on the stack, so nothing is allocated or copied per frame. Data messages are handed to a Sink piece by piece, possibly
+ * spread over several frames; control frames are checked and skipped.
+ *
+ * Anything the parser can't follow makes the stream invalid for good: unmasked client frames, reserved bits (a compression extension),
+ * unknown opcodes, fragmented or oversized control frames and continuation frames outside of a message.
+ */
+class WebSocketFrameParser {
+public:
+    enum class Opcode : uint8_t {
+        Continuation = 0x0,
+        Text = 0x1,
+        Binary = 0x2,
+        Close = 0x8,
+        Ping = 0x9,
+        Pong = 0xA
+    };
+
+    /** Receives the data messages of the stream. */
+    class Sink {
+    public:
+        virtual ~Sink() = default;
+
+        /** A new text or binary message starts. */
+        virtual void OnMessageStart(Opcode opcode) = 0;
+
+        /**
+         * The next piece of the current message, unmasked. Only valid for the duration of the call.
+         *
+         * @param data The unmasked bytes.
+         * @param length How many bytes.
+         */
+        virtual void OnMessageData(const char* data, size_t length) = 0;
+
+        /** The current message is complete. */
+        virtual void OnMessageEnd() = 0;
+    };
+
+    /**
+     * Parse the next bytes of the stream.
+     *
+     * @param data The bytes, exactly as they were read.
+     * @param length How many bytes were read.
+     * @param sink Receives the messages.
+     * @return false once the stream is invalid.
+     */
+    bool Feed(const char* data, size_t length, Sink& sink);
+
+    /** @return false once the stream is invalid. */
+    bool Valid() const { return state != State::Invalid; }
+
+private:
+    enum class State : uint8_t {
+        Header,
+        Payload,
+        Invalid
+    };
+
+    /** Decode the frame header collected so far once it is complete. @return false if the frame is invalid. */
+    bool StartFrame(Sink& sink);
+
+    State state = State::Header;
+    /** 2 bytes, up to 8 bytes of extended length and the 4 byte masking key. */
+    uint8_t header[14];
+    uint8_t headerLength = 0;
+    uint8_t mask[4];
+    Opcode frameOpcode = Opcode::Continuation;
+    bool finalFrame = false;
+    /** A data message is in progress, waiting for its continuation frames. */
+    bool inMessage = false;
+    uint64_t payloadLength = 0;
+    uint64_t payloadOffset = 0;
+};
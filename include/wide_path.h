@@ -0,0 +1,37 @@
+#pragma once
+#ifdef _WIN32
+#include <string>
+#include <windows.h>
+
+/**
+ * Paths are carried around as UTF-8, the way they come out of the command line and the policy file, while the "A" functions
+ * of the Windows API read them in the ANSI code page. A path is converted with this before it is opened and the "W" function
+ * is called instead, so a path outside of the code page still names the right file.
+ *
+ * @param path The UTF-8 path.
+ * @param widePath Receives the UTF-16 path.
+ * @return false if the path isn't valid UTF-8.
+ */
+inline bool ToWidePath(const char* path, std::wstring& widePath) {
+    int length = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, nullptr, 0);
+    if (length == 0) return false;
+
+    widePath.resize(length - 1);
+    return MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, &widePath[0], length) != 0;
+}
+
+/**
+ * The other way around, for paths the "W" functions return.
+ *
+ * @param widePath The UTF-16 path.
+ * @param path Receives the UTF-8 path.
+ * @return false if the path couldn't be converted.
+ */
+inline bool FromWidePath(const wchar_t* widePath, std::string& path) {
+    int length = WideCharToMultiByte(CP_UTF8, 0, widePath, -1, nullptr, 0, nullptr, nullptr);
+    if (length == 0) return false;
+
+    path.resize(length - 1);
+    return WideCharToMultiByte(CP_UTF8, 0, widePath, -1, &path[0], length, nullptr, nullptr) != 0;
+}
+#endif
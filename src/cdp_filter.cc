@@ -0,0 +1,167 @@
+#include <cdp_filter.h>
+#include <byte_search.h>
+#include <cstring>
+
+static constexpr std::string_view METHOD_KEY = "method";
+
+void CdpMethodScanner::Start() {
+    *this = CdpMethodScanner();
+}
+
+void CdpMethodScanner::StringContent(const char* data, size_t length) {
+    if (role == Role::Key) {
+        for (size_t i = 0; i < length && keyMatches; i++, keyLength++) {
+            keyMatches = keyLength < METHOD_KEY.size() && data[i] == METHOD_KEY[keyLength];
+        }
+    } else if (role == Role::Method) {
+        if (methodOverflow || length > METHOD_CAPACITY - methodLength) {
+            methodOverflow = true;
+            return;
+        }
+        memcpy(method + methodLength, data, length);
+        methodLength += (uint8_t)length;
+    }
+}
+
+void CdpMethodScanner::EndString() {
+    inString = false;
+    if (role == Role::Key) {
+        methodValue = keyMatches && keyLength == METHOD_KEY.size();
+    } else if (role == Role::Method) {
+        /** Longer than any entry of the allow list, so it can't be one of them. */
+        if (methodOverflow || CdpMethods::IsDenied(std::string_view(method, methodLength))) denied = true;
+    }
+    role = Role::Other;
+}
+
+void CdpMethodScanner::Structural(char c) {
+    /** A value at depth 1 that isn't a string can't be a method, whatever key it belongs to. */
+    bool valueStart = c == '"' || c == '{' || c == '[';
+    bool topLevel = depth == 1;
+
+    switch (c) {
+        case '"':
+            if (depth == 0) {
+                refused = true;
+                return;
+            }
+            inString = true;
+            role = Role::Other;
+            if (topLevel && expectKey) {
+                role = Role::Key;
+                keyLength = 0;
+                keyMatches = true;
+                expectKey = false;
+            } else if (topLevel && methodValue) {
+                role = Role::Method;
+                methodLength = 0;
+                methodOverflow = false;
+            }
+            break;
+        case '{':
+        case '[':
+            if (depth == 0 && (started || c == '[')) {
+                refused = true;
+                return;
+            }
+            started = true;
+            depth++;
+            if (depth == 1) expectKey = true;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                refused = true;
+                return;
+            }
+            depth--;
+            if (depth == 0) done = true;
+            break;
+        case ',':
+            if (topLevel) expectKey = true;
+            break;
+        default:
+            /** A comment. */
+            refused = true;
+            return;
+    }
+
+    if (topLevel && valueStart && role != Role::Key) methodValue = false;
+    if (topLevel && c == ',') methodValue = false;
+}
+
+void CdpMethodScanner::Feed(const char* data, size_t length) {
+    const char* position = data;
+    const char* end = data + length;
+
+    while (position < end && !refused) {
+        if (escapePending) {
+            position++;
+            escapePending = false;
+            continue;
+        }
+
+        if (inString) {
+            const char* delimiter = ByteSearch::FindAny(position, end, '"', '\\', '\\');
+            StringContent(position, (size_t)(delimiter - position));
+            position = delimiter;
+            if (position == end) break;
+
+            if (*position == '\\') {
+                /** An escape could spell "method" or a denied method in a way a plain comparison misses. */
+                if (role != Role::Other) {
+                    refused = true;
+                    break;
+                }
+                escapePending = true;
+            } else {
+                EndString();
+            }
+            position++;
+            continue;
+        }
+
+        if (done) {
+            /** Only whitespace may follow the top-level object. */
+            for (; position < end; position++) {
+                char c = *position;
+                if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+                    refused = true;
+                    break;
+                }
+            }
+            break;
+        }
+
+        position = ByteSearch::FindJsonStructural(position, end);
+        if (position == end) break;
+        Structural(*position++);
+    }
+}
+
+bool CdpMethodScanner::Finish() {
+    if (!done) refused = true;
+    return !Denied();
+}
+
+bool CdpFilter::Feed(const char* data, size_t length) {
+    if (denied) return false;
+    if (!frames.Feed(data, length, *this)) denied = true;
+    return !denied;
+}
+
+void CdpFilter::OnMessageStart(WebSocketFrameParser::Opcode opcode) {
+    if (opcode != WebSocketFrameParser::Opcode::Text) denied = true;
+    methods.Start();
+}
+
+void CdpFilter::OnMessageData(const char* data, size_t length) {
+    if (denied) return;
+
+    methods.Feed(data, length);
+    if (methods.Denied()) denied = true;
+}
+
+void CdpFilter::OnMessageEnd() {
+    if (!denied && !methods.Finish()) denied = true;
+}
@@ -0,0 +1,109 @@
+#include <command_line.h>
+#include <algorithm>
+
+static bool IsSpace(char c) {
+    return c == ' ' || c == '\t';
+}
+
+/** Drop the quotes around the whole of a string: "C:\Program Files (x86)\Steam\steam.exe" */
+static std::string_view Unquote(std::string_view text) {
+    if (text.size() >= 2 && text.front() == '"' && text.back() == '"') return text.substr(1, text.size() - 2);
+    return text;
+}
+
+static bool EndsWithExe(std::string_view text) {
+    static constexpr std::string_view extension = ".exe";
+    return text.size() >= extension.size() && text.compare(text.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+CommandLine::CommandLine(std::string text) : text(new std::string(std::move(text))) {}
+
+void CommandLine::Reserve(size_t count) {
+    arguments.reserve(count);
+    switches.reserve(count);
+}
+
+void CommandLine::Add(std::string_view argument, bool stripQuotes) {
+    if (stripQuotes) argument = Unquote(argument);
+    arguments.push_back(argument);
+    if (argument.empty() || argument[0] != '-') return;
+
+    size_t separator = argument.find('=');
+    if (separator == std::string_view::npos) {
+        switches.emplace(argument, std::string_view());
+        return;
+    }
+
+    std::string_view value = argument.substr(separator + 1);
+    switches.emplace(argument.substr(0, separator), stripQuotes ? Unquote(value) : value);
+}
+
+/**
+ * A space inside quotes never ends an argument, and the quotes are kept in the argument until Add drops the outer ones.
+ * Past the '=' of an unquoted value a space only ends it where the legacy -steampath= scan stopped: before the next switch
+ * or a quoted argument, or right after ".exe".
+ */
+CommandLine CommandLine::FromWindows(std::string line) {
+    CommandLine commandLine(std::move(line));
+    std::string_view rest = *commandLine.text;
+    commandLine.Reserve((size_t)std::count(rest.begin(), rest.end(), ' ') + 1);
+
+    size_t position = 0;
+    while (true) {
+        while (position < rest.size() && IsSpace(rest[position])) position++;
+        if (position == rest.size()) break;
+
+        size_t start = position;
+        bool quoted = false;
+        bool inValue = false;
+        bool unquotedValue = false;
+        for (; position < rest.size(); position++) {
+            char c = rest[position];
+            if (c == '"') {
+                quoted = !quoted;
+                continue;
+            }
+            if (quoted) continue;
+
+            if (c == '=' && !inValue && rest[start] == '-') {
+                inValue = true;
+                unquotedValue = position + 1 < rest.size() && rest[position + 1] != '"';
+                continue;
+            }
+            if (!IsSpace(c)) continue;
+            if (!unquotedValue) break;
+
+            size_t next = position;
+            while (next < rest.size() && IsSpace(rest[next])) next++;
+            if (next == rest.size() || rest[next] == '-' || rest[next] == '"' || EndsWithExe(rest.substr(start, position - start))) break;
+        }
+
+        commandLine.Add(rest.substr(start, position - start), true);
+    }
+    return commandLine;
+}
+
+CommandLine CommandLine::FromNullSeparated(std::string text) {
+    CommandLine commandLine(std::move(text));
+    std::string_view rest = *commandLine.text;
+    commandLine.Reserve((size_t)std::count(rest.begin(), rest.end(), '\0') + 1);
+
+    while (!rest.empty()) {
+        size_t terminator = rest.find('\0');
+        commandLine.Add(rest.substr(0, terminator), false);
+        rest.remove_prefix(terminator == std::string_view::npos ? rest.size() : terminator + 1);
+    }
+    return commandLine;
+}
+
+bool CommandLine::Has(std::string_view name) const {
+    return switches.find(name) != switches.end();
+}
+
+bool CommandLine::Get(std::string_view name, std::string_view& value) const {
+    auto it = switches.find(name);
+    if (it == switches.end()) return false;
+
+    value = it->second;
+    return true;
+}
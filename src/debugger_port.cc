@@ -0,0 +1,29 @@
+#include <debugger_port.h>
+
+void DebuggerPort::Configure(uint16_t value) {
+    if (value != 0) port.store(value, std::memory_order_relaxed);
+}
+
+bool DebuggerPort::Learn(uint16_t value) {
+    if (value == 0) return false;
+
+    uint16_t expected = 0;
+    return port.compare_exchange_strong(expected, value, std::memory_order_relaxed) || expected == value;
+}
+
+bool ParseRemoteDebuggingPort(const CommandLine& commandLine, uint16_t& port) {
+    std::string_view text;
+    if (!commandLine.Get("--remote-debugging-port", text) || text.empty()) return false;
+
+    /** Anything but digits makes the argument invalid. */
+    uint32_t value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') return false;
+
+        value = value * 10 + (uint32_t)(c - '0');
+        if (value > 0xFFFF) return false;
+    }
+
+    port = (uint16_t)value;
+    return true;
+}
@@ -0,0 +1,201 @@
+#include <decision_log.h>
+#include <chrono>
+#include <cstring>
+
+DecisionRing::DecisionRing(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * A cell whose sequence equals the enqueue position is free for that position. Producers race for the position with a CAS,
+ * and the winner publishes the record by advancing the cell's sequence, which is what the consumer waits for.
+ */
+bool DecisionRing::TryPush(const DecisionRecord& record) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[position & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.record = record;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool DecisionRing::TryPop(DecisionRecord& record) {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[position & mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+        if (difference == 0) {
+            if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                record = cell.record;
+                cell.sequence.store(position + mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = dequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+#ifdef _WIN32
+#include <wide_path.h>
+
+static const char PATH_SEPARATOR = '\\';
+
+/** @return The file opened for appending, NULL if it can't be. */
+static FILE* OpenLogFile(const std::string& path) {
+    std::wstring widePath;
+    return ToWidePath(path.c_str(), widePath) ? _wfopen(widePath.c_str(), L"ab") : NULL;
+}
+
+/** _wrename doesn't replace an existing file, so the old one is removed first. */
+static void ReplaceLogFile(const std::string& from, const std::string& to) {
+    std::wstring wideFrom, wideTo;
+    if (!ToWidePath(from.c_str(), wideFrom) || !ToWidePath(to.c_str(), wideTo)) return;
+
+    _wremove(wideTo.c_str());
+    _wrename(wideFrom.c_str(), wideTo.c_str());
+}
+#else
+static const char PATH_SEPARATOR = '/';
+
+static FILE* OpenLogFile(const std::string& path) {
+    return fopen(path.c_str(), "ab");
+}
+
+static void ReplaceLogFile(const std::string& from, const std::string& to) {
+    rename(from.c_str(), to.c_str());
+}
+#endif
+
+DecisionLog::DecisionLog(std::string directory, size_t ringCapacity, uint64_t maxFileBytes)
+    : directory(std::move(directory)), maxFileBytes(maxFileBytes), ring(ringCapacity) {
+    path = this->directory + PATH_SEPARATOR + "praesidium.log";
+    rotatedPath = this->directory + PATH_SEPARATOR + "praesidium.1.log";
+    writer = std::thread(&DecisionLog::WriterLoop, this);
+}
+
+DecisionLog::~DecisionLog() {
+    Shutdown(true);
+}
+
+void DecisionLog::Record(uint64_t socket, Verdict verdict, const ResolveTrace& trace, uint64_t totalNanoseconds) {
+    DecisionRecord record = {};
+    record.timestamp = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    record.socket = socket;
+    record.localIP = trace.connection.localIP;
+    record.remoteIP = trace.connection.remoteIP;
+    record.localPort = trace.connection.localPort;
+    record.remotePort = trace.connection.remotePort;
+    record.owningPid = trace.owningPid;
+    record.verdict = (uint8_t)verdict;
+    memcpy(record.phaseNanoseconds, trace.phaseNanoseconds, sizeof(record.phaseNanoseconds));
+    record.totalNanoseconds = totalNanoseconds > UINT32_MAX ? UINT32_MAX : (uint32_t)totalNanoseconds;
+
+    if (!ring.TryPush(record)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DecisionLog::Shutdown(bool join) {
+    if (stopping.exchange(true)) return;
+
+    if (!writer.joinable()) return;
+    if (join) writer.join();
+    else writer.detach();
+}
+
+/**
+ * Appends to an existing log so restarts don't wipe the history, and only writes a header into a new (empty) file.
+ */
+bool DecisionLog::OpenFile() {
+    file = OpenLogFile(path);
+    if (!file) return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fileBytes = size > 0 ? (uint64_t)size : 0;
+
+    if (fileBytes == 0) {
+        DecisionLogHeader header = {};
+        memcpy(header.magic, DECISION_LOG_MAGIC, sizeof(header.magic));
+        header.version = DECISION_LOG_VERSION;
+        header.recordSize = sizeof(DecisionRecord);
+        header.phaseCount = RESOLVE_PHASE_COUNT;
+
+        fwrite(&header, sizeof(header), 1, file);
+        fileBytes = sizeof(header);
+    }
+    return true;
+}
+
+void DecisionLog::Rotate() {
+    fclose(file);
+    file = nullptr;
+
+    ReplaceLogFile(path, rotatedPath);
+    OpenFile();
+}
+
+/**
+ * Producers never wake the writer (that would need a lock or a syscall on the hot path), so it polls the ring instead.
+ * Records are written in batches and flushed once per batch.
+ */
+void DecisionLog::WriterLoop() {
+    static const size_t BATCH_SIZE = 256;
+    DecisionRecord batch[BATCH_SIZE];
+
+    for (;;) {
+        bool stop = stopping.load(std::memory_order_acquire);
+
+        size_t count = 0;
+        while (count < BATCH_SIZE && ring.TryPop(batch[count])) {
+            count++;
+        }
+
+        if (count > 0 && (file || OpenFile())) {
+            size_t stored = 0;
+            for (size_t i = 0; i < count; i++) {
+                if (fileBytes + sizeof(DecisionRecord) > maxFileBytes) Rotate();
+                if (!file) break;
+
+                stored += fwrite(&batch[i], sizeof(DecisionRecord), 1, file);
+                fileBytes += sizeof(DecisionRecord);
+            }
+            if (file) fflush(file);
+            written.fetch_add(stored, std::memory_order_relaxed);
+        }
+
+        if (count == BATCH_SIZE) continue;
+        if (stop) break;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
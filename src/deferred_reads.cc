@@ -0,0 +1,80 @@
+#include <deferred_reads.h>
+
+bool DeferredReads::Defer(uint64_t socket, const std::shared_ptr<VerdictSlot>& slot, Resume resume) {
+    std::vector<Resume> stale;
+    bool deferred = true;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Entry& entry = entries[socket];
+
+        /**
+         * The first read parked on a connection registers for its verdict. The continuation needs this lock, so it can't
+         * run before the read is in the entry, and every read parked before it runs is resumed by it.
+         */
+        if (entry.slot != slot) {
+            /** Reads left over from an earlier connection with the same handle, whose close we didn't see. */
+            stale.swap(entry.reads);
+            parked -= stale.size();
+
+            const VerdictSlot* key = slot.get();
+            if (!slot->OnPublished([this, socket, key](Verdict verdict) { Release(socket, key, verdict); })) {
+                entries.erase(socket);
+                deferred = false;
+            } else {
+                entry.slot = slot;
+            }
+        }
+
+        if (deferred) {
+            entry.reads.push_back(std::move(resume));
+            parked++;
+        }
+    }
+
+    for (auto& read : stale) {
+        read(Verdict::Unknown);
+    }
+    return deferred;
+}
+
+size_t DeferredReads::Cancel(uint64_t socket) {
+    std::vector<Resume> reads;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = entries.find(socket);
+        if (it == entries.end()) return 0;
+
+        reads.swap(it->second.reads);
+        parked -= reads.size();
+        entries.erase(it);
+    }
+
+    for (auto& read : reads) {
+        read(Verdict::Unknown);
+    }
+    return reads.size();
+}
+
+void DeferredReads::Release(uint64_t socket, const VerdictSlot* slot, Verdict verdict) {
+    std::vector<Resume> reads;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = entries.find(socket);
+
+        /** Cancelled, or the handle already belongs to another connection. */
+        if (it == entries.end() || it->second.slot.get() != slot) return;
+
+        reads.swap(it->second.reads);
+        parked -= reads.size();
+        entries.erase(it);
+    }
+
+    for (auto& read : reads) {
+        read(verdict);
+    }
+}
+
+size_t DeferredReads::Size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return parked;
+}
@@ -0,0 +1,233 @@
+#include <device_path_map.h>
+#include <algorithm>
+#include <cstring>
+
+DevicePathTable::DevicePathTable(std::vector<DevicePrefix> prefixes, uint64_t signature) : prefixes(std::move(prefixes)), signature(signature) {
+    index.reserve(this->prefixes.size());
+
+    for (size_t i = 0; i < this->prefixes.size(); i++) {
+        const std::string& device = this->prefixes[i].device;
+        if (device.empty()) continue;
+
+        /** The first entry for a device wins, same as the drive order GetLogicalDriveStrings returns. */
+        if (!index.emplace(std::string_view(device), i).second) continue;
+
+        if (std::find(lengths.begin(), lengths.end(), device.size()) == lengths.end()) {
+            lengths.push_back(device.size());
+        }
+    }
+    std::sort(lengths.begin(), lengths.end(), std::greater<size_t>());
+}
+
+/**
+ * A prefix only matches on a component boundary, otherwise "\Device\HarddiskVolume1" would also match "\Device\HarddiskVolume10\...".
+ */
+static bool IsComponentBoundary(std::string_view path, size_t position) {
+    return position == path.size() || path[position] == '\\' || path[position] == '/';
+}
+
+bool DevicePathTable::Translate(std::string_view path, char* out, size_t outSize) const {
+    for (size_t length : lengths) {
+        if (length > path.size() || !IsComponentBoundary(path, length)) continue;
+
+        auto it = index.find(path.substr(0, length));
+        if (it == index.end()) continue;
+
+        const std::string& dos = prefixes[it->second].dos;
+        std::string_view remainder = path.substr(length);
+        if (dos.size() + remainder.size() + 1 > outSize) return false;
+
+        memcpy(out, dos.data(), dos.size());
+        memcpy(out + dos.size(), remainder.data(), remainder.size());
+        out[dos.size() + remainder.size()] = '\0';
+        return true;
+    }
+    return false;
+}
+
+DevicePathMap::DevicePathMap(Loader loader, SignatureSource signatureSource, std::chrono::milliseconds missRefreshInterval)
+    : loader(std::move(loader)), signatureSource(std::move(signatureSource)), missRefreshInterval(missRefreshInterval) {}
+
+uint64_t DevicePathMap::LoadCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return loadCount;
+}
+
+/**
+ * Build a new table unless the current one is up to date and was built less than a refresh interval ago.
+ * Runs under the lock, so concurrent callers that noticed the same change wait for one rebuild instead of each doing their own.
+ */
+std::shared_ptr<const DevicePathTable> DevicePathMap::Rebuild(uint64_t signature) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto now = std::chrono::steady_clock::now();
+    bool recent = now - lastBuild < missRefreshInterval;
+    bool upToDate = table && table->Signature() == signature;
+
+    /** Also back off after a failed load, so a broken loader isn't retried on every lookup. */
+    if (recent && (upToDate || (table && lastBuildFailed))) {
+        return table;
+    }
+
+    std::vector<DevicePrefix> prefixes;
+    lastBuildFailed = !loader(prefixes);
+    if (!lastBuildFailed) {
+        table = std::make_shared<const DevicePathTable>(std::move(prefixes), signature);
+        loadCount++;
+    }
+    lastBuild = now;
+    return table;
+}
+
+std::shared_ptr<const DevicePathTable> DevicePathMap::Acquire(uint64_t signature) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (table && table->Signature() == signature) return table;
+    }
+    return Rebuild(signature);
+}
+
+std::shared_ptr<const DevicePathTable> DevicePathMap::Current() {
+    return Acquire(signatureSource());
+}
+
+bool DevicePathMap::Translate(std::string_view path, char* out, size_t outSize) {
+    uint64_t signature = signatureSource();
+    std::shared_ptr<const DevicePathTable> current = Acquire(signature);
+    if (current && current->Translate(path, out, outSize)) {
+        return true;
+    }
+
+    /** 
+     * A miss usually means a volume was remapped without changing the signature (e.g. a drive letter moved to another volume).
+     * Rebuild is rate limited, so a path that can never be translated doesn't reload the table on every call.
+     */
+    std::shared_ptr<const DevicePathTable> rebuilt = Rebuild(signature);
+    return rebuilt && rebuilt != current && rebuilt->Translate(path, out, outSize);
+}
+
+#ifdef _WIN32
+#include <windows.h>
+
+bool LoadSystemDevicePrefixes(std::vector<DevicePrefix>& prefixes) {
+    char drives[MAX_PATH];
+    DWORD length = GetLogicalDriveStringsA(sizeof(drives), drives);
+    if (length == 0 || length > sizeof(drives)) return false;
+
+    for (char* drive = drives; *drive; drive += strlen(drive) + 1) {
+        char driveLetter[3] = { drive[0], ':', '\0' };
+        char deviceName[MAX_PATH];
+
+        /** QueryDosDevice can return several null separated targets, the first one is the current mapping. */
+        if (!QueryDosDeviceA(driveLetter, deviceName, MAX_PATH)) continue;
+        prefixes.push_back({ deviceName, driveLetter });
+    }
+    return true;
+}
+
+uint64_t GetVolumeSetSignature() {
+    return GetLogicalDrives();
+}
+#else
+#include <atomic>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+/**
+ * Undo the octal escaping mountinfo uses for spaces, tabs, newlines and backslashes in paths (e.g. "\040").
+ */
+static std::string UnescapeMountPath(std::string_view field) {
+    std::string result;
+    result.reserve(field.size());
+
+    for (size_t i = 0; i < field.size(); i++) {
+        if (field[i] == '\\' && i + 3 < field.size() && field[i + 1] >= '0' && field[i + 1] <= '3') {
+            result.push_back((char)(((field[i + 1] - '0') << 6) | ((field[i + 2] - '0') << 3) | (field[i + 3] - '0')));
+            i += 3;
+            continue;
+        }
+        result.push_back(field[i]);
+    }
+    return result;
+}
+
+/**
+ * Each mountinfo line is "id parent major:minor root mountpoint options [optional fields...] - fstype source superoptions".
+ * https://man7.org/linux/man-pages/man5/proc_pid_mountinfo.5.html
+ */
+static bool ParseMountInfoLine(std::string_view line, DevicePrefix& prefix) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t end = line.find(' ', start);
+        if (end == std::string_view::npos) end = line.size();
+        if (end > start) fields.push_back(line.substr(start, end - start));
+        start = end + 1;
+    }
+
+    auto separator = std::find(fields.begin(), fields.end(), std::string_view("-"));
+    if (fields.size() < 6 || separator == fields.end() || fields.end() - separator < 3) return false;
+
+    std::string root = UnescapeMountPath(fields[3]);
+    std::string mountPoint = UnescapeMountPath(fields[4]);
+    std::string source = UnescapeMountPath(*(separator + 2));
+
+    /** Only block devices have a path namespace comparable to \Device\..., pseudo filesystems (proc, tmpfs, ...) are skipped. */
+    if (source.empty() || source[0] != '/') return false;
+
+    prefix.device = root == "/" ? source : source + root;
+    prefix.dos = mountPoint == "/" ? std::string() : mountPoint;
+    return true;
+}
+
+void ParseMountInfo(std::string_view content, std::vector<DevicePrefix>& prefixes) {
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == std::string::npos) end = content.size();
+
+        DevicePrefix prefix;
+        if (ParseMountInfoLine(content.substr(start, end - start), prefix)) {
+            prefixes.push_back(std::move(prefix));
+        }
+        start = end + 1;
+    }
+}
+
+bool LoadSystemDevicePrefixes(std::vector<DevicePrefix>& prefixes) {
+    int fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    std::string content;
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        content.append(buffer, (size_t)length);
+    }
+    close(fd);
+
+    ParseMountInfo(content, prefixes);
+    return true;
+}
+
+/**
+ * The kernel flags /proc/self/mountinfo with POLLPRI | POLLERR whenever the mount table changes, so checking for a change
+ * is a single non-blocking poll() on a descriptor we keep open.
+ */
+uint64_t GetVolumeSetSignature() {
+    static int fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+    static std::atomic<uint64_t> changes{0};
+    if (fd < 0) return 0;
+
+    struct pollfd pfd = { fd, POLLPRI, 0 };
+    if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLPRI | POLLERR))) {
+        /** The event is only cleared by reading the file again from the start. */
+        char buffer[4096];
+        lseek(fd, 0, SEEK_SET);
+        while (read(fd, buffer, sizeof(buffer)) > 0) {}
+        changes.fetch_add(1, std::memory_order_relaxed);
+    }
+    return changes.load(std::memory_order_relaxed);
+}
+#endif
@@ -2,17 +2,97 @@
 
 static HMODULE hPraesidium = NULL;
 
+/** The leading fields of PROCESS_BASIC_INFORMATION, which winternl.h only declares as reserved. */
+struct ProcessBasicInformation {
+    LONG_PTR ExitStatus;
+    PVOID PebBaseAddress;
+    ULONG_PTR AffinityMask;
+    LONG BasePriority;
+    ULONG_PTR UniqueProcessId;
+    ULONG_PTR InheritedFromUniqueProcessId;
+};
+
+typedef LONG (NTAPI* ntQueryInformationProcessPtr_t)(HANDLE process, ULONG informationClass, PVOID information, ULONG length, PULONG returnLength);
+
+/**
+ * Checks if the file name at the end of a path is a specific one, ignoring case.
+ *
+ * @param path The full path.
+ * @param name The file name.
+ * @return True if the path ends with the file name, false otherwise.
+ */
+static bool HasFileName(const wchar_t* path, const wchar_t* name) {
+    const wchar_t* fileName = path;
+    for (const wchar_t* c = path; *c; c++) {
+        if (*c == L'\\' || *c == L'/') fileName = c + 1;
+    }
+    return lstrcmpiW(fileName, name) == 0;
+}
+
+/**
+ * Checks if the process that started us is steam.exe. Its PID comes from NtQueryInformationProcess,
+ * which answers from our own process, instead of from a snapshot of every process in the system.
+ *
+ * @return True if the parent is steam.exe, false otherwise.
+ */
+static bool IsParentSteam() {
+    HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    ntQueryInformationProcessPtr_t queryInformationProcess = ntdll ? (ntQueryInformationProcessPtr_t)GetProcAddress(ntdll, "NtQueryInformationProcess") : NULL;
+    if (!queryInformationProcess) return false;
+
+    /** ProcessBasicInformation is information class 0. */
+    ProcessBasicInformation information = {};
+    if (queryInformationProcess(GetCurrentProcess(), 0, &information, sizeof(information), NULL) != 0) return false;
+
+    HANDLE parent = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)information.InheritedFromUniqueProcessId);
+    if (!parent) return false;
+
+    wchar_t path[MAX_PATH] = {0};
+    DWORD length = MAX_PATH;
+    bool isSteam = QueryFullProcessImageNameW(parent, 0, path, &length) && HasFileName(path, L"steam.exe");
+    CloseHandle(parent);
+    return isSteam;
+}
+
+/**
+ * The proxy is loaded by steam.exe and every web helper, but praesidium only gates the steamwebhelper.exe started by steam.exe.
+ * Everything else is ruled out here, by name first, so it never loads praesidium at all.
+ * Praesidium still makes the full check itself, this only has to never rule out the process it gates.
+ *
+ * @return True if praesidium should be loaded.
+ */
+static bool IsGateCandidate() {
+    wchar_t path[MAX_PATH] = {0};
+    DWORD length = GetModuleFileNameW(NULL, path, MAX_PATH);
+    if (length == 0 || length == MAX_PATH) return false;
+
+    return HasFileName(path, L"steamwebhelper.exe") && IsParentSteam();
+}
+
+/**
+ * Loading praesidium from DllMain would run it under the loader lock of our own load. This thread only gets to run
+ * once DllMain has returned, long before CEF creates its DevTools listener.
+ */
+static DWORD WINAPI LoadPraesidium(LPVOID) {
+    InterlockedExchangePointer((PVOID*)&hPraesidium, LoadLibraryA("./praesidium.dll"));
+    return 0;
+}
+
 BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     switch (ul_reason_for_call) {
-    case DLL_PROCESS_ATTACH:
-        hPraesidium = LoadLibraryA("./praesidium.dll");
+    case DLL_PROCESS_ATTACH: {
+        DisableThreadLibraryCalls(hModule);
+        if (!IsGateCandidate()) break;
+
+        HANDLE thread = CreateThread(NULL, 0, LoadPraesidium, NULL, 0, NULL);
+        if (thread) CloseHandle(thread);
         break;
-    case DLL_PROCESS_DETACH:
-        if (hPraesidium) {
-            FreeLibrary(hPraesidium);
-            hPraesidium = NULL;
-        }
+    }
+    case DLL_PROCESS_DETACH: {
+        HMODULE module = (HMODULE)InterlockedExchangePointer((PVOID*)&hPraesidium, NULL);
+        if (module) FreeLibrary(module);
         break;
     }
+    }
     return TRUE;
 }
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include <file_hash.h>
+#include <algorithm>
+#include <cstdio>
+
+/** Files are mapped this much at a time, which keeps hashing from taking much address space in a 32 bit process. */
+static const uint64_t MAP_WINDOW = 16 * 1024 * 1024;
+
+#ifdef _WIN32
+#include <cstring>
+#include <windows.h>
+#include <winioctl.h>
+#include <wide_path.h>
+
+using NativeFile = HANDLE;
+
+typedef LONG (NTAPI* ntQueryInformationProcessPtr_t)(HANDLE process, ULONG informationClass, PVOID information, ULONG length, PULONG returnLength);
+
+/**
+ * The USN of the last change to a file. The change journal numbers every change to a file, and unlike its times, nothing else moves it.
+ * https://learn.microsoft.com/en-us/windows/win32/api/winioctl/ni-winioctl-fsctl_read_file_usn_data
+ *
+ * @return The USN, 0 if the volume keeps no change journal.
+ */
+static uint64_t GetFileUsn(HANDLE file) {
+    READ_FILE_USN_DATA request = { 2, 3 };
+    union {
+        USN_RECORD_V2 v2;
+        USN_RECORD_V3 v3;
+        BYTE bytes[sizeof(USN_RECORD_V3) + MAX_PATH * sizeof(WCHAR)];
+    } record;
+    DWORD returned = 0;
+    if (!DeviceIoControl(file, FSCTL_READ_FILE_USN_DATA, &request, sizeof(request), &record, sizeof(record), &returned, NULL)) return 0;
+
+    /** ReFS answers with version 3 records, whose 128 bit file references move the USN. */
+    if (record.v2.MajorVersion == 2) return (uint64_t)record.v2.Usn;
+    if (record.v2.MajorVersion == 3) return (uint64_t)record.v3.Usn;
+    return 0;
+}
+
+/** The handle is opened for reading only, sharing everything, so it never gets in the way of the process running the file. */
+static bool OpenForHashing(const char* path, NativeFile& file, FileStamp& stamp) {
+    std::wstring widePath;
+    if (!ToWidePath(path, widePath)) return false;
+
+    file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(file, &info)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    stamp.identity.volume = info.dwVolumeSerialNumber;
+    stamp.identity.index = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    stamp.size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    stamp.changed = GetFileUsn(file);
+    return true;
+}
+
+static void CloseNativeFile(NativeFile file) {
+    CloseHandle(file);
+}
+
+/** Views have to start at a multiple of the allocation granularity (64 KB), which MAP_WINDOW is. */
+static bool HashOpenFile(NativeFile file, uint64_t size, Sha256Digest& digest) {
+    Sha256 hasher;
+    if (size > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping) return false;
+
+        for (uint64_t offset = 0; offset < size; offset += MAP_WINDOW) {
+            size_t length = (size_t)std::min(MAP_WINDOW, size - offset);
+            const void* view = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, length);
+            if (!view) {
+                CloseHandle(mapping);
+                return false;
+            }
+            hasher.Update(view, length);
+            UnmapViewOfFile(view);
+        }
+        CloseHandle(mapping);
+    }
+
+    digest = hasher.Final();
+    return true;
+}
+
+/**
+ * Check that an open file is the image section of a process. ProcessImageFileMapping (58) takes a file handle and only succeeds
+ * if it is the file the image of the process was mapped from, whatever its path is now.
+ */
+static bool IsProcessImageFile(uint32_t processId, HANDLE file) {
+    HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    ntQueryInformationProcessPtr_t queryInformationProcess = ntdll ? (ntQueryInformationProcessPtr_t)GetProcAddress(ntdll, "NtQueryInformationProcess") : NULL;
+    if (!queryInformationProcess) return false;
+
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_QUERY_INFORMATION, FALSE, processId);
+    if (!process) process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!process) return false;
+
+    LONG status = queryInformationProcess(process, 58, &file, sizeof(file), NULL);
+    CloseHandle(process);
+    return status == 0;
+}
+
+bool FileHashCache::HashProcessImage(uint32_t processId, const ProcessImage& image, Sha256Digest& digest) {
+    if (image.path.Empty()) return false;
+
+    /** A path that couldn't be mapped to a drive letter (see SocketProcessResolver::IsDevicePath) is still opened through GLOBALROOT. */
+    char globalRootPath[PROCESS_PATH_CAPACITY + 16];
+    const char* path = image.path.CStr();
+    if (strncmp(path, "\\Device\\", 8) == 0) {
+        snprintf(globalRootPath, sizeof(globalRootPath), "\\\\?\\GLOBALROOT%s", path);
+        path = globalRootPath;
+    }
+
+    NativeFile file;
+    FileStamp stamp;
+    if (!OpenForHashing(path, file, stamp)) return false;
+
+    bool cached = false;
+    bool hashed = false;
+    if (IsProcessImageFile(processId, file)) {
+        cached = Lookup(stamp, digest);
+        hashed = cached || HashOpenFile(file, stamp.size, digest);
+    }
+    CloseNativeFile(file);
+    if (hashed && !cached) Store(stamp, digest);
+    return hashed;
+}
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using NativeFile = int;
+
+/**
+ * The status change time comes from a clock that only ticks every few milliseconds, so a file can be written again within the tick
+ * it was stamped in and keep its stamp. A file changed this recently isn't cached.
+ */
+static const uint64_t RACY_CHANGE_NANOSECONDS = 100000000;
+
+static bool OpenForHashing(const char* path, NativeFile& file, FileStamp& stamp) {
+    file = open(path, O_RDONLY | O_CLOEXEC);
+    if (file < 0) return false;
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(file);
+        return false;
+    }
+
+    stamp.identity.volume = (uint64_t)info.st_dev;
+    stamp.identity.index = (uint64_t)info.st_ino;
+    stamp.size = (uint64_t)info.st_size;
+    stamp.changed = (uint64_t)info.st_ctim.tv_sec * 1000000000ull + (uint64_t)info.st_ctim.tv_nsec;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    if ((uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec < stamp.changed + RACY_CHANGE_NANOSECONDS) stamp.changed = 0;
+    return true;
+}
+
+static void CloseNativeFile(NativeFile file) {
+    close(file);
+}
+
+/**
+ * A mapped file that is truncated while it is read raises SIGBUS. The files hashed here are the executables of running processes,
+ * which the kernel refuses to open for writing (ETXTBSY).
+ */
+static bool HashOpenFile(NativeFile file, uint64_t size, Sha256Digest& digest) {
+    Sha256 hasher;
+    for (uint64_t offset = 0; offset < size; offset += MAP_WINDOW) {
+        size_t length = (size_t)std::min(MAP_WINDOW, size - offset);
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, (off_t)offset);
+        if (view == MAP_FAILED) return false;
+
+        madvise(view, length, MADV_SEQUENTIAL);
+        hasher.Update(view, length);
+        munmap(view, length);
+    }
+
+    digest = hasher.Final();
+    return true;
+}
+
+bool FileHashCache::HashProcessImage(uint32_t processId, const ProcessImage&, Sha256Digest& digest) {
+    char exePath[32];
+    snprintf(exePath, sizeof(exePath), "/proc/%u/exe", processId);
+    return Hash(exePath, digest);
+}
+#endif
+
+FileHashCache::FileHashCache(size_t capacity) : capacity(capacity) {
+    digests.reserve(capacity);
+}
+
+/**
+ * Two threads missing on the same file both hash it, which is cheaper than holding the lock while hashing
+ * and only happens the first time a new binary connects.
+ */
+bool FileHashCache::Hash(const char* path, Sha256Digest& digest) {
+    NativeFile file;
+    FileStamp stamp;
+    if (!OpenForHashing(path, file, stamp)) return false;
+
+    bool cached = Lookup(stamp, digest);
+    bool hashed = cached || HashOpenFile(file, stamp.size, digest);
+    CloseNativeFile(file);
+    if (hashed && !cached) Store(stamp, digest);
+    return hashed;
+}
+
+bool FileHashCache::Lookup(const FileStamp& stamp, Sha256Digest& digest) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = stamp.changed ? digests.find(stamp) : digests.end();
+    if (it == digests.end()) {
+        misses++;
+        return false;
+    }
+
+    hits++;
+    digest = it->second;
+    return true;
+}
+
+void FileHashCache::Store(const FileStamp& stamp, const Sha256Digest& digest) {
+    if (!stamp.changed) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (digests.size() >= capacity) digests.clear();
+    digests[stamp] = digest;
+}
+
+FileHashCache::Counters FileHashCache::GetCounters() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return { hits, misses };
+}
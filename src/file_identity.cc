@@ -0,0 +1,96 @@
+#include <file_identity.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wide_path.h>
+
+/**
+ * Open the file without requesting any access, which is enough to query its information and doesn't conflict with
+ * the sharing mode of a running executable.
+ * https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-getfileinformationbyhandle
+ */
+static bool GetHandleIdentity(HANDLE hFile, FileIdentity& identity) {
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(hFile, &info)) return false;
+
+    identity.volume = info.dwVolumeSerialNumber;
+    identity.index = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    return true;
+}
+
+bool GetFileIdentity(const char* path, FileIdentity& identity) {
+    std::wstring widePath;
+    if (!ToWidePath(path, widePath)) return false;
+
+    HANDLE hFile = CreateFileW(widePath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    bool success = GetHandleIdentity(hFile, identity);
+    CloseHandle(hFile);
+    return success;
+}
+
+/**
+ * The final path is asked of the open file, so it is spelled the way the file system spells it: long names and the drive letter
+ * of the volume, whatever the path it was opened with looked like.
+ * https://learn.microsoft.com/en-us/windows/win32/api/fileapi/nf-fileapi-getfinalpathnamebyhandlew
+ */
+bool GetFinalPath(const char* path, std::string& finalPath) {
+    std::wstring widePath;
+    if (!ToWidePath(path, widePath)) return false;
+
+    HANDLE hFile = CreateFileW(widePath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    wchar_t buffer[MAX_PATH + 8];
+    DWORD length = GetFinalPathNameByHandleW(hFile, buffer, MAX_PATH + 8, FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+    CloseHandle(hFile);
+    if (length == 0 || length >= MAX_PATH + 8) return false;
+
+    /** The path comes back as \\?\C:\... or \\?\UNC\server\share\..., while process image paths are plain Win32 paths. */
+    const wchar_t* start = buffer;
+    if (wcsncmp(start, L"\\\\?\\UNC\\", 8) == 0) {
+        start += 6;
+        buffer[6] = L'\\';
+    } else if (wcsncmp(start, L"\\\\?\\", 4) == 0) {
+        start += 4;
+    }
+    return FromWidePath(start, finalPath);
+}
+
+bool GetProcessFileIdentity(uint32_t processId, FileIdentity& identity) {
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return false;
+
+    wchar_t imagePath[MAX_PATH];
+    DWORD pathSize = MAX_PATH;
+    BOOL success = QueryFullProcessImageNameW(hProcess, 0, imagePath, &pathSize);
+    CloseHandle(hProcess);
+    if (!success) return false;
+
+    HANDLE hFile = CreateFileW(imagePath, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return false;
+
+    bool result = GetHandleIdentity(hFile, identity);
+    CloseHandle(hFile);
+    return result;
+}
+#else
+#include <cstdio>
+#include <sys/stat.h>
+
+bool GetFileIdentity(const char* path, FileIdentity& identity) {
+    struct stat info;
+    if (stat(path, &info) != 0) return false;
+
+    identity.volume = (uint64_t)info.st_dev;
+    identity.index = (uint64_t)info.st_ino;
+    return true;
+}
+
+bool GetProcessFileIdentity(uint32_t processId, FileIdentity& identity) {
+    char exePath[32];
+    snprintf(exePath, sizeof(exePath), "/proc/%u/exe", processId);
+    return GetFileIdentity(exePath, identity);
+}
+#endif
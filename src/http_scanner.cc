@@ -0,0 +1,199 @@
+#include <http_scanner.h>
+#include <byte_search.h>
+#include <cstring>
+
+static char ToLower(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool Matches(const char* kept, size_t length, const char* name) {
+    size_t nameLength = strlen(name);
+    return length == nameLength && memcmp(kept, name, nameLength) == 0;
+}
+
+bool HttpRequestScanner::IsGatedTarget() const {
+    /** Absolute URLs, "*" and anything else that isn't a plain path could still be routed to DevTools by the server. */
+    if (length == 0 || kept[0] != '/') return true;
+    if (length >= 5 && memcmp(kept, "/json", 5) == 0) return true;
+    return length == TARGET_PREFIX_LENGTH && memcmp(kept, "/devtools", TARGET_PREFIX_LENGTH) == 0;
+}
+
+void HttpRequestScanner::EndHeaderName() {
+    if (overflow) return;
+
+    if (Matches(kept, length, "upgrade")) {
+        gated = true;
+        upgrade = true;
+    } else if (Matches(kept, length, "content-length") || Matches(kept, length, "transfer-encoding")) {
+        /** The body would have to be skipped to find the next request, and a body we skip could be read as one. */
+        state = State::Invalid;
+    }
+}
+
+void HttpRequestScanner::EndRequest() {
+    if (upgrade) {
+        state = State::WebSocket;
+        return;
+    }
+    if (!gated) passedRequests++;
+    StartRequest();
+}
+
+void HttpRequestScanner::StartRequest() {
+    state = State::Method;
+    upgrade = false;
+    length = 0;
+    overflow = false;
+}
+
+HttpScan HttpRequestScanner::Feed(const char* data, size_t size) {
+    const char* position = data;
+    const char* end = data + size;
+
+    while (position < end && state != State::Invalid) {
+        switch (state) {
+            case State::Method: {
+                const char* delimiter = ByteSearch::FindAny(position, end, ' ', '\r', '\n');
+                if (delimiter > position) length = 1;
+                position = delimiter;
+                if (position == end) break;
+
+                if (*position == ' ') {
+                    /** A request line can't start with a space. */
+                    state = length ? State::TargetPrefix : State::Invalid;
+                    length = 0;
+                } else if (length) {
+                    /** A method without a target. */
+                    state = State::Invalid;
+                }
+                position++;
+                break;
+            }
+            case State::TargetPrefix: {
+                char c = *position++;
+                if (c == ' ' || c == '\r' || c == '\n') {
+                    /** Requests without a version (HTTP/0.9) can't be followed. */
+                    if (c != ' ') {
+                        state = State::Invalid;
+                        break;
+                    }
+                    if (IsGatedTarget()) gated = true;
+                    state = State::Version;
+                    break;
+                }
+
+                kept[length++] = ToLower(c);
+                if (length == TARGET_PREFIX_LENGTH) {
+                    if (IsGatedTarget()) gated = true;
+                    state = State::Target;
+                }
+                break;
+            }
+            case State::Target: {
+                position = ByteSearch::FindAny(position, end, ' ', '\r', '\n');
+                if (position == end) break;
+
+                state = *position == ' ' ? State::Version : State::Invalid;
+                position++;
+                break;
+            }
+            case State::Version: {
+                position = ByteSearch::FindAny(position, end, '\n', '\n', '\n');
+                if (position == end) break;
+
+                state = State::LineStart;
+                position++;
+                break;
+            }
+            case State::LineStart: {
+                char c = *position++;
+                if (c == '\r') {
+                    state = State::HeadersEnd;
+                } else if (c == '\n') {
+                    EndRequest();
+                } else {
+                    state = State::HeaderName;
+                    length = 0;
+                    overflow = false;
+                    position--;
+                }
+                break;
+            }
+            case State::HeaderName: {
+                const char* delimiter = ByteSearch::FindAny(position, end, ':', '\r', '\n');
+                for (; position < delimiter && !overflow; position++) {
+                    /** Whitespace is dropped, so "Upgrade :" can't slip by if the server trims it. */
+                    char c = *position;
+                    if (c == ' ' || c == '\t') continue;
+
+                    if (length < HEADER_NAME_LENGTH) kept[length++] = ToLower(c);
+                    else overflow = true;
+                }
+                position = delimiter;
+                if (position == end) break;
+
+                /** A header line without a colon is malformed. */
+                if (*position++ != ':') {
+                    state = State::Invalid;
+                    break;
+                }
+                state = State::HeaderValue;
+                EndHeaderName();
+                break;
+            }
+            case State::HeaderValue: {
+                position = ByteSearch::FindAny(position, end, '\n', '\n', '\n');
+                if (position == end) break;
+
+                state = State::LineStart;
+                position++;
+                break;
+            }
+            case State::HeadersEnd: {
+                if (*position++ != '\n') {
+                    state = State::Invalid;
+                    break;
+                }
+                EndRequest();
+                break;
+            }
+            case State::WebSocket: {
+                cdp.Feed(position, (size_t)(end - position));
+                position = end;
+                break;
+            }
+            case State::Invalid:
+                break;
+        }
+    }
+
+    if (state == State::Invalid || cdp.Denied()) return HttpScan::Deny;
+    return gated ? HttpScan::Gate : HttpScan::Pass;
+}
+
+/** Same hash as SocketVerdictTable::ShardFor. */
+HttpScanTable::Shard& HttpScanTable::ShardFor(uint64_t socket) const {
+    uint64_t hash = (socket >> 2) * 0x9E3779B97F4A7C15ull;
+    return shards[(hash >> 58) % SHARD_COUNT];
+}
+
+HttpScan HttpScanTable::Feed(uint64_t socket, const char* data, size_t length) {
+    Shard& shard = ShardFor(socket);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    return shard.scanners[socket].Feed(data, length);
+}
+
+void HttpScanTable::Evict(uint64_t socket) {
+    Shard& shard = ShardFor(socket);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    shard.scanners.erase(socket);
+}
+
+size_t HttpScanTable::Size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        std::lock_guard<std::mutex> guard(shards[i].lock);
+        total += shards[i].scanners.size();
+    }
+    return total;
+}
@@ -0,0 +1,79 @@
+#include <latency_histogram.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/** @return The index of the highest set bit, value must not be 0. */
+static uint32_t HighestBit(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return (uint32_t)index;
+#else
+    return 63u - (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+/**
+ * Values below SUB_BUCKET_COUNT get a bucket each. Above that, the exponent picks a group of SUB_BUCKET_COUNT buckets
+ * and the bits right below the highest one pick the bucket within it.
+ */
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+    static constexpr uint64_t MAX_VALUE = (1ull << MAX_EXPONENT) - 1;
+    if (value > MAX_VALUE) value = MAX_VALUE;
+    if (value < SUB_BUCKET_COUNT) return (size_t)value;
+
+    uint32_t exponent = HighestBit(value);
+    uint32_t shift = exponent - SUB_BUCKET_BITS;
+    size_t subBucket = (size_t)((value >> shift) & (SUB_BUCKET_COUNT - 1));
+    return (size_t)(shift + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+    if (index < SUB_BUCKET_COUNT) return index;
+
+    uint32_t shift = (uint32_t)(index / SUB_BUCKET_COUNT) - 1;
+    uint64_t subBucket = index % SUB_BUCKET_COUNT;
+    uint64_t lower = (SUB_BUCKET_COUNT + subBucket) << shift;
+    return lower + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t nanoseconds) {
+    counts[BucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (nanoseconds > current && !max.compare_exchange_weak(current, nanoseconds, std::memory_order_relaxed)) {}
+}
+
+void LatencyHistogram::Read(Snapshot& snapshot) const {
+    snapshot.count = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.counts[i] = counts[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.counts[i];
+    }
+
+    /** The total is taken from the buckets, so percentiles stay consistent with them even while records are coming in. */
+    snapshot.sum = sum.load(std::memory_order_relaxed);
+    snapshot.max = max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::ValueAtQuantile(double quantile) const {
+    if (count == 0) return 0;
+    if (quantile < 0) quantile = 0;
+    if (quantile > 1) quantile = 1;
+
+    uint64_t target = (uint64_t)(quantile * (double)count + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= target) {
+            uint64_t bound = BucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
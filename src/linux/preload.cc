@@ -0,0 +1,509 @@
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <security_check.h>
+#include <process_info.h>
+#include <utilities.h>
+#include <verdict_cache.h>
+#include <http_scanner.h>
+#include <resolver_pool.h>
+#include <debugger_port.h>
+#include <rate_limiter.h>
+#include <decision_log.h>
+#include <metrics.h>
+
+/**
+ * LD_PRELOAD build of Praesidium for the Linux Steam client. It is the same gate as the Windows DLL: the peer of every connection
+ * to the DevTools port is resolved once, and reads from untrusted peers are answered with a 403 instead of reaching CEF.
+ *
+ * LD_PRELOAD is inherited by everything Steam starts, so like the DLL the gate only turns itself on in the steamwebhelper that steam
+ * started, and stays off in -dev mode. Setting PRAESIDIUM_TRUSTED_EXE turns it on in any process, which is how it is tested outside of Steam.
+ *
+ * The trusted executable is taken from PRAESIDIUM_TRUSTED_EXE, or defaults to the executable of our parent process,
+ * which mirrors how the Windows build trusts the steam.exe that started steamwebhelper.
+ *
+ * Only connections to the DevTools port are gated. It is taken from --remote-debugging-port, or learned from the first
+ * socket that listens on loopback when the argument is missing.
+ */
+
+typedef int (*acceptFunctionPtr_t)(int sockfd, struct sockaddr* addr, socklen_t* addrlen);
+typedef int (*accept4FunctionPtr_t)(int sockfd, struct sockaddr* addr, socklen_t* addrlen, int flags);
+typedef int (*closeFunctionPtr_t)(int fd);
+typedef int (*listenFunctionPtr_t)(int sockfd, int backlog);
+typedef ssize_t (*recvFunctionPtr_t)(int sockfd, void* buf, size_t len, int flags);
+typedef ssize_t (*readFunctionPtr_t)(int fd, void* buf, size_t count);
+
+static acceptFunctionPtr_t originalAcceptPtr = nullptr;
+static accept4FunctionPtr_t originalAccept4Ptr = nullptr;
+static closeFunctionPtr_t originalClosePtr = nullptr;
+static listenFunctionPtr_t originalListenPtr = nullptr;
+static recvFunctionPtr_t originalRecvPtr = nullptr;
+static readFunctionPtr_t originalReadPtr = nullptr;
+
+/**
+ * Set once the library is initialized and we are in a process that should be gated. Until then, and in every other process,
+ * the wrappers go straight to libc. It is constant initialized, so it can be read by wrappers called from other libraries' constructors.
+ */
+static std::atomic<bool> gateActive{false};
+
+/** Verdicts for the sockets we have already checked, so each connection is only resolved once. */
+static SocketVerdictTable verdictTable;
+
+static DebuggerPort debuggerPort;
+
+/** The requests read so far on each DevTools connection, so only the ones reaching a DevTools endpoint wait for a verdict. */
+static HttpScanTable requestScanners;
+
+/** Budget of 403 responses per peer process, peers over it are reset without a response. Same numbers as the Windows build. */
+static const uint32_t BLOCK_BURST = 8;
+static const uint32_t BLOCK_REFILL_PER_SECOND = 2;
+static PeerRateLimiter blockLimiter(BLOCK_BURST, BLOCK_REFILL_PER_SECOND);
+
+/**
+ * Set with PRAESIDIUM_RESTRICTED=1. Untrusted peers then get Verdict::Restrict instead of being blocked: they can use DevTools,
+ * but their connection is reset as soon as it sends a method that isn't allowed (see CdpFilter). Only this build has it,
+ * every read here goes through GateRead, which feeds the filter before the data is handed over.
+ */
+static bool restrictedMode = false;
+
+/** Only created when PRAESIDIUM_LOG_DIR is set. Never freed, the writer keeps running until the process exits. */
+static DecisionLog* decisionLog = nullptr;
+
+namespace HttpResponse {
+    static const std::string HTML_TEMPLATE = R"(
+        <!DOCTYPE html>
+        <html lang="en">
+            <head>
+                <meta charset="UTF-8" />
+                <title>403 Forbidden</title>
+            </head>
+            <body>
+                <h1>403 Forbidden</h1>
+                <p>Forbidden: Millennium has blocked you from accessing this resource. Developer tools are only available when in -dev mode to help protect users from potential attacks.</p>
+            </body>
+        </html>
+    )";
+
+    /** The same response as the Windows build sends, built once when the library is loaded. */
+    static std::string CreateForbiddenResponse() {
+        return "HTTP/1.1 403 Forbidden\r\n"
+               "Content-Type: text/html\r\n"
+               "Content-Length: " + std::to_string(HTML_TEMPLATE.size()) + "\r\n"
+               "Connection: close\r\n"
+               "Server: CEFSecureHook\r\n\r\n" + HTML_TEMPLATE;
+    }
+
+    static const std::string FORBIDDEN_RESPONSE = CreateForbiddenResponse();
+}
+
+/** Who we are, who started us and what with, captured once by the constructor. */
+static StartupProbe startup;
+
+namespace SecurityCheck {
+    /**
+     * Resolve the trusted executable from the environment, falling back to our parent's executable.
+     *
+     * @return true if the trusted identity was resolved.
+     */
+    static bool InitializeFromEnvironment() {
+        uint32_t parentPid = startup.parentId;
+
+        const char* trustedPath = getenv("PRAESIDIUM_TRUSTED_EXE");
+        if (trustedPath && *trustedPath) {
+            return Initialize(trustedPath, parentPid);
+        }
+
+        char exeLink[32];
+        char parentPath[PATH_MAX];
+        snprintf(exeLink, sizeof(exeLink), "/proc/%u/exe", parentPid);
+
+        ssize_t length = readlink(exeLink, parentPath, sizeof(parentPath) - 1);
+        if (length <= 0) return false;
+        parentPath[length] = '\0';
+
+        return Initialize(parentPath, parentPid);
+    }
+
+    /**
+     * Take the DevTools port from our own command line, if it was passed there.
+     */
+    static void InitializeDebuggerPort() {
+        if (startup.hasDebuggingPort) {
+            debuggerPort.Configure(startup.debuggingPort);
+        }
+    }
+
+    /**
+     * Decide the verdict for a socket and record it in the decision log.
+     * Blocked peers are charged against their block budget, and get Verdict::Drop once they are over it.
+     * In restricted mode untrusted peers get Verdict::Restrict instead.
+     *
+     * @return Verdict::Allow, Verdict::Block, Verdict::Drop or Verdict::Restrict.
+     */
+    static Verdict ResolveVerdict(int s) {
+        const auto start = std::chrono::steady_clock::now();
+        ResolveTrace& trace = ResolveTrace::Begin();
+
+        uint32_t peerPid = 0;
+        Verdict verdict = Verdict::Allow;
+        if (!IsSteamProcess(s, peerPid)) {
+            if (restrictedMode) verdict = Verdict::Restrict;
+            else verdict = blockLimiter.Consume(peerPid) ? Verdict::Block : Verdict::Drop;
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        Metrics::RecordDecision(verdict, trace, (uint64_t)elapsed.count());
+        if (decisionLog) {
+            decisionLog->Record((uint64_t)s, verdict, trace, (uint64_t)elapsed.count());
+        }
+        return verdict;
+    }
+
+    /**
+     * Reset a connection we accepted ourselves. The linger timeout of 0 makes close send a RST instead of a FIN.
+     */
+    static void RejectConnection(int s) {
+        struct linger abortive = { 1, 0 };
+        setsockopt(s, SOL_SOCKET, SO_LINGER, &abortive, sizeof(abortive));
+        originalClosePtr(s);
+    }
+
+    /**
+     * Block a connection the application already owns. Unlike closesocket on Windows, closing the descriptor under the application
+     * would let its number be reused while the application still uses it, so the connection is shut down instead and the application closes it.
+     * Peers that are over their block budget (Verdict::Drop) get no response, and the linger timeout of 0 makes the final close a RST.
+     */
+    static void BlockConnection(int s, Verdict verdict) {
+        if (verdict == Verdict::Drop) {
+            struct linger abortive = { 1, 0 };
+            setsockopt(s, SOL_SOCKET, SO_LINGER, &abortive, sizeof(abortive));
+        } else {
+            const std::string& response = HttpResponse::FORBIDDEN_RESPONSE;
+            send(s, response.data(), response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        shutdown(s, SHUT_RDWR);
+        errno = ECONNRESET;
+    }
+
+    /**
+     * Only TCP to the DevTools port, over IPv4 or IPv6, is gated. Files, pipes, Unix sockets and anything else pass through.
+     * A socket whose address can't be read is gated, only a descriptor that isn't a socket at all passes on an error.
+     */
+    static bool ShouldGate(int s) {
+        struct sockaddr_storage local = {};
+        socklen_t length = sizeof(local);
+        if (getsockname(s, (struct sockaddr*)&local, &length) != 0) return errno != ENOTSOCK;
+        if (local.ss_family != AF_INET && local.ss_family != AF_INET6) return false;
+
+        /** sin_port and sin6_port are at the same offset. */
+        return debuggerPort.ShouldGate(ntohs(((struct sockaddr_in*)&local)->sin_port));
+    }
+}
+
+/**
+ * Resolves verdicts on a small worker pool instead of the thread reading the socket, see the Windows build.
+ */
+namespace VerdictPipeline {
+    /** How long a read waits for a verdict before failing closed. */
+    static const std::chrono::milliseconds RESOLVE_TIMEOUT(2000);
+    static const size_t WORKER_COUNT = 2;
+
+    /** Never freed, like on Windows. Reset in forked children, which don't inherit the worker threads. */
+    static ResolverPool* pool = nullptr;
+
+    static void Start() {
+        pool = new ResolverPool(WORKER_COUNT, [](uint64_t s) {
+            return SecurityCheck::ResolveVerdict((int)s);
+        });
+    }
+
+    /**
+     * Queue a socket for resolution unless it already has a verdict (or one on the way).
+     * Without a pool (in a forked child) the socket is resolved right away.
+     */
+    static std::shared_ptr<VerdictSlot> Prefetch(int s) {
+        bool created = false;
+        std::shared_ptr<VerdictSlot> slot = verdictTable.Acquire((uint64_t)s, created);
+        if (!created) return slot;
+
+        if (pool) pool->Submit((uint64_t)s, slot);
+        else slot->Publish(SecurityCheck::ResolveVerdict(s));
+        return slot;
+    }
+
+    static Verdict Await(int s) {
+        return Prefetch(s)->Wait(RESOLVE_TIMEOUT);
+    }
+}
+
+/**
+ * Where connections get checked. The read gate is the default, the accept gate can be selected with PRAESIDIUM_GATE=accept.
+ */
+namespace GateMode {
+    enum Mode { Recv, Accept };
+
+    static Mode FromEnvironment() {
+        const char* value = getenv("PRAESIDIUM_GATE");
+        return value && strcasecmp(value, "accept") == 0 ? Accept : Recv;
+    }
+
+    static Mode current = Recv;
+}
+
+/**
+ * Resolve every libc entry point we wrap with a single dlsym each. This normally runs from our constructor, but a wrapper called
+ * from another library's constructor before ours runs it first, so the wrappers never resolve symbols on their own.
+ */
+static void ResolveOriginals() {
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, []() {
+        originalAcceptPtr = (acceptFunctionPtr_t)dlsym(RTLD_NEXT, "accept");
+        originalAccept4Ptr = (accept4FunctionPtr_t)dlsym(RTLD_NEXT, "accept4");
+        originalClosePtr = (closeFunctionPtr_t)dlsym(RTLD_NEXT, "close");
+        originalListenPtr = (listenFunctionPtr_t)dlsym(RTLD_NEXT, "listen");
+        originalRecvPtr = (recvFunctionPtr_t)dlsym(RTLD_NEXT, "recv");
+        originalReadPtr = (readFunctionPtr_t)dlsym(RTLD_NEXT, "read");
+    });
+}
+
+/**
+ * Everything Steam starts inherits LD_PRELOAD, so nearly every process we are loaded into can be ruled out by its name alone,
+ * like the version.dll proxy does on Windows. PR_GET_NAME gives the same name as /proc/self/stat without opening a file.
+ */
+static bool MayActivate() {
+    const char* trustedPath = getenv("PRAESIDIUM_TRUSTED_EXE");
+    if (trustedPath && *trustedPath) return true;
+
+    char name[16] = {0};
+    return prctl(PR_GET_NAME, name, 0, 0, 0) == 0 && strcmp(name, "steamwebhelper") == 0;
+}
+
+/**
+ * Steamwebhelper started by steam, outside of -dev mode, just like DllMain checks on Windows.
+ */
+static bool ShouldActivate() {
+    if (startup.developerMode) return false;
+
+    const char* trustedPath = getenv("PRAESIDIUM_TRUSTED_EXE");
+    return (trustedPath && *trustedPath) || startup.IsSteamWebHelper();
+}
+
+static uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Unlike DllMain, the constructor isn't holding up anything else, so the gate is started right here.
+ * It records the same startup timings, the whole constructor counting as the attach.
+ */
+__attribute__((constructor)) static void PraesidiumInitialize() {
+    /** The wrappers resolve the originals themselves when they are first called, so a process ruled out here does nothing else. */
+    if (!MayActivate()) return;
+
+    const auto attachStart = std::chrono::steady_clock::now();
+    ResolveOriginals();
+    CaptureStartupProbe(startup);
+    const uint64_t probeNanoseconds = NanosecondsSince(attachStart);
+    if (!ShouldActivate()) return;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    SecurityCheck::InitializeFromEnvironment();
+    SecurityCheck::InitializeDebuggerPort();
+
+    const char* policyPath = getenv("PRAESIDIUM_POLICY");
+    if (policyPath && *policyPath) {
+        SecurityCheck::InitializePolicy(policyPath);
+    }
+    GateMode::current = GateMode::FromEnvironment();
+
+    const char* restricted = getenv("PRAESIDIUM_RESTRICTED");
+    restrictedMode = restricted && strcmp(restricted, "1") == 0;
+
+    Metrics::Initialize();
+
+    const char* logDirectory = getenv("PRAESIDIUM_LOG_DIR");
+    if (logDirectory && *logDirectory) {
+        decisionLog = new DecisionLog(logDirectory);
+    }
+
+    VerdictPipeline::Start();
+    pthread_atfork(nullptr, nullptr, []() {
+        VerdictPipeline::pool = nullptr;
+        Metrics::Detach();
+    });
+
+    Metrics::RecordStartup(probeNanoseconds, NanosecondsSince(attachStart), NanosecondsSince(start));
+    gateActive.store(true, std::memory_order_release);
+}
+
+/**
+ * Remove our metrics segment, POSIX shared memory stays around until it is unlinked.
+ * A forked child has detached from its parent's segment by now, so this leaves that one alone.
+ */
+__attribute__((destructor)) static void PraesidiumShutdown() {
+    if (gateActive.load(std::memory_order_acquire)) Metrics::Shutdown();
+}
+
+/**
+ * Check what was just read from a descriptor, the equivalent of HookedRecv on Windows.
+ * Anything that isn't a socket to the DevTools port is marked as allowed on its first read, so later reads of it are one lookup.
+ * On the DevTools port only reads that reach a DevTools endpoint wait for the verdict, see HttpRequestScanner.
+ * Restricted peers are let through until they send a denied method.
+ *
+ * @param fd The descriptor that was read.
+ * @param buf The bytes that were read.
+ * @param result What the read returned.
+ * @param peek Whether the bytes were only peeked at.
+ * @return The result to hand back to the caller: the read result if the descriptor is allowed, -1 with errno set if it was blocked.
+ */
+static ssize_t GateRead(int fd, const void* buf, ssize_t result, bool peek) {
+    if (result <= 0) return result;
+
+    Verdict verdict = verdictTable.Lookup((uint64_t)fd);
+    if (verdict == Verdict::Allow) return result;
+
+    if (verdict == Verdict::Unknown && !SecurityCheck::ShouldGate(fd)) {
+        verdictTable.Insert((uint64_t)fd, Verdict::Allow);
+        return result;
+    }
+
+    /** A blocked descriptor doesn't get to hand over anything else, whatever the bytes are. */
+    if (verdict == Verdict::Block || verdict == Verdict::Drop) {
+        SecurityCheck::BlockConnection(fd, verdict);
+        return -1;
+    }
+
+    /** Peeked bytes are read again later, so only the read that consumes them is scanned. */
+    HttpScan scan = peek ? HttpScan::Gate : requestScanners.Feed((uint64_t)fd, (const char*)buf, (size_t)result);
+    if (scan == HttpScan::Pass) return result;
+
+    if (verdict == Verdict::Unknown || verdict == Verdict::Pending) {
+        verdict = VerdictPipeline::Await(fd);
+    }
+
+    if (verdict == Verdict::Allow) return result;
+
+    if (verdict == Verdict::Restrict) {
+        if (scan != HttpScan::Deny) return result;
+
+        /** Usually a WebSocket by now, where a 403 would be garbage, so the connection is reset. */
+        Metrics::RecordDenied();
+        verdict = Verdict::Drop;
+    }
+
+    SecurityCheck::BlockConnection(fd, verdict);
+    return -1;
+}
+
+extern "C" __attribute__((visibility("default"))) ssize_t recv(int sockfd, void* buf, size_t len, int flags) {
+    if (!originalRecvPtr) ResolveOriginals();
+
+    ssize_t result = originalRecvPtr(sockfd, buf, len, flags);
+    if (!gateActive.load(std::memory_order_acquire)) return result;
+    return GateRead(sockfd, buf, result, (flags & MSG_PEEK) != 0);
+}
+
+/** Chromium reads its sockets with read() rather than recv(). */
+extern "C" __attribute__((visibility("default"))) ssize_t read(int fd, void* buf, size_t count) {
+    if (!originalReadPtr) ResolveOriginals();
+
+    ssize_t result = originalReadPtr(fd, buf, count);
+    if (!gateActive.load(std::memory_order_acquire)) return result;
+    return GateRead(fd, buf, result, false);
+}
+
+/**
+ * Descriptor numbers are reused by the next open, accept or socket call, so the cached verdict has to go first.
+ */
+extern "C" __attribute__((visibility("default"))) int close(int fd) {
+    if (!originalClosePtr) ResolveOriginals();
+
+    if (gateActive.load(std::memory_order_acquire)) {
+        requestScanners.Evict((uint64_t)fd);
+        verdictTable.Evict((uint64_t)fd);
+    }
+    return originalClosePtr(fd);
+}
+
+/**
+ * Accept the next trusted connection, resetting untrusted ones on the way (the accept gate), or queue a new connection with the resolver
+ * so its verdict is usually ready by its first read (the read gate).
+ * On a non-blocking listener the accept gate ends with EAGAIN once the backlog is empty, exactly like the unwrapped call.
+ *
+ * Descriptors closed inside libc (fclose, closedir) don't go through our close, so whatever verdict an accepted descriptor's number
+ * had before is replaced here.
+ */
+static int GatedAccept(int sockfd, struct sockaddr* addr, socklen_t* addrlen, int flags, bool useAccept4) {
+    if (!originalAcceptPtr) ResolveOriginals();
+
+    const socklen_t addrCapacity = addrlen ? *addrlen : 0;
+
+    for (;;) {
+        if (addrlen) *addrlen = addrCapacity;
+
+        int client = useAccept4 ? originalAccept4Ptr(sockfd, addr, addrlen, flags) : originalAcceptPtr(sockfd, addr, addrlen);
+        if (client < 0 || !gateActive.load(std::memory_order_acquire)) return client;
+
+        requestScanners.Evict((uint64_t)client);
+        verdictTable.Evict((uint64_t)client);
+
+        if (!SecurityCheck::ShouldGate(client)) {
+            verdictTable.Insert((uint64_t)client, Verdict::Allow);
+            return client;
+        }
+
+        if (GateMode::current == GateMode::Recv) {
+            VerdictPipeline::Prefetch(client);
+            return client;
+        }
+
+        Verdict verdict = SecurityCheck::ResolveVerdict(client);
+        if (verdict == Verdict::Allow || verdict == Verdict::Restrict) {
+            verdictTable.Insert((uint64_t)client, verdict);
+            return client;
+        }
+
+        SecurityCheck::RejectConnection(client);
+    }
+}
+
+extern "C" __attribute__((visibility("default"))) int accept(int sockfd, struct sockaddr* addr, socklen_t* addrlen) {
+    return GatedAccept(sockfd, addr, addrlen, 0, false);
+}
+
+extern "C" __attribute__((visibility("default"))) int accept4(int sockfd, struct sockaddr* addr, socklen_t* addrlen, int flags) {
+    return GatedAccept(sockfd, addr, addrlen, flags, true);
+}
+
+/**
+ * Learn the DevTools port from the first socket listening on loopback, unless the command line already told us.
+ */
+extern "C" __attribute__((visibility("default"))) int listen(int sockfd, int backlog) {
+    if (!originalListenPtr) ResolveOriginals();
+
+    int result = originalListenPtr(sockfd, backlog);
+    if (result != 0 || debuggerPort.Get() != 0) return result;
+
+    struct sockaddr_storage local = {};
+    socklen_t length = sizeof(local);
+    if (getsockname(sockfd, (struct sockaddr*)&local, &length) != 0) return result;
+
+    const struct sockaddr_in& v4 = (const struct sockaddr_in&)local;
+    const struct sockaddr_in6& v6 = (const struct sockaddr_in6&)local;
+    bool loopback = local.ss_family == AF_INET ? ntohl(v4.sin_addr.s_addr) == INADDR_LOOPBACK
+        : local.ss_family == AF_INET6 && IN6_IS_ADDR_LOOPBACK(&v6.sin6_addr);
+    if (loopback) debuggerPort.Learn(ntohs(v4.sin_port));
+    return result;
+}
@@ -0,0 +1,138 @@
+#include <sock_diag.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+
+namespace {
+    /**
+     * Each resolving thread keeps its own netlink socket, so queries never share a sequence number space or a receive buffer.
+     * It is closed when the thread exits.
+     */
+    struct DiagSocket {
+        int fd = -1;
+        uint32_t sequence = 0;
+
+        ~DiagSocket() {
+            if (fd >= 0) close(fd);
+        }
+    };
+
+    /** Set once socket() fails, so a kernel without sock_diag doesn't pay for a failed syscall on every lookup. */
+    std::atomic<bool> unavailable{false};
+
+    /**
+     * Set once a query has found a socket. A kernel without the tcp_diag module answers ENOENT for every connection, which
+     * looks exactly like a connection that is gone, so NotFound is only trusted after netlink has proven that it works.
+     */
+    std::atomic<bool> confirmed{false};
+}
+
+SockDiag::Result SockDiag::QueryInode(const TcpConnectionKey& key, uint64_t& inode) {
+    if (unavailable.load(std::memory_order_relaxed)) return Result::Unavailable;
+
+    thread_local DiagSocket diag;
+    if (diag.fd < 0) {
+        diag.fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+        if (diag.fd < 0) {
+            unavailable.store(true, std::memory_order_relaxed);
+            return Result::Unavailable;
+        }
+    }
+
+    struct {
+        struct nlmsghdr header;
+        struct inet_diag_req_v2 body;
+    } request = {};
+
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+    request.header.nlmsg_flags = NLM_F_REQUEST;
+    request.header.nlmsg_seq = ++diag.sequence;
+
+    /** Without NLM_F_DUMP this is an exact lookup by 4-tuple, the kernel doesn't walk its tables. */
+    request.body.sdiag_family = AF_INET;
+    request.body.sdiag_protocol = IPPROTO_TCP;
+    request.body.idiag_states = ~0u;
+    request.body.id.idiag_sport = htons(key.localPort);
+    request.body.id.idiag_dport = htons(key.remotePort);
+    request.body.id.idiag_src[0] = htonl(key.localIP);
+    request.body.id.idiag_dst[0] = htonl(key.remoteIP);
+    request.body.id.idiag_cookie[0] = INET_DIAG_NOCOOKIE;
+    request.body.id.idiag_cookie[1] = INET_DIAG_NOCOOKIE;
+
+    struct sockaddr_nl kernel = {};
+    kernel.nl_family = AF_NETLINK;
+    if (sendto(diag.fd, &request, sizeof(request), 0, (struct sockaddr*)&kernel, sizeof(kernel)) != (ssize_t)sizeof(request)) {
+        return Result::Unavailable;
+    }
+
+    alignas(struct nlmsghdr) char response[1024];
+    for (;;) {
+        ssize_t length = recv(diag.fd, response, sizeof(response), 0);
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) return Result::Unavailable;
+
+        int remaining = (int)length;
+        for (struct nlmsghdr* message = (struct nlmsghdr*)response; NLMSG_OK(message, remaining); message = NLMSG_NEXT(message, remaining)) {
+            /** Skip what's left of an earlier query that was abandoned halfway. */
+            if (message->nlmsg_seq != diag.sequence) continue;
+
+            if (message->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr* error = (const struct nlmsgerr*)NLMSG_DATA(message);
+                if (error->error == -ENOENT && confirmed.load(std::memory_order_relaxed)) return Result::NotFound;
+                return Result::Unavailable;
+            }
+
+            if (message->nlmsg_type == SOCK_DIAG_BY_FAMILY && message->nlmsg_len >= NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+                const struct inet_diag_msg* socketInfo = (const struct inet_diag_msg*)NLMSG_DATA(message);
+                inode = socketInfo->idiag_inode;
+                confirmed.store(true, std::memory_order_relaxed);
+                return inode != 0 ? Result::Found : Result::NotFound;
+            }
+        }
+    }
+}
+
+/** 
+ * Each row is "sl local_address rem_address st tx_queue:rx_queue tr:tm->when retrnsmt uid timeout inode ...", with addresses
+ * printed as the hex value of the IPv4 address in network byte order and ports in host byte order.
+ * https://www.kernel.org/doc/Documentation/networking/proc_net_tcp.txt
+ */
+bool SockDiag::ScanInode(const TcpConnectionKey& key, uint64_t& inode) {
+    FILE* table = fopen("/proc/net/tcp", "re");
+    if (!table) return false;
+
+    char line[512];
+    bool found = false;
+
+    /** Skip the header line. */
+    if (!fgets(line, sizeof(line), table)) {
+        fclose(table);
+        return false;
+    }
+
+    while (!found && fgets(line, sizeof(line), table)) {
+        unsigned int localIP, localPort, remoteIP, remotePort;
+        unsigned long long rowInode;
+
+        if (sscanf(line, " %*u: %x:%x %x:%x %*x %*x:%*x %*x:%*x %*x %*u %*u %llu", &localIP, &localPort, &remoteIP, &remotePort, &rowInode) != 5) {
+            continue;
+        }
+
+        if (ntohl(localIP) == key.localIP && localPort == key.localPort && ntohl(remoteIP) == key.remoteIP && remotePort == key.remotePort) {
+            inode = rowInode;
+            found = rowInode != 0;
+        }
+    }
+
+    fclose(table);
+    return found;
+}
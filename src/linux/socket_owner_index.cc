@@ -0,0 +1,224 @@
+#include <socket_owner_index.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * Parse the target of a descriptor link.
+ *
+ * @param target The link target, "socket:[inode]" for sockets.
+ * @param length The length of the target.
+ * @param inode Receives the socket inode.
+ * @return true if the descriptor is a socket.
+ */
+static bool ParseSocketLink(const char* target, ssize_t length, uint64_t& inode) {
+    static const char prefix[] = "socket:[";
+    const ssize_t prefixLength = sizeof(prefix) - 1;
+    if (length <= prefixLength + 1 || memcmp(target, prefix, prefixLength) != 0 || target[length - 1] != ']') return false;
+
+    uint64_t value = 0;
+    for (ssize_t i = prefixLength; i < length - 1; i++) {
+        if (target[i] < '0' || target[i] > '9') return false;
+        value = value * 10 + (uint64_t)(target[i] - '0');
+    }
+    inode = value;
+    return true;
+}
+
+/**
+ * Call a function with every socket descriptor of a process.
+ *
+ * @return false if the descriptors of the process can't be listed (it exited, or we aren't allowed to).
+ */
+template <typename Callback>
+static bool ForEachSocket(uint32_t processId, Callback callback) {
+    char fdPath[64];
+    snprintf(fdPath, sizeof(fdPath), "/proc/%u/fd", processId);
+
+    DIR* fds = opendir(fdPath);
+    if (!fds) return false;
+
+    struct dirent* fd;
+    while ((fd = readdir(fds)) != NULL) {
+        if (fd->d_name[0] == '.') continue;
+
+        char target[64];
+        uint64_t inode;
+        ssize_t length = readlinkat(dirfd(fds), fd->d_name, target, sizeof(target));
+        if (ParseSocketLink(target, length, inode) && !callback(inode, atoi(fd->d_name))) break;
+    }
+    closedir(fds);
+    return true;
+}
+
+/**
+ * Call a function with the ID of every process.
+ */
+template <typename Callback>
+static void ForEachProcess(Callback callback) {
+    DIR* proc = opendir("/proc");
+    if (!proc) return;
+
+    struct dirent* process;
+    while ((process = readdir(proc)) != NULL) {
+        char* end = NULL;
+        unsigned long pid = strtoul(process->d_name, &end, 10);
+        if (*end != '\0' || pid == 0) continue;
+
+        if (!callback((uint32_t)pid)) break;
+    }
+    closedir(proc);
+}
+
+bool SocketOwnerIndex::ScanOwners(uint64_t inode, uint32_t* owners, size_t& count) {
+    count = 0;
+    bool overflow = false;
+    ForEachProcess([&](uint32_t processId) {
+        bool holds = false;
+        ForEachSocket(processId, [&](uint64_t socketInode, int) {
+            holds = socketInode == inode;
+            return !holds;
+        });
+        if (!holds) return true;
+
+        if (count == MAX_HOLDERS) {
+            overflow = true;
+            return false;
+        }
+        owners[count++] = processId;
+        return true;
+    });
+    return count > 0 && !overflow;
+}
+
+/**
+ * Confirm that an indexed descriptor still holds the socket. Inodes aren't reused while the socket is open, but the descriptor
+ * may have been closed and its number reused, or the process may have exited and its PID been given to another one.
+ */
+bool SocketOwnerIndex::IsHeldBy(uint64_t inode, const Holder& holder) const {
+    char fdPath[64];
+    snprintf(fdPath, sizeof(fdPath), "/proc/%u/fd/%d", holder.processId, holder.fd);
+
+    char target[64];
+    uint64_t heldInode;
+    ssize_t length = readlink(fdPath, target, sizeof(target));
+    return ParseSocketLink(target, length, heldInode) && heldInode == inode;
+}
+
+/** A process holding the socket through several descriptors is kept once, with the last descriptor found. */
+void SocketOwnerIndex::AddHolder(uint64_t inode, uint32_t processId, int fd) {
+    Holders& entry = holders[inode];
+    for (uint8_t i = 0; i < entry.count; i++) {
+        if (entry.holders[i].processId == processId) {
+            entry.holders[i].fd = fd;
+            return;
+        }
+    }
+
+    if (entry.count == MAX_HOLDERS) {
+        entry.overflow = true;
+        return;
+    }
+    entry.holders[entry.count++] = { processId, fd };
+}
+
+bool SocketOwnerIndex::ScanProcess(uint32_t processId, uint64_t wanted) {
+    bool found = false;
+    ForEachSocket(processId, [&](uint64_t inode, int fd) {
+        AddHolder(inode, processId, fd);
+        found = inode == wanted;
+        return !found;
+    });
+    return found;
+}
+
+void SocketOwnerIndex::Rebuild() {
+    holders.clear();
+    ForEachProcess([&](uint32_t processId) {
+        ScanProcess(processId, 0);
+        return true;
+    });
+    for (auto& entry : holders) entry.second.complete = true;
+}
+
+SocketOwnerIndex::Lookup SocketOwnerIndex::Confirm(uint64_t inode, uint32_t* owners, size_t& count, bool all, bool& complete) {
+    auto it = holders.find(inode);
+    if (it == holders.end()) return Lookup::Missing;
+
+    Holders& entry = it->second;
+    if (entry.overflow) return Lookup::Overflow;
+
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < entry.count; i++) {
+        if (IsHeldBy(inode, entry.holders[i])) entry.holders[kept++] = entry.holders[i];
+    }
+    /** A process that let go of the descriptor we know may still hold the socket through another one, so it can't be left out as complete. */
+    if (kept != entry.count) entry.complete = false;
+    entry.count = kept;
+
+    if (kept == 0) return Lookup::Missing;
+    if (all && !entry.complete) return Lookup::Incomplete;
+
+    count = kept;
+    for (uint8_t i = 0; i < kept; i++) owners[i] = entry.holders[i].processId;
+    complete = entry.complete;
+    return Lookup::Found;
+}
+
+void SocketOwnerIndex::NoteOwner(uint32_t processId) {
+    size_t position = 0;
+    while (position < recentOwnerCount && recentOwners[position] != processId) position++;
+
+    if (position == recentOwnerCount) {
+        if (recentOwnerCount < RECENT_OWNER_COUNT) recentOwnerCount++;
+        position = recentOwnerCount - 1;
+    }
+
+    memmove(&recentOwners[1], &recentOwners[0], position * sizeof(recentOwners[0]));
+    recentOwners[0] = processId;
+}
+
+bool SocketOwnerIndex::FindOwners(uint64_t inode, uint32_t* owners, size_t& count, bool all, bool& complete) {
+    std::lock_guard<std::mutex> guard(lock);
+    count = 0;
+    complete = false;
+
+    Lookup lookup = Confirm(inode, owners, count, all, complete);
+    if (lookup == Lookup::Found) {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        NoteOwner(owners[0]);
+        return true;
+    }
+    if (lookup == Lookup::Overflow) return false;
+
+    /** Rescanning the recent owners can't tell whether any other process holds the socket too, so it only serves partial lookups. */
+    if (!all && holders.size() < MAX_ENTRIES && recentOwnerCount > 0) {
+        /** Stop at the first owner that holds the socket, the rest of its descriptors are picked up by later rescans. */
+        for (size_t i = 0; i < recentOwnerCount; i++) {
+            if (ScanProcess(recentOwners[i], inode) && Confirm(inode, owners, count, false, complete) == Lookup::Found) {
+                ownerRescans.fetch_add(1, std::memory_order_relaxed);
+                NoteOwner(owners[0]);
+                return true;
+            }
+        }
+    }
+
+    fullRescans.fetch_add(1, std::memory_order_relaxed);
+    Rebuild();
+    if (Confirm(inode, owners, count, all, complete) != Lookup::Found) return false;
+
+    NoteOwner(owners[0]);
+    return true;
+}
+
+SocketOwnerIndex::Counters SocketOwnerIndex::GetCounters() const {
+    return { hits.load(std::memory_order_relaxed), ownerRescans.load(std::memory_order_relaxed), fullRescans.load(std::memory_order_relaxed) };
+}
+
+size_t SocketOwnerIndex::Size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return holders.size();
+}
@@ -0,0 +1,224 @@
+#include <socket_trace.h>
+#include <resolve_trace.h>
+#include <sock_diag.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <unistd.h>
+
+/** 
+ * Get the cache of process images, shared by every thread resolving a socket.
+ * 
+ * @return The process image cache.
+ */
+ProcessPathCache& SocketProcessResolver::GetProcessPathCache() {
+    static ProcessPathCache cache(64);
+    return cache;
+}
+
+/** 
+ * Get the index of socket owners, shared by every thread resolving a socket.
+ * 
+ * @return The socket owner index.
+ */
+SocketOwnerIndex& SocketProcessResolver::GetSocketOwnerIndex() {
+    static SocketOwnerIndex index;
+    return index;
+}
+
+/** 
+ * Find the inode of the socket with the given 4-tuple, asking the kernel for that one connection over sock_diag
+ * and only scanning /proc/net/tcp if netlink can't be used.
+ * 
+ * @param key The 4-tuple of the socket, from the owner's point of view.
+ * @param inode Receives the inode of the socket.
+ * @return true if the socket was found.
+ */
+bool SocketProcessResolver::FindSocketInode(const TcpConnectionKey& key, uint64_t* inode) {
+    PhaseTimer timer(ResolvePhase::TcpTable);
+    switch (SockDiag::QueryInode(key, *inode)) {
+        case SockDiag::Result::Found:
+            return true;
+        case SockDiag::Result::NotFound:
+            return false;
+        case SockDiag::Result::Unavailable:
+            break;
+    }
+    return SockDiag::ScanInode(key, *inode);
+}
+
+static_assert(SocketHolders::CAPACITY == SocketOwnerIndex::MAX_HOLDERS, "a socket's holders have to fit");
+
+/** 
+ * Find the processes holding a socket inode.
+ * 
+ * @param inode The inode of the socket.
+ * @param holders Receives the IDs of the processes holding it.
+ * @param all Whether every holder has to be found, see SocketOwnerIndex::FindOwners.
+ * @return true if the holders were found.
+ */
+bool SocketProcessResolver::FindInodeOwners(uint64_t inode, SocketHolders& holders, bool all) {
+    PhaseTimer timer(ResolvePhase::MatchProcess);
+    return GetSocketOwnerIndex().FindOwners(inode, holders.processIds, holders.count, all, holders.complete);
+}
+
+/** 
+ * Get the executable path and file identity of a process from /proc/<pid>/exe.
+ * 
+ * @param processId The ID of the process.
+ * @param image Receives the full path and file identity of the executable.
+ * @return ResolveResult::Ok if the path was found.
+ */
+ResolveResult SocketProcessResolver::GetExecutableNameFromPID(uint32_t processId, ProcessImage& image) {
+    ProcessKey key = { processId, 0 };
+    bool hasStartTime = GetProcessStartTime(processId, key.startTime);
+
+    if (hasStartTime && GetProcessPathCache().Lookup(key, image)) {
+        return ResolveResult::Ok;
+    }
+
+    PhaseTimer timer(ResolvePhase::ProcessImage);
+    char exePath[32];
+    snprintf(exePath, sizeof(exePath), "/proc/%u/exe", processId);
+
+    char processPath[PROCESS_PATH_CAPACITY];
+    ssize_t length = readlink(exePath, processPath, sizeof(processPath));
+    if (length <= 0) {
+        return ResolveResult::ProcessQueryFailed;
+    }
+    if ((size_t)length >= sizeof(processPath) || !image.path.Assign(std::string_view(processPath, (size_t)length))) {
+        return ResolveResult::PathTooLong;
+    }
+
+    image.identity = FileIdentity();
+    GetProcessFileIdentity(processId, image.identity);
+
+    /** Only cache if the PID still belongs to the process we read the start time from. */
+    uint64_t startTimeAfter = 0;
+    if (hasStartTime && image.identity.IsValid() && GetProcessStartTime(processId, startTimeAfter) && startTimeAfter == key.startTime) {
+        GetProcessPathCache().Insert(key, image);
+    }
+    return ResolveResult::Ok;
+}
+
+/** 
+ * Read an IPv4 address and port, either from an AF_INET address or from an IPv4-mapped AF_INET6 one (::ffff:a.b.c.d),
+ * which is what a dual-stack listener sees for an IPv4 peer.
+ * 
+ * @param address The address.
+ * @param ip Receives the IPv4 address, in host byte order.
+ * @param port Receives the port, in host byte order.
+ * @return false for any other address, native IPv6 peers can't be looked up in the IPv4 TCP table.
+ */
+static bool ReadIPv4Address(const struct sockaddr_storage& address, uint32_t& ip, uint16_t& port) {
+    if (address.ss_family == AF_INET) {
+        const struct sockaddr_in& v4 = (const struct sockaddr_in&)address;
+        ip = ntohl(v4.sin_addr.s_addr);
+        port = ntohs(v4.sin_port);
+        return true;
+    }
+
+    const struct sockaddr_in6& v6 = (const struct sockaddr_in6&)address;
+    if (address.ss_family != AF_INET6 || !IN6_IS_ADDR_V4MAPPED(&v6.sin6_addr)) return false;
+
+    uint32_t mapped;
+    memcpy(&mapped, &v6.sin6_addr.s6_addr[12], sizeof(mapped));
+    ip = ntohl(mapped);
+    port = ntohs(v6.sin6_port);
+    return true;
+}
+
+/** 
+ * Find the inode of the other end of a socket.
+ * 
+ * @param s The socket to query.
+ * @param inode Receives the inode of the peer's socket.
+ * @return ResolveResult::Ok if the connection was found, otherwise the reason it couldn't be.
+ */
+ResolveResult SocketProcessResolver::FindPeerInode(SocketHandle s, uint64_t* inode) {
+    struct sockaddr_storage remoteAddr = {};
+    struct sockaddr_storage localAddr = {};
+    socklen_t remoteLength = sizeof(remoteAddr);
+    socklen_t localLength = sizeof(localAddr);
+
+    /** The row we are after is the one owned by the peer, so its local end is the remote end of our socket and vice versa. */
+    TcpConnectionKey key = {};
+    {
+        PhaseTimer timer(ResolvePhase::PeerAddress);
+        if (getpeername(s, (struct sockaddr*)&remoteAddr, &remoteLength) != 0 || !ReadIPv4Address(remoteAddr, key.localIP, key.localPort)) {
+            return ResolveResult::NoPeerAddress;
+        }
+        if (getsockname(s, (struct sockaddr*)&localAddr, &localLength) != 0 || !ReadIPv4Address(localAddr, key.remoteIP, key.remotePort)) {
+            return ResolveResult::NoPeerAddress;
+        }
+    }
+
+    ResolveTrace& trace = ResolveTrace::Current();
+    trace.connection.localIP = key.remoteIP;
+    trace.connection.localPort = key.remotePort;
+    trace.connection.remoteIP = key.localIP;
+    trace.connection.remotePort = key.localPort;
+
+    return FindSocketInode(key, inode) ? ResolveResult::Ok : ResolveResult::ConnectionNotFound;
+}
+
+/** 
+ * Resolve the processes holding the other end of a socket.
+ * 
+ * @param s The socket to query.
+ * @param holders Receives the IDs of the processes holding the other end.
+ * @param all Whether every holder has to be found, which can take a scan of every process.
+ * @return ResolveResult::Ok if the holders were found, otherwise the reason they couldn't be.
+ */
+ResolveResult SocketProcessResolver::ResolveRemoteHolders(SocketHandle s, SocketHolders& holders, bool all) {
+    holders.count = 0;
+    holders.complete = false;
+
+    uint64_t inode = 0;
+    ResolveResult result = FindPeerInode(s, &inode);
+    if (result != ResolveResult::Ok) {
+        return result;
+    }
+    if (!FindInodeOwners(inode, holders, all)) {
+        return ResolveResult::ConnectionNotFound;
+    }
+    ResolveTrace::Current().owningPid = holders.processIds[0];
+    return ResolveResult::Ok;
+}
+
+/** 
+ * Resolve the ID of a process on the other end of a socket.
+ * 
+ * @param s The socket to query.
+ * @param owningPid Receives the ID of the first process found holding the other end.
+ * @return ResolveResult::Ok if the connection was found, otherwise the reason it couldn't be.
+ */
+ResolveResult SocketProcessResolver::ResolveRemoteProcessId(SocketHandle s, uint32_t* owningPid) {
+    SocketHolders holders;
+    ResolveResult result = ResolveRemoteHolders(s, holders, false);
+    if (result == ResolveResult::Ok) {
+        *owningPid = holders.processIds[0];
+    }
+    return result;
+}
+
+/** 
+ * Resolve the process on the other end of a socket.
+ * 
+ * @param s The socket to query.
+ * @param process Receives the owning process ID and the full path of its executable.
+ * @return ResolveResult::Ok if the process was resolved, otherwise the reason it couldn't be.
+ */
+ResolveResult SocketProcessResolver::ResolveRemoteProcess(SocketHandle s, RemoteProcess& process) {
+    process.processId = 0;
+    process.image.path.Clear();
+    process.image.identity = FileIdentity();
+
+    uint32_t owningPid = 0;
+    ResolveResult result = ResolveRemoteProcessId(s, &owningPid);
+    if (result != ResolveResult::Ok) {
+        return result;
+    }
+
+    process.processId = owningPid;
+    return GetExecutableNameFromPID(owningPid, process.image);
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <string_view>
+#include <utilities.h>
+#include <command_line.h>
+#include <debugger_port.h>
+
+/** 
+ * Reads the command line of the current process. /proc/self/cmdline holds every argument followed by a NUL byte.
+ * It is read through stdio, which doesn't go through the read() we interpose in the LD_PRELOAD build.
+ * 
+ * @return The raw command line, or an empty string if it cannot be read.
+ */
+static std::string ReadCommandLine() {
+    FILE* file = fopen("/proc/self/cmdline", "re");
+    if (!file) return {};
+
+    std::string commandLine;
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        commandLine.append(buffer, length);
+    }
+    fclose(file);
+    return commandLine;
+}
+
+/** 
+ * Reads the fields of /proc/<pid>/stat the probe needs, numbered as in proc(5).
+ * The name is the second field, in parentheses, and may itself contain parentheses, so it ends at the last one.
+ * The kernel truncates it to 15 characters.
+ * 
+ * @param statPath The path of the stat file, /proc/self/stat or /proc/<pid>/stat.
+ * @param name Receives the name of the process.
+ * @param parentId Receives the parent PID, field 4.
+ * @param startTime Receives the start time, field 22, in clock ticks since boot.
+ * @return True if the file was read and had every field, false otherwise.
+ */
+static bool ReadProcessStat(const char* statPath, std::string& name, uint32_t& parentId, uint64_t& startTime) {
+    FILE* file = fopen(statPath, "re");
+    if (!file) return false;
+
+    char buffer[1024];
+    size_t length = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+
+    const char* start = strchr(buffer, '(');
+    const char* end = strrchr(buffer, ')');
+    if (!start || !end || end < start) return false;
+    name.assign(start + 1, end - start - 1);
+
+    /** The space after the name precedes field 3 (the state), every following space precedes the next field. */
+    const char* cursor = end;
+    for (int field = 3; field <= 22; field++) {
+        cursor = strchr(cursor + 1, ' ');
+        if (!cursor) return false;
+
+        if (field == 4) parentId = (uint32_t)strtoul(cursor + 1, nullptr, 10);
+    }
+    startTime = strtoull(cursor + 1, nullptr, 10);
+    return true;
+}
+
+/** 
+ * Captures the probe from one read of /proc/self/stat, /proc/<ppid>/stat and /proc/self/cmdline each.
+ * A parent that started after us can't have started us: steam exited and its PID was handed to another process.
+ * 
+ * @param probe Receives the probe.
+ * @return True if /proc/self/stat could be read, false otherwise.
+ */
+bool CaptureStartupProbe(StartupProbe& probe) {
+    probe.processId = (uint32_t)getpid();
+
+    uint64_t startTime = 0;
+    bool found = ReadProcessStat("/proc/self/stat", probe.processName, probe.parentId, startTime);
+
+    if (found && probe.parentId) {
+        char parentStat[32];
+        snprintf(parentStat, sizeof(parentStat), "/proc/%u/stat", probe.parentId);
+
+        uint32_t grandparentId = 0;
+        uint64_t parentStartTime = 0;
+        if (ReadProcessStat(parentStat, probe.parentName, grandparentId, parentStartTime) && parentStartTime > startTime) {
+            probe.parentName.clear();
+        }
+    }
+
+    CommandLine commandLine = CommandLine::FromNullSeparated(ReadCommandLine());
+    probe.developerMode = commandLine.Has("-dev");
+
+    std::string_view steamPath;
+    if (commandLine.Get("-steampath", steamPath)) probe.steamPath = std::string(steamPath);
+
+    probe.hasDebuggingPort = ParseRemoteDebuggingPort(commandLine, probe.debuggingPort);
+    return found;
+}
+
+/** 
+ * Checks if the current process is "steamwebhelper" and its parent is "steam".
+ * 
+ * @return True if the current process is steamwebhelper and its parent is steam, false otherwise.
+ */
+bool StartupProbe::IsSteamWebHelper() const {
+    return processName == "steamwebhelper" && parentName == "steam";
+}
\ No newline at end of file
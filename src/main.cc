@@ -11,12 +11,70 @@
 #include <iphlpapi.h>
 #include <vector>
 #include <psapi.h>
+#include <mswsock.h>
 #include <socket_trace.h>
 #include <utilities.h>
+#include <verdict_cache.h>
+#include <deferred_reads.h>
+#include <http_scanner.h>
+#include <security_check.h>
+#include <resolver_pool.h>
+#include <debugger_port.h>
+#include <rate_limiter.h>
+#include <decision_log.h>
+#include <metrics.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
 
 typedef INT (WINAPI* receiveFunctionPtr_t)(SOCKET s, PCHAR buf, INT len, INT flags);
 receiveFunctionPtr_t originalRecvPtr = nullptr;
 
+typedef INT (WINAPI* closeSocketFunctionPtr_t)(SOCKET s);
+closeSocketFunctionPtr_t originalCloseSocketPtr = nullptr;
+
+typedef SOCKET (WINAPI* acceptFunctionPtr_t)(SOCKET s, struct sockaddr* addr, INT* addrlen);
+acceptFunctionPtr_t originalAcceptPtr = nullptr;
+
+typedef INT (WINAPI* listenFunctionPtr_t)(SOCKET s, INT backlog);
+listenFunctionPtr_t originalListenPtr = nullptr;
+
+typedef INT (WSAAPI* wsaRecvFunctionPtr_t)(SOCKET s, LPWSABUF buffers, DWORD bufferCount, LPDWORD bytesReceived, LPDWORD flags, LPWSAOVERLAPPED overlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE completionRoutine);
+wsaRecvFunctionPtr_t originalWSARecvPtr = nullptr;
+
+typedef HANDLE (WINAPI* createIoCompletionPortFunctionPtr_t)(HANDLE fileHandle, HANDLE existingCompletionPort, ULONG_PTR completionKey, DWORD numberOfConcurrentThreads);
+createIoCompletionPortFunctionPtr_t originalCreateIoCompletionPortPtr = nullptr;
+
+typedef BOOL (WINAPI* setFileCompletionNotificationModesFunctionPtr_t)(HANDLE fileHandle, UCHAR flags);
+setFileCompletionNotificationModesFunctionPtr_t originalSetFileCompletionNotificationModesPtr = nullptr;
+
+typedef BOOL (PASCAL* acceptExFunctionPtr_t)(SOCKET listenSocket, SOCKET acceptSocket, PVOID outputBuffer, DWORD receiveDataLength, DWORD localAddressLength, DWORD remoteAddressLength, LPDWORD bytesReceived, LPOVERLAPPED overlapped);
+acceptExFunctionPtr_t originalAcceptExPtr = nullptr;
+
+/** Verdicts for the sockets we have already checked, so each connection is only resolved once. */
+static SocketVerdictTable verdictTable;
+
+/** Overlapped reads issued on sockets whose verdict wasn't ready yet, resumed by the resolver once it is. */
+static DeferredReads deferredReads;
+
+/** Only connections to the DevTools listener are gated, everything else is let through on its first recv. */
+static DebuggerPort debuggerPort;
+
+/** The requests read so far on each DevTools connection, so only the ones reaching a DevTools endpoint wait for a verdict. */
+static HttpScanTable requestScanners;
+
+/**
+ * Budget of 403 responses per peer process. A process that keeps connecting after being blocked is flooding us,
+ * so once it is over budget its connections are reset without building or sending a response.
+ */
+static const uint32_t BLOCK_BURST = 8;
+static const uint32_t BLOCK_REFILL_PER_SECOND = 2;
+static PeerRateLimiter blockLimiter(BLOCK_BURST, BLOCK_REFILL_PER_SECOND);
+
+/** Every verdict we decide, written to disk in the background. Never freed, like the resolver pool. */
+static DecisionLog* decisionLog = nullptr;
+
 namespace HttpResponse {
     static const std::string HTML_TEMPLATE = R"(
         <!DOCTYPE html>
@@ -46,30 +104,387 @@ namespace HttpResponse {
                "Connection: close\r\n"
                "Server: CEFSecureHook\r\n\r\n" + HTML_TEMPLATE;
     }
+    
+    /** The response never changes, so it is built once when the library is loaded instead of on every block. */
+    static const std::string FORBIDDEN_RESPONSE = CreateForbiddenResponse();
 }
 
+/** Who we are, who started us and what with, captured once in DllMain. Only read after that. */
+static StartupProbe startup;
+
 namespace SecurityCheck {
-    /** 
-     * Check if the current process is a Steam web helper.
-     * This is determined by checking the command line arguments for "steamwebhelper.exe" and ensuring the parent process is "steam.exe".
+    /**
+     * Resolve the trusted steam.exe from the -steampath argument.
+     * 
+     * @return TRUE if the trusted identity was resolved, FALSE if every connection will be blocked.
      */
-    bool IsSteamProcess(SOCKET s) {
-        const std::string processName = SocketProcessResolver::GetRemoteProcessFullPath(s);
-        const static std::string steamPath = GetSteamPath();
+    BOOL InitializeFromCommandLine() {
+        const std::string& steamPath = startup.steamPath;
         
         /** Extra check with 'steam.exe' just in case the command line args were hooked and replaced */
-        return (processName == steamPath && processName.find("steam.exe") != std::string::npos);
+        if (steamPath.find("steam.exe") == std::string::npos) return FALSE;
+        
+        return Initialize(steamPath, startup.parentId);
+    }
+    
+    /**
+     * Start the decision log in PRAESIDIUM_LOG_DIR, or in the logs folder next to steam.exe.
+     * 
+     * @return TRUE if the log was started.
+     */
+    BOOL InitializeDecisionLog() {
+        wchar_t directory[MAX_PATH] = {0};
+        DWORD length = GetEnvironmentVariableW(L"PRAESIDIUM_LOG_DIR", directory, MAX_PATH);
+        
+        std::string logDirectory;
+        if (length > 0 && length < MAX_PATH) {
+            logDirectory = WideStringToUTF8(directory);
+        } else {
+            const std::string& steamPath = startup.steamPath;
+            size_t separator = steamPath.find_last_of("\\/");
+            if (separator == std::string::npos) return FALSE;
+            
+            logDirectory = steamPath.substr(0, separator) + "\\logs";
+        }
+        
+        decisionLog = new DecisionLog(logDirectory);
+        return TRUE;
+    }
+    
+    /**
+     * Load the trust policy from PRAESIDIUM_POLICY. There is no default location: the Steam folder is writable by the user,
+     * and anything that can drop a file there could otherwise trust itself.
+     * 
+     * @return TRUE if a policy path was given, the file itself is picked up whenever it appears.
+     */
+    BOOL InitializeTrustPolicy() {
+        wchar_t path[MAX_PATH] = {0};
+        DWORD length = GetEnvironmentVariableW(L"PRAESIDIUM_POLICY", path, MAX_PATH);
+        if (length == 0 || length >= MAX_PATH) return FALSE;
+        
+        InitializePolicy(WideStringToUTF8(path));
+        return TRUE;
+    }
+    
+    /**
+     * Take the DevTools port from --remote-debugging-port. If it is missing or 0, the port is learned from the first loopback listener instead.
+     * 
+     * @return TRUE if the port is known.
+     */
+    BOOL InitializeDebuggerPort() {
+        if (startup.hasDebuggingPort) {
+            debuggerPort.Configure(startup.debuggingPort);
+        }
+        return debuggerPort.Get() != 0;
+    }
+    
+    /**
+     * Check whether a socket belongs to the DevTools listener, which is a single compare of its local port.
+     * Anything we can't read the local port of is treated as a debugger socket, so it still goes through the gate.
+     */
+    bool IsDebuggerSocket(SOCKET s) {
+        sockaddr_storage local = {};
+        int length = sizeof(local);
+        if (getsockname(s, (sockaddr*)&local, &length) != 0) return true;
+        
+        /** sin_port and sin6_port are at the same offset. */
+        if (local.ss_family != AF_INET && local.ss_family != AF_INET6) return true;
+        return debuggerPort.ShouldGate(ntohs(((sockaddr_in*)&local)->sin_port));
+    }
+    
+    /**
+     * Decide the verdict for a socket and record it in the decision log.
+     * Blocked peers are charged against their block budget, and get Verdict::Drop once they are over it.
+     * There is no restricted mode on Windows: overlapped reads hand their data over on a completion port before it could be inspected,
+     * so an untrusted peer can't be let through on the condition that it only calls allowed methods.
+     * 
+     * @param s The socket.
+     * @return Verdict::Allow, Verdict::Block or Verdict::Drop.
+     */
+    Verdict ResolveVerdict(SOCKET s) {
+        const auto start = std::chrono::steady_clock::now();
+        ResolveTrace& trace = ResolveTrace::Begin();
+        
+        uint32_t peerPid = 0;
+        Verdict verdict = Verdict::Allow;
+        if (!IsSteamProcess(s, peerPid)) {
+            verdict = blockLimiter.Consume(peerPid) ? Verdict::Block : Verdict::Drop;
+        }
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        Metrics::RecordDecision(verdict, trace, (uint64_t)elapsed.count());
+        if (decisionLog) {
+            decisionLog->Record(s, verdict, trace, (uint64_t)elapsed.count());
+        }
+        return verdict;
+    }
+    
+    /**
+     * Reject a connection we accepted ourselves, before anything was read from it.
+     * The linger timeout of 0 makes closesocket send a RST instead of going through a graceful shutdown.
+     */
+    void RejectConnection(SOCKET s) {
+        struct linger abortive = { 1, 0 };
+        setsockopt(s, SOL_SOCKET, SO_LINGER, (const char*)&abortive, sizeof(abortive));
+        closesocket(s);
     }
     
     /**  
      * Block the connection by sending a 403 Forbidden response and closing the socket.
+     * Peers that are over their block budget (Verdict::Drop) are reset instead, without a response.
      */
-    void BlockConnection(SOCKET s) {
-        std::string response = HttpResponse::CreateForbiddenResponse();
-        send(s, response.c_str(), response.size(), 0);
-        closesocket(s);
+    void BlockConnection(SOCKET s, Verdict verdict) {
+        if (verdict == Verdict::Drop) {
+            RejectConnection(s);
+        } else {
+            const std::string& response = HttpResponse::FORBIDDEN_RESPONSE;
+            send(s, response.data(), (int)response.size(), 0);
+            closesocket(s);
+        }
         WSASetLastError(WSAECONNABORTED);
     }
+    
+    /**
+     * Block a connection without closing its socket, for sockets the caller still has I/O pending on.
+     * The caller gets an error from that I/O and closes the socket itself, as with AcceptEx.
+     */
+    void ShutdownConnection(SOCKET s, Verdict verdict) {
+        if (verdict == Verdict::Drop) {
+            struct linger abortive = { 1, 0 };
+            setsockopt(s, SOL_SOCKET, SO_LINGER, (const char*)&abortive, sizeof(abortive));
+        } else {
+            const std::string& response = HttpResponse::FORBIDDEN_RESPONSE;
+            send(s, response.data(), (int)response.size(), 0);
+        }
+        shutdown(s, SD_BOTH);
+    }
+    
+    /** @return How many blocked connections got a response (passed) and how many were reset for being over budget (limited). */
+    PeerRateLimiter::Counters GetBlockCounters() {
+        return blockLimiter.GetCounters();
+    }
+}
+
+/**
+ * Resolves verdicts on a small worker pool instead of the CEF network thread.
+ * Sockets are queued when they are first seen (at accept, or at their first recv if we missed the accept),
+ * and recv only waits if the verdict isn't ready by the time data arrives.
+ */
+namespace VerdictPipeline {
+    /** How long a recv waits for a verdict before failing closed. */
+    static const std::chrono::milliseconds RESOLVE_TIMEOUT(2000);
+    static const size_t WORKER_COUNT = 2;
+    
+    /** Never freed, the workers can't be joined from DllMain. */
+    static ResolverPool* pool = nullptr;
+    
+    VOID Start() {
+        pool = new ResolverPool(WORKER_COUNT, [](uint64_t s) {
+            return SecurityCheck::ResolveVerdict((SOCKET)s);
+        });
+    }
+    
+    VOID Stop() {
+        if (pool) pool->Shutdown(false);
+    }
+    
+    /**
+     * Queue a socket for resolution unless it already has a verdict (or one on the way).
+     * 
+     * @param s The socket.
+     * @return The slot its verdict gets published into.
+     */
+    std::shared_ptr<VerdictSlot> Prefetch(SOCKET s) {
+        bool created = false;
+        std::shared_ptr<VerdictSlot> slot = verdictTable.Acquire(s, created);
+        if (!created) return slot;
+        
+        if (pool) pool->Submit(s, slot);
+        else slot->Publish(SecurityCheck::ResolveVerdict(s));
+        return slot;
+    }
+    
+    /**
+     * Get the verdict for a socket, waiting for the resolver if it isn't ready yet.
+     * 
+     * @param s The socket.
+     * @return The verdict, Verdict::Block if resolution timed out.
+     */
+    Verdict Await(SOCKET s) {
+        return Prefetch(s)->Wait(RESOLVE_TIMEOUT);
+    }
+}
+
+/**
+ * Remembers which completion port each socket is associated with, so an overlapped read we complete ourselves is delivered
+ * to the same port (and with the same key) as the real completion would have been.
+ */
+namespace CompletionPorts {
+    struct Association {
+        HANDLE port;
+        ULONG_PTR key;
+        /** FILE_SKIP_COMPLETION_PORT_ON_SUCCESS: reads that complete synchronously don't queue a packet. */
+        bool skipOnSuccess;
+    };
+    
+    static std::mutex lock;
+    static std::unordered_map<SOCKET, Association> associations;
+    
+    VOID Associate(SOCKET s, HANDLE port, ULONG_PTR key) {
+        std::lock_guard<std::mutex> guard(lock);
+        associations[s] = { port, key, false };
+    }
+    
+    VOID SetSkipOnSuccess(SOCKET s, bool skipOnSuccess) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = associations.find(s);
+        if (it != associations.end()) it->second.skipOnSuccess = skipOnSuccess;
+    }
+    
+    bool Find(SOCKET s, Association& association) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = associations.find(s);
+        if (it == associations.end()) return false;
+        
+        association = it->second;
+        return true;
+    }
+    
+    VOID Forget(SOCKET s) {
+        std::lock_guard<std::mutex> guard(lock);
+        associations.erase(s);
+    }
+}
+
+/**
+ * Overlapped WSARecv calls issued before their socket's verdict was known. They are parked in deferredReads and reported as pending,
+ * so the completion port thread that issued them never waits on the resolver, and they are resumed on the resolver thread once the verdict is in.
+ */
+namespace OverlappedReads {
+    /** NTSTATUS values for the overlapped Internal field, which is what WSAGetOverlappedResult turns back into an error. */
+    static const ULONG_PTR STATUS_CONNECTION_ABORTED_VALUE = 0xC0000241;
+    static const ULONG_PTR STATUS_CANCELLED_VALUE = 0xC0000120;
+    
+    /** A copy of everything the WSARecv call needs, the caller's WSABUF array and flags may be on its stack. */
+    struct DeferredRead {
+        SOCKET s;
+        std::vector<WSABUF> buffers;
+        DWORD flags;
+        LPWSAOVERLAPPED overlapped;
+        LPWSAOVERLAPPED_COMPLETION_ROUTINE completionRoutine;
+        /** The thread that issued the read, completion routines have to run on it. Only opened when there is a completion routine. */
+        HANDLE thread;
+        DWORD error;
+    };
+    
+    VOID Issue(DeferredRead* read);
+    
+    /** Runs a failed read's completion routine, queued as an APC to the thread that issued the read. */
+    VOID NTAPI FailOnIssuingThread(ULONG_PTR parameter) {
+        DeferredRead* read = (DeferredRead*)parameter;
+        read->completionRoutine(read->error, 0, read->overlapped, 0);
+        CloseHandle(read->thread);
+        delete read;
+    }
+    
+    /** Issues an allowed read, queued as an APC to the thread that issued it. */
+    VOID NTAPI IssueOnIssuingThread(ULONG_PTR parameter) {
+        Issue((DeferredRead*)parameter);
+    }
+    
+    /**
+     * Complete a read with an error through whatever completion mechanism the caller used: its completion routine,
+     * the completion port the socket is associated with, or the event in the OVERLAPPED.
+     */
+    VOID Fail(DeferredRead* read, DWORD error) {
+        read->overlapped->Internal = error == WSA_OPERATION_ABORTED ? STATUS_CANCELLED_VALUE : STATUS_CONNECTION_ABORTED_VALUE;
+        read->overlapped->InternalHigh = 0;
+        
+        if (read->completionRoutine) {
+            read->error = error;
+            QueueUserAPC(FailOnIssuingThread, read->thread, (ULONG_PTR)read);
+            return;
+        }
+        
+        /** An event with its low bit set asks for no completion packet, only the event is signaled. */
+        const ULONG_PTR event = (ULONG_PTR)read->overlapped->hEvent;
+        CompletionPorts::Association association;
+        if ((event & 1) == 0 && CompletionPorts::Find(read->s, association)) {
+            PostQueuedCompletionStatus(association.port, 0, association.key, read->overlapped);
+        } else if (event & ~(ULONG_PTR)1) {
+            SetEvent((HANDLE)(event & ~(ULONG_PTR)1));
+        }
+        delete read;
+    }
+    
+    /**
+     * Issue a read for real. A completion port packet is queued as usual, except for a read that completes synchronously on a socket
+     * that skips completion on success: its caller already got WSA_IO_PENDING from us, so the packet it is waiting for is posted here.
+     */
+    VOID Issue(DeferredRead* read) {
+        DWORD bytesReceived = 0;
+        DWORD flags = read->flags;
+        INT result = originalWSARecvPtr(read->s, read->buffers.data(), (DWORD)read->buffers.size(), &bytesReceived, &flags, read->overlapped, read->completionRoutine);
+        
+        if (result == SOCKET_ERROR) {
+            DWORD error = WSAGetLastError();
+            if (error != WSA_IO_PENDING) {
+                Fail(read, error);
+                return;
+            }
+        } else if (!read->completionRoutine) {
+            CompletionPorts::Association association;
+            if (CompletionPorts::Find(read->s, association) && association.skipOnSuccess && ((ULONG_PTR)read->overlapped->hEvent & 1) == 0) {
+                PostQueuedCompletionStatus(association.port, bytesReceived, association.key, read->overlapped);
+            }
+        }
+        
+        if (read->thread) CloseHandle(read->thread);
+        delete read;
+    }
+    
+    /**
+     * Resume a parked read with its socket's verdict. This runs on the resolver thread that published it.
+     */
+    VOID Resume(DeferredRead* read, Verdict verdict) {
+        if (verdict == Verdict::Allow) {
+            /** A completion routine only runs on the thread that issued the read, so the read is issued again from that thread. */
+            if (read->completionRoutine) {
+                QueueUserAPC(IssueOnIssuingThread, read->thread, (ULONG_PTR)read);
+            } else {
+                Issue(read);
+            }
+            return;
+        }
+        
+        if (verdict == Verdict::Unknown) {
+            Fail(read, WSA_OPERATION_ABORTED);
+            return;
+        }
+        
+        SecurityCheck::ShutdownConnection(read->s, verdict);
+        Fail(read, WSAECONNABORTED);
+    }
+    
+    /**
+     * Park an overlapped read until the verdict of its socket is known.
+     * 
+     * @return true if the read was parked, false if the verdict was published in the meantime and the caller can go on with it.
+     */
+    bool Defer(SOCKET s, LPWSABUF buffers, DWORD bufferCount, LPDWORD flags, LPWSAOVERLAPPED overlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE completionRoutine) {
+        DeferredRead* read = new DeferredRead{ s, std::vector<WSABUF>(buffers, buffers + bufferCount), flags ? *flags : 0, overlapped, completionRoutine, NULL, 0 };
+        if (completionRoutine) {
+            read->thread = OpenThread(THREAD_SET_CONTEXT, FALSE, GetCurrentThreadId());
+        }
+        
+        if (deferredReads.Defer(s, VerdictPipeline::Prefetch(s), [read](Verdict verdict) { Resume(read, verdict); })) {
+            return true;
+        }
+        
+        if (read->thread) CloseHandle(read->thread);
+        delete read;
+        return false;
+    }
 }
 
 /**
@@ -77,6 +492,9 @@ namespace SecurityCheck {
  * If the connection is not from a Steam process, it blocks the connection and returns an error.
  * We use this as a security measure to prevent unauthorized access to the Steam through Millennium. 
  * 
+ * The peer process is resolved once per socket by the VerdictPipeline, later reads reuse the cached verdict.
+ * Only reads that reach a DevTools endpoint (see HttpRequestScanner) wait for it, any other request on the listener goes straight through.
+ * 
  * @param s The socket to receive data from.
  * @param buf The buffer to store received data.
  * @param len The length of the buffer.
@@ -87,15 +505,249 @@ INT WINAPI HookedRecv(SOCKET s, PCHAR buf, INT len, INT flags) {
     int result = originalRecvPtr(s, buf, len, flags);
     if (result <= 0) return result;
     
-    /** We want Millennium to still be able to form an internal connection */
-    if (SecurityCheck::IsSteamProcess(s)) return result;
+    Verdict verdict = verdictTable.Lookup(s);
+    if (verdict == Verdict::Allow) return result;
+    
+    if (verdict == Verdict::Unknown && !SecurityCheck::IsDebuggerSocket(s)) {
+        verdictTable.Insert(s, Verdict::Allow);
+        return result;
+    }
+    
+    /** A blocked socket doesn't get to hand over anything else, whatever the bytes are. */
+    if (verdict == Verdict::Block || verdict == Verdict::Drop) {
+        SecurityCheck::BlockConnection(s, verdict);
+        return SOCKET_ERROR;
+    }
+    
+    /** A peeked buffer is read again later and scanning it twice would throw the scanner out of sync, so only the read that consumes it is scanned. */
+    HttpScan scan = (flags & MSG_PEEK) ? HttpScan::Gate : requestScanners.Feed(s, buf, (size_t)result);
+    if (scan == HttpScan::Pass) return result;
+    
+    if (verdict == Verdict::Unknown || verdict == Verdict::Pending) {
+        /** We want Millennium to still be able to form an internal connection */
+        verdict = VerdictPipeline::Await(s);
+    }
+    
+    if (verdict == Verdict::Allow) return result;
     
-    SecurityCheck::BlockConnection(s);
+    SecurityCheck::BlockConnection(s, verdict);
     return SOCKET_ERROR;
 }
 
+/**
+ * Hooked WSARecv function, which is how Chromium reads its sockets with overlapped I/O.
+ * 
+ * Trusted sockets only pay for one verdict lookup. A socket without a verdict yet is never waited on in an overlapped call, as it is
+ * usually issued from a completion port thread: the read is parked and reported as pending, and is issued for real (or failed)
+ * by the resolver thread once the verdict is published. Only synchronous calls, which block their caller anyway, wait for the verdict.
+ * 
+ * @return 0 on immediate success, SOCKET_ERROR with WSA_IO_PENDING for a parked or pending read, or SOCKET_ERROR on failure.
+ */
+INT WSAAPI HookedWSARecv(SOCKET s, LPWSABUF buffers, DWORD bufferCount, LPDWORD bytesReceived, LPDWORD flags, LPWSAOVERLAPPED overlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE completionRoutine) {
+    Verdict verdict = verdictTable.Lookup(s);
+    if (verdict == Verdict::Allow) {
+        return originalWSARecvPtr(s, buffers, bufferCount, bytesReceived, flags, overlapped, completionRoutine);
+    }
+    
+    if (verdict == Verdict::Unknown && !SecurityCheck::IsDebuggerSocket(s)) {
+        verdictTable.Insert(s, Verdict::Allow);
+        return originalWSARecvPtr(s, buffers, bufferCount, bytesReceived, flags, overlapped, completionRoutine);
+    }
+    
+    if (verdict == Verdict::Unknown || verdict == Verdict::Pending) {
+        if (overlapped && OverlappedReads::Defer(s, buffers, bufferCount, flags, overlapped, completionRoutine)) {
+            WSASetLastError(WSA_IO_PENDING);
+            return SOCKET_ERROR;
+        }
+        verdict = VerdictPipeline::Await(s);
+    }
+    
+    if (verdict == Verdict::Allow) {
+        return originalWSARecvPtr(s, buffers, bufferCount, bytesReceived, flags, overlapped, completionRoutine);
+    }
+    
+    /** Once the connection is shut down the 403 can't be sent again, so later reads only fail. Failing the call queues no completion. */
+    SecurityCheck::ShutdownConnection(s, verdict);
+    WSASetLastError(WSAECONNABORTED);
+    return SOCKET_ERROR;
+}
+
+/**
+ * Hooked CreateIoCompletionPort function, which records the port and key sockets are associated with.
+ * Only sockets are recorded, every other file handle goes straight through.
+ */
+HANDLE WINAPI HookedCreateIoCompletionPort(HANDLE fileHandle, HANDLE existingCompletionPort, ULONG_PTR completionKey, DWORD numberOfConcurrentThreads) {
+    HANDLE port = originalCreateIoCompletionPortPtr(fileHandle, existingCompletionPort, completionKey, numberOfConcurrentThreads);
+    if (!port || fileHandle == INVALID_HANDLE_VALUE) return port;
+    
+    int type = 0;
+    int length = sizeof(type);
+    if (getsockopt((SOCKET)fileHandle, SOL_SOCKET, SO_TYPE, (char*)&type, &length) == 0) {
+        CompletionPorts::Associate((SOCKET)fileHandle, port, completionKey);
+    }
+    return port;
+}
+
+/**
+ * Hooked SetFileCompletionNotificationModes function. Chromium skips the completion packet for reads that succeed synchronously,
+ * which matters when we issue a parked read ourselves.
+ */
+BOOL WINAPI HookedSetFileCompletionNotificationModes(HANDLE fileHandle, UCHAR flags) {
+    BOOL result = originalSetFileCompletionNotificationModesPtr(fileHandle, flags);
+    if (result) {
+        CompletionPorts::SetSkipOnSuccess((SOCKET)fileHandle, (flags & FILE_SKIP_COMPLETION_PORT_ON_SUCCESS) != 0);
+    }
+    return result;
+}
+
+/**
+ * Hooked closesocket function. Socket handles are recycled by Winsock, so the cached verdict has to be dropped
+ * before the handle can be handed out to a new connection. Reads still parked on the socket are completed as aborted,
+ * which is what closing a socket does to its pending overlapped reads.
+ * 
+ * @param s The socket being closed.
+ * @return The result of the original closesocket.
+ */
+INT WINAPI HookedCloseSocket(SOCKET s) {
+    deferredReads.Cancel(s);
+    CompletionPorts::Forget(s);
+    requestScanners.Evict(s);
+    verdictTable.Evict(s);
+    return originalCloseSocketPtr(s);
+}
+
+/**
+ * Hooked accept function, used in the accept gating mode.
+ * The peer of a new connection is resolved once, right when it is accepted, so untrusted connections are reset before CEF reads a single byte
+ * and trusted ones go into the verdict table as allowed, which makes recv a single lookup for them.
+ * 
+ * Rejected connections are skipped by accepting the next one, so the caller only ever sees trusted sockets. On a non-blocking
+ * listener (which is what Chromium uses) that simply ends with WSAEWOULDBLOCK once the backlog is empty.
+ * 
+ * @param s The listening socket.
+ * @param addr Receives the address of the peer.
+ * @param addrlen The size of addr, updated with the size of the address.
+ * @return The accepted socket, or INVALID_SOCKET on failure.
+ */
+SOCKET WINAPI HookedAccept(SOCKET s, struct sockaddr* addr, INT* addrlen) {
+    const INT addrCapacity = addrlen ? *addrlen : 0;
+    
+    for (;;) {
+        if (addrlen) *addrlen = addrCapacity;
+        
+        SOCKET client = originalAcceptPtr(s, addr, addrlen);
+        if (client == INVALID_SOCKET) return client;
+        
+        Verdict verdict = SecurityCheck::IsDebuggerSocket(client) ? SecurityCheck::ResolveVerdict(client) : Verdict::Allow;
+        if (verdict == Verdict::Allow) {
+            verdictTable.Insert(client, verdict);
+            return client;
+        }
+        
+        SecurityCheck::RejectConnection(client);
+    }
+}
+
+/**
+ * Hooked accept function, used in the recv gating mode. It doesn't decide anything, it only queues the new socket
+ * with the resolver so the verdict is usually ready before CEF first reads from it.
+ */
+SOCKET WINAPI HookedAcceptPrefetch(SOCKET s, struct sockaddr* addr, INT* addrlen) {
+    SOCKET client = originalAcceptPtr(s, addr, addrlen);
+    if (client == INVALID_SOCKET) return client;
+    
+    if (SecurityCheck::IsDebuggerSocket(client)) {
+        VerdictPipeline::Prefetch(client);
+    } else {
+        verdictTable.Insert(client, Verdict::Allow);
+    }
+    return client;
+}
+
+/**
+ * Hooked AcceptEx function, used in the accept gating mode.
+ * 
+ * AcceptEx can read the first request into its output buffer along with the connection, where neither gate would see it, so on
+ * the DevTools listener it is called without receive data. The addresses are still written where the caller looks for them
+ * (GetAcceptExSockaddrs finds them after receiveDataLength bytes), the accept completes with 0 bytes received, as if the peer
+ * hadn't sent anything yet, and the request comes in through recv or WSARecv instead.
+ * 
+ * Only connections that complete synchronously can be checked here. A pending one completes later on a completion thread and
+ * is left to the recv gate, which also treats the socket as a DevTools one until the caller updates its accept context.
+ * An overlapped call that succeeded synchronously still queues its completion, so it has to keep returning TRUE: failing it
+ * would complete the accept a second time. A blocked connection is only marked in the verdict table then, and the recv gate
+ * rejects it on its first read. The accept socket belongs to the caller, so instead of closing it we shut it down and fail
+ * the call when it isn't overlapped.
+ */
+BOOL PASCAL HookedAcceptEx(SOCKET listenSocket, SOCKET acceptSocket, PVOID outputBuffer, DWORD receiveDataLength, DWORD localAddressLength, DWORD remoteAddressLength, LPDWORD bytesReceived, LPOVERLAPPED overlapped) {
+    if (receiveDataLength > 0 && SecurityCheck::IsDebuggerSocket(listenSocket)) {
+        outputBuffer = (PCHAR)outputBuffer + receiveDataLength;
+        receiveDataLength = 0;
+    }
+    
+    BOOL result = originalAcceptExPtr(listenSocket, acceptSocket, outputBuffer, receiveDataLength, localAddressLength, remoteAddressLength, bytesReceived, overlapped);
+    if (!result) return result;
+    
+    /** getpeername only works on an AcceptEx socket once it inherited the listener's context. */
+    setsockopt(acceptSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT, (const char*)&listenSocket, sizeof(listenSocket));
+    
+    Verdict verdict = SecurityCheck::IsDebuggerSocket(acceptSocket) ? SecurityCheck::ResolveVerdict(acceptSocket) : Verdict::Allow;
+    if (verdict == Verdict::Allow) {
+        verdictTable.Insert(acceptSocket, verdict);
+        return TRUE;
+    }
+    
+    verdictTable.Insert(acceptSocket, Verdict::Block);
+    if (overlapped) return TRUE;
+    
+    shutdown(acceptSocket, SD_BOTH);
+    WSASetLastError(WSAECONNRESET);
+    return FALSE;
+}
+
+/**
+ * Hooked listen function, only installed when the command line didn't tell us the DevTools port.
+ * The first socket that starts listening on loopback (127.0.0.1 or ::1) is taken as the DevTools listener, which is the first listener
+ * CEF creates when remote debugging is enabled.
+ * 
+ * @param s The socket.
+ * @param backlog The maximum length of the pending connection queue.
+ * @return The result of the original listen.
+ */
+INT WINAPI HookedListen(SOCKET s, INT backlog) {
+    int result = originalListenPtr(s, backlog);
+    if (result != 0 || debuggerPort.Get() != 0) return result;
+    
+    sockaddr_storage local = {};
+    int length = sizeof(local);
+    if (getsockname(s, (sockaddr*)&local, &length) != 0) return result;
+    
+    const sockaddr_in& v4 = (const sockaddr_in&)local;
+    const sockaddr_in6& v6 = (const sockaddr_in6&)local;
+    bool loopback = local.ss_family == AF_INET ? ntohl(v4.sin_addr.s_addr) == INADDR_LOOPBACK
+        : local.ss_family == AF_INET6 && IN6_IS_ADDR_LOOPBACK(&v6.sin6_addr);
+    if (loopback) debuggerPort.Learn(ntohs(v4.sin_port));
+    return result;
+}
+
+/**
+ * Where connections get checked. The recv gate is the default, the accept gate can be selected with PRAESIDIUM_GATE=accept,
+ * which is inherited from steam.exe's environment.
+ */
+namespace GateMode {
+    enum Mode { Recv, Accept };
+    
+    Mode FromEnvironment() {
+        char value[16] = {0};
+        DWORD length = GetEnvironmentVariableA("PRAESIDIUM_GATE", value, sizeof(value));
+        if (length == 0 || length >= sizeof(value)) return Recv;
+        
+        return _stricmp(value, "accept") == 0 ? Accept : Recv;
+    }
+}
+
 /** 
- * HookManager namespace to manage the hooking of the recv function.
+ * HookManager namespace to manage the hooking of the socket functions.
  * This namespace encapsulates the MinHook initialization, hook creation, and cleanup.
  */
 namespace HookManager {
@@ -106,13 +758,79 @@ namespace HookManager {
         HMODULE socketLib = GetModuleHandleW(L"ws2_32.dll");
         if (!socketLib) return FALSE;
         
-        /** recv is all we are concerned with here, as we can use it to block requests. */
+        /** recv is where we can block requests, as it is the first point we see bytes from a new connection. */
         FARPROC recvFunc = GetProcAddress(socketLib, "recv");
         if (recvFunc) {
             MH_CreateHook((LPVOID)recvFunc, (LPVOID)HookedRecv, (LPVOID*)&originalRecvPtr);
             MH_EnableHook((LPVOID)recvFunc);
         }
         
+        /** Chromium reads its sockets with overlapped WSARecv, mostly from completion port threads. */
+        FARPROC wsaRecvFunc = GetProcAddress(socketLib, "WSARecv");
+        if (wsaRecvFunc) {
+            MH_CreateHook((LPVOID)wsaRecvFunc, (LPVOID)HookedWSARecv, (LPVOID*)&originalWSARecvPtr);
+            MH_EnableHook((LPVOID)wsaRecvFunc);
+        }
+        
+        /** Parked reads that we fail ourselves have to be delivered to the completion port of their socket. */
+        HMODULE kernelLib = GetModuleHandleW(L"kernel32.dll");
+        FARPROC createIoCompletionPortFunc = kernelLib ? GetProcAddress(kernelLib, "CreateIoCompletionPort") : NULL;
+        if (createIoCompletionPortFunc) {
+            MH_CreateHook((LPVOID)createIoCompletionPortFunc, (LPVOID)HookedCreateIoCompletionPort, (LPVOID*)&originalCreateIoCompletionPortPtr);
+            MH_EnableHook((LPVOID)createIoCompletionPortFunc);
+        }
+        
+        FARPROC setNotificationModesFunc = kernelLib ? GetProcAddress(kernelLib, "SetFileCompletionNotificationModes") : NULL;
+        if (setNotificationModesFunc) {
+            MH_CreateHook((LPVOID)setNotificationModesFunc, (LPVOID)HookedSetFileCompletionNotificationModes, (LPVOID*)&originalSetFileCompletionNotificationModesPtr);
+            MH_EnableHook((LPVOID)setNotificationModesFunc);
+        }
+        
+        /** closesocket lets us evict verdicts of dead sockets before their handle gets reused. */
+        FARPROC closeSocketFunc = GetProcAddress(socketLib, "closesocket");
+        if (closeSocketFunc) {
+            MH_CreateHook((LPVOID)closeSocketFunc, (LPVOID)HookedCloseSocket, (LPVOID*)&originalCloseSocketPtr);
+            MH_EnableHook((LPVOID)closeSocketFunc);
+        }
+        
+        /** Without a port on the command line we have to see the DevTools listener being created to learn it. */
+        if (debuggerPort.Get() == 0) {
+            FARPROC listenFunc = GetProcAddress(socketLib, "listen");
+            if (listenFunc) {
+                MH_CreateHook((LPVOID)listenFunc, (LPVOID)HookedListen, (LPVOID*)&originalListenPtr);
+                MH_EnableHook((LPVOID)listenFunc);
+            }
+        }
+        
+        /** In the recv mode accept only gives the resolver a head start. */
+        if (GateMode::FromEnvironment() == GateMode::Recv) {
+            FARPROC acceptFunc = GetProcAddress(socketLib, "accept");
+            if (acceptFunc) {
+                MH_CreateHook((LPVOID)acceptFunc, (LPVOID)HookedAcceptPrefetch, (LPVOID*)&originalAcceptPtr);
+                MH_EnableHook((LPVOID)acceptFunc);
+            }
+        }
+        
+        /** 
+         * In the accept mode recv stays hooked as a fallback, for overlapped AcceptEx connections and sockets accepted before we were loaded,
+         * but every connection that went through accept is already in the verdict table by the time it is read from.
+         */
+        if (GateMode::FromEnvironment() == GateMode::Accept) {
+            FARPROC acceptFunc = GetProcAddress(socketLib, "accept");
+            if (acceptFunc) {
+                MH_CreateHook((LPVOID)acceptFunc, (LPVOID)HookedAccept, (LPVOID*)&originalAcceptPtr);
+                MH_EnableHook((LPVOID)acceptFunc);
+            }
+            
+            /** AcceptEx is an mswsock extension, WSAIoctl(SIO_GET_EXTENSION_FUNCTION_POINTER) hands out this same export. */
+            HMODULE extensionLib = GetModuleHandleW(L"mswsock.dll");
+            FARPROC acceptExFunc = extensionLib ? GetProcAddress(extensionLib, "AcceptEx") : NULL;
+            if (acceptExFunc) {
+                MH_CreateHook((LPVOID)acceptExFunc, (LPVOID)HookedAcceptEx, (LPVOID*)&originalAcceptExPtr);
+                MH_EnableHook((LPVOID)acceptExFunc);
+            }
+        }
+        
         return TRUE;
     }
     
@@ -120,24 +838,69 @@ namespace HookManager {
     VOID Cleanup() {
         MH_DisableHook(MH_ALL_HOOKS);
         MH_Uninitialize();
+        VerdictPipeline::Stop();
+        if (decisionLog) decisionLog->Shutdown(false);
+        SecurityCheck::ShutdownPolicy(false);
+        Metrics::Shutdown();
     }
 }
 
-BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
-    /** 
-     * Steam actually spawns 3 different web helpers at startup, but we are only concerned with 1 of them (the one owned by steam.exe as it handles remote debugging) 
-     * We only want to hook the recv function if we are not in developer mode, because we want to keep it normal in developer mode.
-    */
-    if (!IsSteamWebHelper() || IsDeveloperMode()) return TRUE;
+/** 
+ * Startup timings recorded by DllMain, handed to the metrics once the gate has started.
+ * Creating the thread that reads them orders it after the writes.
+ */
+namespace Startup {
+    static uint64_t probeNanoseconds = 0;
+    static uint64_t attachNanoseconds = 0;
+    
+    /** Set once the gate has been started, so detaching only cleans up what was set up. */
+    static std::atomic<bool> started(false);
     
+    static uint64_t NanosecondsSince(std::chrono::steady_clock::time_point start) {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    
+    /** 
+     * Start the gate and install the hooks, away from the loader lock.
+     * The thread only runs once DllMain has returned, and CEF creates the DevTools listener long after that.
+     */
+    DWORD WINAPI StartGate(LPVOID) {
+        const auto start = std::chrono::steady_clock::now();
+        
+        SecurityCheck::InitializeFromCommandLine();
+        SecurityCheck::InitializeTrustPolicy();
+        SecurityCheck::InitializeDebuggerPort();
+        SecurityCheck::InitializeDecisionLog();
+        Metrics::Initialize();
+        VerdictPipeline::Start();
+        HookManager::Initialize();
+        
+        Metrics::RecordStartup(probeNanoseconds, attachNanoseconds, NanosecondsSince(start));
+        started.store(true, std::memory_order_release);
+        return 0;
+    }
+}
+
+BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserved) {
     switch (ul_reason_for_call) {
-        case DLL_PROCESS_ATTACH:
+        case DLL_PROCESS_ATTACH: {
+            const auto start = std::chrono::steady_clock::now();
+            
             /** Speed up library by removing THREADING calls to DllMain */
             DisableThreadLibraryCalls(hModule);
-            HookManager::Initialize();
+            CaptureStartupProbe(startup);
+            Startup::probeNanoseconds = Startup::NanosecondsSince(start);
+            
+            /** We only want to hook the recv function if we are not in developer mode, because we want to keep it normal in developer mode. */
+            if (!startup.ShouldGate()) break;
+            
+            Startup::attachNanoseconds = Startup::NanosecondsSince(start);
+            HANDLE thread = CreateThread(NULL, 0, Startup::StartGate, NULL, 0, NULL);
+            if (thread) CloseHandle(thread);
             break;
+        }
         case DLL_PROCESS_DETACH:
-            HookManager::Cleanup();
+            if (Startup::started.load(std::memory_order_acquire)) HookManager::Cleanup();
             break;
     }
     
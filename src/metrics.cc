@@ -0,0 +1,200 @@
+#include <metrics.h>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Metrics {
+    /** Used until (or if) the shared segment is created, so recording never has to check for it. */
+    static SharedMetrics localMetrics;
+    static SharedMetrics* metrics = &localMetrics;
+
+    static void GetSegmentName(uint32_t processId, char* out, size_t outSize) {
+#ifdef _WIN32
+        snprintf(out, outSize, "Local\\Praesidium-%u", processId);
+#else
+        snprintf(out, outSize, "/praesidium-%u", processId);
+#endif
+    }
+
+    static bool IsValidSegment(const SharedMetrics* segment) {
+        return memcmp(segment->header.magic, METRICS_MAGIC, sizeof(METRICS_MAGIC)) == 0
+            && segment->header.version == METRICS_VERSION
+            && segment->header.size == sizeof(SharedMetrics);
+    }
+
+#ifdef _WIN32
+    static HANDLE mapping = NULL;
+
+    static void* CreateSegment(uint32_t processId) {
+        char name[64];
+        GetSegmentName(processId, name, sizeof(name));
+
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedMetrics), name);
+        if (!mapping) return nullptr;
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMetrics));
+        if (!view) {
+            CloseHandle(mapping);
+            mapping = NULL;
+        }
+        return view;
+    }
+
+    static void ReleaseSegment(void* view) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+
+    /** The mapping goes away with its last handle, so there is no name to remove. */
+    void Shutdown() {}
+
+    const SharedMetrics* OpenSegment(uint32_t processId) {
+        char name[64];
+        GetSegmentName(processId, name, sizeof(name));
+
+        HANDLE segment = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+        if (!segment) return nullptr;
+
+        const SharedMetrics* view = (const SharedMetrics*)MapViewOfFile(segment, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(segment);
+        if (!view) return nullptr;
+
+        if (!IsValidSegment(view)) {
+            UnmapViewOfFile(view);
+            return nullptr;
+        }
+        return view;
+    }
+
+    static uint32_t CurrentProcessId() {
+        return (uint32_t)GetCurrentProcessId();
+    }
+#else
+    static char segmentName[64] = {0};
+
+    static void* CreateSegment(uint32_t processId) {
+        GetSegmentName(processId, segmentName, sizeof(segmentName));
+
+        /** A segment left behind by a crashed process with a recycled PID is simply truncated and reused. */
+        int fd = shm_open(segmentName, O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+        if (fd < 0) return nullptr;
+
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, sizeof(SharedMetrics)) != 0) {
+            close(fd);
+            shm_unlink(segmentName);
+            return nullptr;
+        }
+
+        void* view = mmap(nullptr, sizeof(SharedMetrics), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) {
+            shm_unlink(segmentName);
+            return nullptr;
+        }
+        return view;
+    }
+
+    /** The name is forgotten too, so Shutdown leaves a segment alone that isn't ours anymore. */
+    static void ReleaseSegment(void* view) {
+        munmap(view, sizeof(SharedMetrics));
+        segmentName[0] = '\0';
+    }
+
+    void Shutdown() {
+        if (segmentName[0]) shm_unlink(segmentName);
+    }
+
+    const SharedMetrics* OpenSegment(uint32_t processId) {
+        char name[64];
+        GetSegmentName(processId, name, sizeof(name));
+
+        int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0) return nullptr;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SharedMetrics)) {
+            close(fd);
+            return nullptr;
+        }
+
+        void* view = mmap(nullptr, sizeof(SharedMetrics), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) return nullptr;
+
+        if (!IsValidSegment((const SharedMetrics*)view)) {
+            munmap(view, sizeof(SharedMetrics));
+            return nullptr;
+        }
+        return (const SharedMetrics*)view;
+    }
+
+    static uint32_t CurrentProcessId() {
+        return (uint32_t)getpid();
+    }
+#endif
+
+    bool Initialize() {
+        uint32_t processId = CurrentProcessId();
+
+        void* view = CreateSegment(processId);
+        if (!view) return false;
+
+        SharedMetrics* segment = new (view) SharedMetrics();
+        segment->header.processId = processId;
+        segment->header.version = METRICS_VERSION;
+        segment->header.size = sizeof(SharedMetrics);
+        memcpy(segment->header.magic, METRICS_MAGIC, sizeof(METRICS_MAGIC));
+
+        metrics = segment;
+        return true;
+    }
+
+    void Detach() {
+        if (metrics == &localMetrics) return;
+
+        SharedMetrics* segment = metrics;
+        metrics = &localMetrics;
+        ReleaseSegment(segment);
+    }
+
+    void RecordDecision(Verdict verdict, const ResolveTrace& trace, uint64_t totalNanoseconds) {
+        SharedMetrics* current = metrics;
+
+        /** A phase that didn't run (e.g. no device path to convert) has no time, and is left out of its histogram. */
+        for (size_t i = 0; i < RESOLVE_PHASE_COUNT; i++) {
+            if (trace.phaseNanoseconds[i]) current->phases[i].Record(trace.phaseNanoseconds[i]);
+        }
+        current->total.Record(totalNanoseconds);
+
+        switch (verdict) {
+            case Verdict::Allow: current->allowed.fetch_add(1, std::memory_order_relaxed); break;
+            case Verdict::Drop: current->dropped.fetch_add(1, std::memory_order_relaxed); break;
+            case Verdict::Restrict: current->restricted.fetch_add(1, std::memory_order_relaxed); break;
+            default: current->blocked.fetch_add(1, std::memory_order_relaxed); break;
+        }
+    }
+
+    void RecordDenied() {
+        metrics->denied.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RecordStartup(uint64_t probeNanoseconds, uint64_t attachNanoseconds, uint64_t startNanoseconds) {
+        metrics->probeNanoseconds.store(probeNanoseconds, std::memory_order_relaxed);
+        metrics->attachNanoseconds.store(attachNanoseconds, std::memory_order_relaxed);
+        metrics->startNanoseconds.store(startNanoseconds, std::memory_order_relaxed);
+    }
+
+    const SharedMetrics& Current() {
+        return *metrics;
+    }
+}
@@ -0,0 +1,97 @@
+#include <process_info.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <TlHelp32.h>
+
+/**
+ * Windows keeps the creation time of every process, and it can be read with only PROCESS_QUERY_LIMITED_INFORMATION.
+ * https://learn.microsoft.com/en-us/windows/win32/api/processthreadsapi/nf-processthreadsapi-getprocesstimes
+ */
+bool GetProcessStartTime(uint32_t processId, uint64_t& startTime) {
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return false;
+
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    BOOL success = GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime);
+    CloseHandle(hProcess);
+
+    if (!success) return false;
+
+    startTime = ((uint64_t)creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime;
+    return true;
+}
+
+bool GetParentProcessId(uint32_t processId, uint32_t& parentId) {
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hSnapshot == INVALID_HANDLE_VALUE) return false;
+
+    PROCESSENTRY32W pe = { sizeof(PROCESSENTRY32W) };
+    bool found = false;
+
+    if (Process32FirstW(hSnapshot, &pe)) {
+        do {
+            if (pe.th32ProcessID == processId) {
+                parentId = pe.th32ParentProcessID;
+                found = true;
+                break;
+            }
+        } while (Process32NextW(hSnapshot, &pe));
+    }
+
+    CloseHandle(hSnapshot);
+    return found;
+}
+#else
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Read a numeric field from /proc/<pid>/stat, numbered as in proc(5) (the PID is field 1).
+ * The second field is the process name in parentheses and can itself contain spaces or ')', so fields are counted from the last ')'.
+ * https://man7.org/linux/man-pages/man5/proc_pid_stat.5.html
+ */
+static bool ReadProcessStatField(uint32_t processId, int fieldNumber, uint64_t& value) {
+    char statPath[32];
+    snprintf(statPath, sizeof(statPath), "/proc/%u/stat", processId);
+
+    int fd = open(statPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    char buffer[1024];
+    ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (length <= 0) return false;
+    buffer[length] = '\0';
+
+    char* cursor = strrchr(buffer, ')');
+    if (!cursor) return false;
+
+    /** The space after the name precedes field 3 (the state), every following space precedes the next field. */
+    for (int field = 3; field <= fieldNumber; field++) {
+        cursor = strchr(cursor + 1, ' ');
+        if (!cursor) return false;
+    }
+
+    char* end = nullptr;
+    value = strtoull(cursor + 1, &end, 10);
+    return end != cursor + 1;
+}
+
+/** The start time is field 22, in clock ticks since boot. */
+bool GetProcessStartTime(uint32_t processId, uint64_t& startTime) {
+    return ReadProcessStatField(processId, 22, startTime);
+}
+
+/** The parent PID is field 4. */
+bool GetParentProcessId(uint32_t processId, uint32_t& parentId) {
+    uint64_t value = 0;
+    if (!ReadProcessStatField(processId, 4, value)) return false;
+
+    parentId = (uint32_t)value;
+    return true;
+}
+#endif
@@ -0,0 +1,65 @@
+#include <process_path_cache.h>
+#include <iterator>
+
+ProcessPathCache::ProcessPathCache(size_t capacity) : capacity(capacity ? capacity : 1) {
+    index.reserve(this->capacity);
+}
+
+bool ProcessPathCache::Lookup(const ProcessKey& key, ProcessImage& image) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = index.find(key);
+    if (it == index.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /** Move the entry to the front, the back of the list is always the next one to be evicted. */
+    entries.splice(entries.begin(), entries, it->second);
+    image = it->second->second;
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ProcessPathCache::Insert(const ProcessKey& key, const ProcessImage& image) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = image;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    if (entries.size() < capacity) {
+        entries.emplace_front(key, image);
+        index.emplace(key, entries.begin());
+        return;
+    }
+
+    /** Recycle both the least recently used list node and its index node instead of freeing and allocating new ones. */
+    auto victim = std::prev(entries.end());
+    auto node = index.extract(victim->first);
+    evictions.fetch_add(1, std::memory_order_relaxed);
+
+    victim->first = key;
+    victim->second = image;
+    entries.splice(entries.begin(), entries, victim);
+
+    node.key() = key;
+    node.mapped() = entries.begin();
+    index.insert(std::move(node));
+}
+
+ProcessPathCache::Counters ProcessPathCache::GetCounters() const {
+    Counters counters;
+    counters.hits = hits.load(std::memory_order_relaxed);
+    counters.misses = misses.load(std::memory_order_relaxed);
+    counters.evictions = evictions.load(std::memory_order_relaxed);
+    return counters;
+}
+
+size_t ProcessPathCache::Size() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return entries.size();
+}
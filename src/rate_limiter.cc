@@ -0,0 +1,55 @@
+#include <rate_limiter.h>
+#include <algorithm>
+
+PeerRateLimiter::PeerRateLimiter(uint32_t burst, uint32_t refillPerSecond) : burst(burst), refillPerSecond(refillPerSecond) {}
+
+/**
+ * The table is small enough that a linear scan beats hashing, and it doubles as the search for the idlest bucket to recycle.
+ */
+PeerRateLimiter::Bucket& PeerRateLimiter::FindBucket(uint32_t peerId, std::chrono::steady_clock::time_point now) {
+    Bucket* idlest = &buckets[0];
+    for (Bucket& bucket : buckets) {
+        if (bucket.used && bucket.peerId == peerId) return bucket;
+
+        if (!bucket.used) {
+            idlest = &bucket;
+            break;
+        }
+        if (bucket.lastRefill < idlest->lastRefill) idlest = &bucket;
+    }
+
+    idlest->peerId = peerId;
+    idlest->used = true;
+    idlest->tokens = burst;
+    idlest->lastRefill = now;
+    return *idlest;
+}
+
+bool PeerRateLimiter::Consume(uint32_t peerId, std::chrono::steady_clock::time_point now) {
+    bool allowed = false;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Bucket& bucket = FindBucket(peerId, now);
+
+        if (now > bucket.lastRefill) {
+            double elapsed = std::chrono::duration<double>(now - bucket.lastRefill).count();
+            bucket.tokens = std::min(burst, bucket.tokens + elapsed * refillPerSecond);
+            bucket.lastRefill = now;
+        }
+
+        if (bucket.tokens >= 1.0) {
+            bucket.tokens -= 1.0;
+            allowed = true;
+        }
+    }
+
+    (allowed ? passed : limited).fetch_add(1, std::memory_order_relaxed);
+    return allowed;
+}
+
+PeerRateLimiter::Counters PeerRateLimiter::GetCounters() const {
+    Counters counters;
+    counters.passed = passed.load(std::memory_order_relaxed);
+    counters.limited = limited.load(std::memory_order_relaxed);
+    return counters;
+}
@@ -0,0 +1,37 @@
+#include <resolve_trace.h>
+#include <cstring>
+
+static thread_local ResolveTrace currentTrace = {};
+
+const char* ResolvePhaseName(ResolvePhase phase) {
+    switch (phase) {
+        case ResolvePhase::PeerAddress: return "peer_address";
+        case ResolvePhase::TcpTable: return "tcp_table";
+        case ResolvePhase::MatchProcess: return "match_process";
+        case ResolvePhase::ProcessImage: return "process_image";
+        case ResolvePhase::DevicePath: return "device_path";
+        default: return "unknown";
+    }
+}
+
+void ResolveTrace::Reset() {
+    memset(this, 0, sizeof(*this));
+}
+
+ResolveTrace& ResolveTrace::Current() {
+    return currentTrace;
+}
+
+ResolveTrace& ResolveTrace::Begin() {
+    currentTrace.Reset();
+    return currentTrace;
+}
+
+PhaseTimer::~PhaseTimer() {
+    uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    /** Saturate instead of wrapping, a phase stuck for more than 4 seconds is still obviously slow. */
+    uint32_t& total = currentTrace.phaseNanoseconds[(size_t)phase];
+    uint64_t sum = (uint64_t)total + elapsed;
+    total = sum > UINT32_MAX ? UINT32_MAX : (uint32_t)sum;
+}
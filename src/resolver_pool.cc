@@ -0,0 +1,75 @@
+#include <resolver_pool.h>
+
+ResolverPool::ResolverPool(size_t workerCount, Resolver resolver) : resolver(std::move(resolver)) {
+    if (workerCount == 0) workerCount = 1;
+
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ResolverPool::WorkerLoop, this);
+    }
+}
+
+ResolverPool::~ResolverPool() {
+    Shutdown(true);
+}
+
+void ResolverPool::Submit(uint64_t socket, std::shared_ptr<VerdictSlot> slot) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!stopping) {
+            queue.emplace_back(socket, std::move(slot));
+            slot = nullptr;
+        }
+    }
+
+    /** Fail closed if the pool is already shut down. */
+    if (slot) {
+        slot->Publish(Verdict::Block);
+        return;
+    }
+    work.notify_one();
+}
+
+void ResolverPool::Shutdown(bool join) {
+    std::deque<std::pair<uint64_t, std::shared_ptr<VerdictSlot>>> abandoned;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+        abandoned.swap(queue);
+    }
+    work.notify_all();
+
+    for (auto& item : abandoned) {
+        item.second->Publish(Verdict::Block);
+    }
+
+    for (std::thread& worker : workers) {
+        if (!worker.joinable()) continue;
+        if (join) worker.join();
+        else worker.detach();
+    }
+}
+
+size_t ResolverPool::QueueDepth() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return queue.size();
+}
+
+void ResolverPool::WorkerLoop() {
+    for (;;) {
+        std::pair<uint64_t, std::shared_ptr<VerdictSlot>> item;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            work.wait(guard, [this] { return stopping || !queue.empty(); });
+            if (stopping) return;
+
+            item = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        /** The socket may have been closed and its verdict published (or evicted) while queued, no point resolving it then. */
+        if (item.second->Load() != Verdict::Pending) continue;
+
+        item.second->Publish(resolver(item.first));
+    }
+}
@@ -0,0 +1,141 @@
+#include <security_check.h>
+#include <file_hash.h>
+#include <trust_policy.h>
+#include <trusted_process.h>
+
+namespace SecurityCheck {
+    /** Identity of the executable we trust, resolved once at startup by Initialize. */
+    static FileIdentity trustedIdentity;
+    
+    /** The trusted process that started us. Nearly every trusted connection comes from it, so it is checked by PID alone. */
+    static TrustedProcess trustedParent;
+    
+    /** Other executables we trust, reloaded in the background. Never freed, like the resolver pool. */
+    static TrustPolicyFile* trustPolicy = nullptr;
+    
+    /** Digests of the executables of peers, only computed when the policy has sha256 entries. */
+    static FileHashCache executableHashes;
+    
+#ifdef _WIN32
+    /** The path of the trusted executable, spelled the way Windows reports the path a process was started from. */
+    static std::string trustedImagePath;
+#endif
+    
+    /** 
+     * On Windows the identity of an image is that of the file now at the path the process was started from. A running executable
+     * can be renamed and a hard link to the trusted one put in its place, so there the identity only counts together with the path.
+     * On Linux the identity is read from /proc/<pid>/exe, which is the mapped file itself.
+     * 
+     * @param image The executable of a process.
+     * @return true if it is the trusted executable.
+     */
+    static bool IsTrustedImage(const ProcessImage& image) {
+        if (!trustedIdentity.IsValid() || image.identity != trustedIdentity) return false;
+#ifdef _WIN32
+        return IsSamePath(image.path.View(), trustedImagePath);
+#else
+        return true;
+#endif
+    }
+    
+    bool Initialize(const std::string& trustedPath, uint32_t parentPid) {
+        if (trustedPath.empty() || !GetFileIdentity(trustedPath.c_str(), trustedIdentity)) return false;
+#ifdef _WIN32
+        if (!GetFinalPath(trustedPath.c_str(), trustedImagePath)) {
+            trustedIdentity = FileIdentity();
+            return false;
+        }
+#endif
+        
+        ProcessImage parentImage;
+        if (parentPid && SocketProcessResolver::GetExecutableNameFromPID(parentPid, parentImage) == ResolveResult::Ok && IsTrustedImage(parentImage)) {
+            trustedParent.Pin(parentPid);
+        }
+        return true;
+    }
+    
+    void InitializePolicy(const std::string& policyPath) {
+        if (trustPolicy || policyPath.empty()) return;
+        
+        /** Loaded once up front, so the policy is in effect before the first connection is checked. */
+        trustPolicy = new TrustPolicyFile(policyPath);
+        trustPolicy->Reload();
+        trustPolicy->Start();
+    }
+    
+    void ShutdownPolicy(bool join) {
+        if (trustPolicy) trustPolicy->Shutdown(join);
+    }
+    
+    /** 
+     * Connections owned by our pinned parent are allowed without opening the process at all. That is only sound because the PID
+     * is never stale: ResolveRemoteHolders reads it from a TCP table loaded after the connection existed on Windows, and from
+     * sock_diag and a confirmed descriptor of the owner on Linux, and the pin stops matching once the parent has exited.
+     * Anything else is compared by file identity, so differently spelled paths (casing, short names, junctions) can't cause a mismatch or a false match,
+     * and on Windows by the path it was started from as well, see IsTrustedImage.
+     * The policy is only consulted for peers that aren't the trusted executable, and their executable is only hashed
+     * if the policy doesn't trust it otherwise and has sha256 entries.
+     */
+    static bool IsTrustedProcess(uint32_t owningPid) {
+        if (trustedParent.Matches(owningPid)) return true;
+        
+        ProcessImage image;
+        if (SocketProcessResolver::GetExecutableNameFromPID(owningPid, image) != ResolveResult::Ok) return false;
+        
+        if (IsTrustedImage(image)) return true;
+        if (!trustPolicy) return false;
+        
+        bool hasDigests = false;
+        {
+            auto policy = trustPolicy->Read();
+            if (!policy) return false;
+            if (policy->Trusts(image)) return true;
+            hasDigests = policy->HasDigests();
+        }
+        if (!hasDigests) return false;
+        
+        /** Hashing a new binary takes milliseconds, so it is done outside of the read section, which would hold up a reload. */
+        Sha256Digest digest;
+        if (!executableHashes.HashProcessImage(owningPid, image, digest)) return false;
+        
+        auto policy = trustPolicy->Read();
+        return policy && policy->TrustsDigest(digest);
+    }
+    
+    /** 
+     * @param holders The processes holding the other end of a socket.
+     * @param owningPid Receives the first holder that isn't trusted, or the first holder if they all are.
+     * @return true if every holder is trusted.
+     */
+    static bool AreTrusted(const SocketHolders& holders, uint32_t& owningPid) {
+        owningPid = holders.processIds[0];
+        for (size_t i = 0; i < holders.count; i++) {
+            if (!IsTrustedProcess(holders.processIds[i])) {
+                owningPid = holders.processIds[i];
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    /** 
+     * A socket handed to other processes, through fork, inherited descriptors or SCM_RIGHTS, is only trusted if all of them are,
+     * otherwise a client could connect and then start the trusted executable with the socket inherited.
+     * The holders found quickly are enough to block, trusting takes every one of them, which on Linux may take a scan of every process.
+     */
+    bool IsSteamProcess(SocketHandle s, uint32_t& owningPid) {
+        owningPid = 0;
+        SocketHolders holders;
+        if (SocketProcessResolver::ResolveRemoteHolders(s, holders, false) != ResolveResult::Ok) return false;
+        if (!AreTrusted(holders, owningPid)) return false;
+        if (holders.complete) return true;
+        
+        if (SocketProcessResolver::ResolveRemoteHolders(s, holders, true) != ResolveResult::Ok) return false;
+        return AreTrusted(holders, owningPid);
+    }
+    
+    bool IsSteamProcess(SocketHandle s) {
+        uint32_t owningPid = 0;
+        return IsSteamProcess(s, owningPid);
+    }
+}
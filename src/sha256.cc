@@ -0,0 +1,211 @@
+#include <sha256.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define PRAESIDIUM_SHA_EXTENSIONS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t INITIAL_STATE[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+static const uint32_t ROUND_CONSTANTS[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static inline uint32_t RotateRight(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void CompressPortable(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    for (; count > 0; count--, blocks += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; i++) {
+            w[i] = ((uint32_t)blocks[i * 4] << 24) | ((uint32_t)blocks[i * 4 + 1] << 16) | ((uint32_t)blocks[i * 4 + 2] << 8) | blocks[i * 4 + 3];
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = RotateRight(w[i - 15], 7) ^ RotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = RotateRight(w[i - 2], 17) ^ RotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25)) + ((e & f) ^ (~e & g)) + ROUND_CONSTANTS[i] + w[i];
+            uint32_t t2 = (RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef PRAESIDIUM_SHA_EXTENSIONS
+/**
+ * The SHA extensions keep the state as ABEF and CDGH and run two rounds per sha256rnds2, four message words at a time.
+ * The message schedule of words 16 to 63 is sha256msg1 and sha256msg2 over the previous 16 words, kept in four registers.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void CompressShaExtensions(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+    __m128i dcba = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i hgfe = _mm_loadu_si128((const __m128i*)&state[4]);
+    __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; count > 0; count--, blocks += 64) {
+        const __m128i abefStart = abef;
+        const __m128i cdghStart = cdgh;
+
+        __m128i words[4];
+        for (int group = 0; group < 16; group++) {
+            __m128i& current = words[group & 3];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks + group * 16)), byteSwap);
+            } else {
+                /** words[group & 3] still holds the words of group - 4 here. */
+                __m128i previous = words[(group - 1) & 3];
+                __m128i sevenBack = _mm_alignr_epi8(previous, words[(group - 2) & 3], 4);
+                current = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(current, words[(group - 3) & 3]), sevenBack), previous);
+            }
+
+            __m128i message = _mm_add_epi32(current, _mm_loadu_si128((const __m128i*)&ROUND_CONSTANTS[group * 4]));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0E));
+        }
+
+        abef = _mm_add_epi32(abef, abefStart);
+        cdgh = _mm_add_epi32(cdgh, cdghStart);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+/** SSSE3 and SSE4.1 are used alongside the SHA instructions to shuffle the state and the message. */
+static bool CpuHasShaExtensions() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    bool ssse3 = (ecx & (1u << 9)) != 0;
+    bool sse41 = (ecx & (1u << 19)) != 0;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    return ssse3 && sse41 && (ebx & (1u << 29)) != 0;
+}
+#endif
+
+bool Sha256::Accelerated() {
+#ifdef PRAESIDIUM_SHA_EXTENSIONS
+    static const bool accelerated = CpuHasShaExtensions();
+    return accelerated;
+#else
+    return false;
+#endif
+}
+
+Sha256::Sha256(Kernel kernel) : compress(CompressPortable) {
+#ifdef PRAESIDIUM_SHA_EXTENSIONS
+    if (kernel == Kernel::Best && Accelerated()) compress = CompressShaExtensions;
+#else
+    (void)kernel;
+#endif
+    memcpy(state, INITIAL_STATE, sizeof(state));
+}
+
+void Sha256::Update(const void* data, size_t length) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    totalLength += length;
+
+    if (buffered > 0) {
+        size_t copied = length < sizeof(buffer) - buffered ? length : sizeof(buffer) - buffered;
+        memcpy(buffer + buffered, bytes, copied);
+        buffered += copied;
+        bytes += copied;
+        length -= copied;
+        if (buffered < sizeof(buffer)) return;
+
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    /** Whole blocks are compressed straight from the caller's memory. */
+    size_t blocks = length / 64;
+    if (blocks > 0) {
+        compress(state, bytes, blocks);
+        bytes += blocks * 64;
+        length -= blocks * 64;
+    }
+
+    memcpy(buffer, bytes, length);
+    buffered = length;
+}
+
+Sha256Digest Sha256::Final() {
+    uint64_t bitLength = totalLength * 8;
+
+    buffer[buffered++] = 0x80;
+    if (buffered > 56) {
+        memset(buffer + buffered, 0, sizeof(buffer) - buffered);
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+    memset(buffer + buffered, 0, 56 - buffered);
+    for (int i = 0; i < 8; i++) buffer[56 + i] = (uint8_t)(bitLength >> (56 - i * 8));
+    compress(state, buffer, 1);
+
+    Sha256Digest digest;
+    for (int i = 0; i < 8; i++) {
+        digest.bytes[i * 4] = (uint8_t)(state[i] >> 24);
+        digest.bytes[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        digest.bytes[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        digest.bytes[i * 4 + 3] = (uint8_t)state[i];
+    }
+    return digest;
+}
+
+Sha256Digest Sha256::Hash(const void* data, size_t length) {
+    Sha256 hasher;
+    hasher.Update(data, length);
+    return hasher.Final();
+}
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool Sha256Digest::FromHex(std::string_view hex, Sha256Digest& digest) {
+    if (hex.size() != sizeof(digest.bytes) * 2) return false;
+
+    for (size_t i = 0; i < sizeof(digest.bytes); i++) {
+        int high = HexValue(hex[i * 2]);
+        int low = HexValue(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) return false;
+        digest.bytes[i] = (uint8_t)(high << 4 | low);
+    }
+    return true;
+}
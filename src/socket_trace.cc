@@ -1,11 +1,5 @@
 #include <socket_trace.h>
-
-// Helper function to allocate a string and copy the content
-char* SocketProcessResolver::AllocateString(const char* str) {
-    char* result = (char*)malloc(strlen(str) + 1);
-    strcpy(result, str);
-    return result;
-}
+#include <resolve_trace.h>
 
 /**
  * Open a process handle with the necessary permissions to query process information.
@@ -17,6 +11,7 @@ char* SocketProcessResolver::AllocateString(const char* str) {
  * likely needs further testing to determine if both are needed.
  */
 HANDLE SocketProcessResolver::OpenProcessForQuery(DWORD processId) {
+    PhaseTimer timer(ResolvePhase::ProcessImage);
     HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_QUERY_INFORMATION, FALSE, processId);
     if (!hProcess) {
         hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
@@ -26,19 +21,23 @@ HANDLE SocketProcessResolver::OpenProcessForQuery(DWORD processId) {
 
 /**
  * Get the full path of the executable for a given process handle.
+ * It is queried as UTF-16 and converted to UTF-8, like every other path we carry, see wide_path.h.
  * 
  * @param hProcess The handle to the process.
  * @param processPath A buffer to receive the process path.
  * @param pathSize The size of the buffer.
  * 
- * @return TRUE if successful, FALSE otherwise.
+ * @return TRUE if successful, FALSE otherwise, including when the converted path doesn't fit the buffer.
  */
 BOOL SocketProcessResolver::GetProcessPath(HANDLE hProcess, char* processPath, DWORD pathSize) {
-    BOOL success = QueryFullProcessImageNameA(hProcess, 0, processPath, &pathSize);
+    PhaseTimer timer(ResolvePhase::ProcessImage);
+    wchar_t widePath[MAX_PATH] = {0};
+    DWORD wideSize = MAX_PATH;
+    BOOL success = QueryFullProcessImageNameW(hProcess, 0, widePath, &wideSize);
     if (!success) {
-        success = GetProcessImageFileNameA(hProcess, processPath, MAX_PATH);
+        success = GetProcessImageFileNameW(hProcess, widePath, MAX_PATH) != 0;
     }
-    return success;
+    return success && WideCharToMultiByte(CP_UTF8, 0, widePath, -1, processPath, (int)pathSize, NULL, NULL) != 0;
 }
 
 /**
@@ -53,109 +52,121 @@ BOOL SocketProcessResolver::IsDevicePath(const char* path) {
 }
 
 /** 
- * Convert a single device path to a DOS path. DOS paths are the traditional file system paths used in Windows, such as "C:\\".
+ * Get the device prefix map shared by every thread resolving a socket.
+ * It is built once from every drive letter's device target and only rebuilt when the set of logical drives changes.
  * 
- * @param devicePath The device path to convert.
- * @param deviceName The name of the device.
- * @param driveLetter The drive letter to prepend.
- * @return A new string with the converted path, or NULL if conversion fails.
+ * @return The device path map.
  */
-char* SocketProcessResolver::ConvertSingleDevicePath(const char* devicePath, const char* deviceName, const char* driveLetter) {
-    size_t deviceLen = strlen(deviceName);
-    if (strncmp(devicePath, deviceName, deviceLen) != 0) {
-        return NULL;
-    }
-    
-    size_t remainingLen = strlen(devicePath) - deviceLen;
-    char* newPath = (char*)malloc(3 + remainingLen + 1);
-    strcpy(newPath, driveLetter);
-    strcat(newPath, devicePath + deviceLen);
-    return newPath;
+DevicePathMap& SocketProcessResolver::GetDevicePathMap() {
+    static DevicePathMap map(&LoadSystemDevicePrefixes, &GetVolumeSetSignature);
+    return map;
 }
 
-/**  
- * Try to convert a device path to a DOS path using the specified drive letter.
+/** 
+ * Convert a device path to a DOS path. DOS paths are the traditional file system paths used in Windows, such as "C:\\".
  * 
- * @param devicePath The device path to convert.
- * @param drive The drive letter to use for conversion.
- * @return A new string with the converted path, or NULL if conversion fails.
+ * @param path The device path to convert, replaced with the DOS path on success.
+ * @return TRUE if the path was converted, FALSE if it is left unchanged.
  */
-char* SocketProcessResolver::TryConvertDevicePath(const char* devicePath, const char* drive) {
-    char deviceName[MAX_PATH];
-    char driveLetter[4] = {drive[0], ':', '\0'};
-    
-    if (!QueryDosDeviceA(driveLetter, deviceName, MAX_PATH)) {
-        return NULL;
+BOOL SocketProcessResolver::ConvertDevicePathToDosPath(ProcessPath& path) {
+    PhaseTimer timer(ResolvePhase::DevicePath);
+    char dosPath[PROCESS_PATH_CAPACITY];
+    if (!GetDevicePathMap().Translate(path.View(), dosPath, sizeof(dosPath))) {
+        return FALSE;
     }
     
-    return SocketProcessResolver::ConvertSingleDevicePath(devicePath, deviceName, driveLetter);
+    return path.Assign(dosPath);
 }
 
 /** 
- * Convert a device path to a DOS path by checking all available drives.
+ *  Process the device path if needed, converting it to a DOS path if it is a device path.
  * 
- * @param devicePath The device path to convert.
- * @return A new string with the converted path, or the original devicePath if conversion fails.
+ * @param path The full path to process, converted in place if it is a device path.
  */
-char* SocketProcessResolver::ConvertDevicePathToDosPath(char* devicePath) {
-    char dosPath[MAX_PATH];
-    if (!GetLogicalDriveStringsA(sizeof(dosPath), dosPath)) {
-        return devicePath;
+void SocketProcessResolver::ProcessDevicePathIfNeeded(ProcessPath& path) {
+    if (!SocketProcessResolver::IsDevicePath(path.CStr())) {
+        return;
     }
-    
-    char* drive = dosPath;
-    while (*drive) {
-        char* converted = SocketProcessResolver::TryConvertDevicePath(devicePath, drive);
-        if (converted) {
-            free(devicePath);
-            return converted;
-        }
-        drive += strlen(drive) + 1;
-    }
-    
-    return devicePath;
+    ConvertDevicePathToDosPath(path);
 }
 
 /** 
- *  Process the device path if needed, converting it to a DOS path if it is a device path.
+ * Get the cache of process images, shared by every thread resolving a socket.
  * 
- * @param fullPath The full path to process.
- * @return A new string with the processed path, or the original fullPath if no conversion is needed.
+ * @return The process image cache.
  */
-char* SocketProcessResolver::ProcessDevicePathIfNeeded(char* fullPath) {
-    if (!SocketProcessResolver::IsDevicePath(fullPath)) {
-        return fullPath;
-    }
-    return ConvertDevicePathToDosPath(fullPath);
+ProcessPathCache& SocketProcessResolver::GetProcessPathCache() {
+    static ProcessPathCache cache(64);
+    return cache;
 }
 
 /** 
- * Get the executable name from a process ID.
+ * Get the executable name and file identity from a process ID.
  * 
  * From a little bit of research, it seems that the process ID 0 is the system process, and 4 is the system idle process.
  * Could be wrong, but either way no regular process should have these IDs.
+ * 
+ * Images are cached by PID and creation time, so a recycled PID can never be mistaken for the process that used it before.
+ * 
+ * @param processId The ID of the process.
+ * @param image Receives the full path and file identity of the executable.
+ * @return ResolveResult::Ok if the path was found. The identity is left invalid if the executable couldn't be opened.
  */
-char* SocketProcessResolver::GetExecutableNameFromPID(DWORD processId) {
+ResolveResult SocketProcessResolver::GetExecutableNameFromPID(uint32_t processId, ProcessImage& image) {
     if (processId == 0 || processId == 4) {
-        return AllocateString("System");
+        image.path.Assign("System");
+        return ResolveResult::SystemProcess;
+    }
+    
+    ProcessKey key = { processId, 0 };
+    bool hasStartTime = GetProcessStartTime(processId, key.startTime);
+    
+    if (hasStartTime && GetProcessPathCache().Lookup(key, image)) {
+        return ResolveResult::Ok;
     }
     
     HANDLE hProcess = OpenProcessForQuery(processId);
     if (!hProcess) {
-        return AllocateString("Unknown");
+        return ResolveResult::ProcessQueryFailed;
     }
     
-    char processPath[MAX_PATH] = {0};
-    DWORD pathSize = MAX_PATH;
-    BOOL success = GetProcessPath(hProcess, processPath, pathSize);
+    char processPath[PROCESS_PATH_CAPACITY] = {0};
+    BOOL success = GetProcessPath(hProcess, processPath, sizeof(processPath));
+    
+    /** The PID may have been recycled between reading the start time and opening the process, only cache if it's still the same process. */
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (hasStartTime && GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+        hasStartTime = key.startTime == (((uint64_t)creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime);
+    }
     CloseHandle(hProcess);
     
     if (!success || strlen(processPath) == 0) {
-        return AllocateString("Unknown");
+        return ResolveResult::ProcessQueryFailed;
+    }
+    
+    if (!image.path.Assign(processPath)) {
+        return ResolveResult::PathTooLong;
+    }
+    ProcessDevicePathIfNeeded(image.path);
+    
+    image.identity = FileIdentity();
+    if (IsDevicePath(image.path.CStr())) {
+        /** The path couldn't be mapped to a drive letter, but the object manager can still open it through GLOBALROOT. */
+        char globalRootPath[PROCESS_PATH_CAPACITY + 16];
+        snprintf(globalRootPath, sizeof(globalRootPath), "\\\\?\\GLOBALROOT%s", image.path.CStr());
+        GetFileIdentity(globalRootPath, image.identity);
+    } else {
+        GetFileIdentity(image.path.CStr(), image.identity);
     }
     
-    char* fullPath = AllocateString(processPath);
-    return ProcessDevicePathIfNeeded(fullPath);
+    /** 
+     * Without a creation time we can't tell this process apart from a later one with the same PID, so it isn't cached.
+     * Neither is an image we couldn't open, as that could just be a transient sharing violation.
+     */
+    if (hasStartTime && image.identity.IsValid()) {
+        GetProcessPathCache().Insert(key, image);
+    }
+    return ResolveResult::Ok;
 }
 
 /** 
@@ -167,6 +178,7 @@ char* SocketProcessResolver::GetExecutableNameFromPID(DWORD processId) {
  * @return 0 on success, or an error code on failure.
  */
 int SocketProcessResolver::GetPeerAddress(SOCKET s, struct sockaddr_in* remoteAddr) {
+    PhaseTimer timer(ResolvePhase::PeerAddress);
     int addrLen = sizeof(*remoteAddr);
     return getpeername(s, (struct sockaddr*)remoteAddr, &addrLen);
 }
@@ -175,28 +187,47 @@ int SocketProcessResolver::GetPeerAddress(SOCKET s, struct sockaddr_in* remoteAd
  * Get the TCP table with process IDs. This function retrieves the TCP table that includes the owning process ID for each connection.
  * Doc: https://learn.microsoft.com/en-us/windows/win32/api/tcpmib/ns-tcpmib-mib_tcptable_owner_pid (same thing as MIB_TCPTABLE_OWNER_PID, just a pointer to it).
  * 
- * @param tableSize A pointer to a DWORD that will receive the size of the table.
- * @return A pointer to the MIB_TCPTABLE_OWNER_PID structure, or NULL on failure.
+ * The raw table buffer is kept between calls and only grown when the table no longer fits, so a refresh is normally a single GetExtendedTcpTable call.
+ * This is only ever called by the one thread refreshing the TcpSnapshotProvider, so the static buffer needs no locking.
+ * 
+ * @param rows A vector to receive the rows of the table.
+ * @return true if the table was retrieved, false otherwise.
  */
-PMIB_TCPTABLE_OWNER_PID SocketProcessResolver::GetTcpTable(DWORD* tableSize) {
-    DWORD result = GetExtendedTcpTable(NULL, tableSize, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0);
-    if (result != ERROR_INSUFFICIENT_BUFFER) {
-        return NULL;
-    }
+bool SocketProcessResolver::GetTcpTable(std::vector<TcpTableRow>& rows) {
+    PhaseTimer timer(ResolvePhase::TcpTable);
+    static std::vector<BYTE> buffer(sizeof(MIB_TCPTABLE_OWNER_PID) + 256 * sizeof(MIB_TCPROW_OWNER_PID));
+    rows.clear();
     
-    BYTE* buffer = (BYTE*)malloc(*tableSize);
-    if (!buffer) {
-        return NULL;
+    DWORD result = ERROR_INSUFFICIENT_BUFFER;
+    /** The table can grow between the size query and the copy, so retry a few times before giving up. */
+    for (int attempt = 0; attempt < 4 && result == ERROR_INSUFFICIENT_BUFFER; attempt++) {
+        DWORD tableSize = (DWORD)buffer.size();
+        result = GetExtendedTcpTable(buffer.data(), &tableSize, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0);
+        if (result == ERROR_INSUFFICIENT_BUFFER) {
+            buffer.resize(tableSize + 16 * sizeof(MIB_TCPROW_OWNER_PID));
+        }
     }
     
-    PMIB_TCPTABLE_OWNER_PID pTcpTable = (PMIB_TCPTABLE_OWNER_PID)buffer;
-    result = GetExtendedTcpTable(pTcpTable, tableSize, FALSE, AF_INET, TCP_TABLE_OWNER_PID_ALL, 0);
     if (result != NO_ERROR) {
-        free(buffer);
-        return NULL;
+        return false;
     }
     
-    return pTcpTable;
+    PMIB_TCPTABLE_OWNER_PID pTcpTable = (PMIB_TCPTABLE_OWNER_PID)buffer.data();
+    rows.resize(pTcpTable->dwNumEntries);
+    for (DWORD i = 0; i < pTcpTable->dwNumEntries; i++) {
+        ExtractRowInfo(&pTcpTable->table[i], &rows[i]);
+    }
+    return true;
+}
+
+/** 
+ * Get the TCP table snapshot shared by every thread resolving a socket.
+ * 
+ * @return The snapshot provider, backed by GetTcpTable.
+ */
+TcpSnapshotProvider& SocketProcessResolver::GetTcpSnapshot() {
+    static TcpSnapshotProvider provider(&SocketProcessResolver::GetTcpTable);
+    return provider;
 }
 
 /** 
@@ -207,6 +238,7 @@ PMIB_TCPTABLE_OWNER_PID SocketProcessResolver::GetTcpTable(DWORD* tableSize) {
  * @param localIP A pointer to a DWORD to receive the local IP address.
  */
 void SocketProcessResolver::GetLocalSocketInfo(SOCKET s, DWORD* localPort, DWORD* localIP) {
+    PhaseTimer timer(ResolvePhase::PeerAddress);
     struct sockaddr_in ourLocalAddr = {0};
     int ourAddrLen = sizeof(ourLocalAddr);
     getsockname(s, (struct sockaddr*)&ourLocalAddr, &ourAddrLen);
@@ -219,79 +251,60 @@ void SocketProcessResolver::GetLocalSocketInfo(SOCKET s, DWORD* localPort, DWORD
  * https://learn.microsoft.com/en-us/windows/win32/api/tcpmib/ns-tcpmib-mib_tcprow_owner_pid
  * 
  * @param row The TCP row to extract information from.
- * @param tableLocalPort A pointer to a DWORD to receive the local port.
- * @param tableLocalIP A pointer to a DWORD to receive the local IP address.
- * @param tableRemotePort A pointer to a DWORD to receive the remote port.
- * @param tableRemoteIP A pointer to a DWORD to receive the remote IP address.
+ * @param tableRow A pointer to a TcpTableRow to receive the addresses (in host byte order) and the owning process ID.
  */
-void SocketProcessResolver::ExtractRowInfo(const MIB_TCPROW_OWNER_PID* row, DWORD* tableLocalPort, DWORD* tableLocalIP, DWORD* tableRemotePort, DWORD* tableRemoteIP) {
-    *tableLocalPort = ntohs((USHORT)row->dwLocalPort);
-    *tableLocalIP = ntohl(row->dwLocalAddr);
-    *tableRemotePort = ntohs((USHORT)row->dwRemotePort);
-    *tableRemoteIP = ntohl(row->dwRemoteAddr);
-}
-
-/** 
- * Check if the connection matches the given parameters. This function checks if the local and remote ports and IP addresses match the specified values.
- * 
- * @param tableLocalPort The local port from the TCP table.
- * @param tableLocalIP The local IP address from the TCP table.
- * @param tableRemotePort The remote port from the TCP table.
- * @param tableRemoteIP The remote IP address from the TCP table.
- * @param ourLocalPort The local port of our socket.
- * @param ourLocalIP The local IP address of our socket.
- * @param remotePort The remote port we are looking for.
- * @param remoteIP The remote IP address we are looking for.
- * @return TRUE if the connection matches, FALSE otherwise.
- */
-BOOL SocketProcessResolver::IsMatchingConnection(DWORD tableLocalPort, DWORD tableLocalIP, DWORD tableRemotePort, DWORD tableRemoteIP, DWORD ourLocalPort, DWORD ourLocalIP, DWORD remotePort, DWORD remoteIP) {
-    return (tableRemotePort == ourLocalPort && tableRemoteIP == ourLocalIP && tableLocalPort == remotePort &&  tableLocalIP == remoteIP);
+void SocketProcessResolver::ExtractRowInfo(const MIB_TCPROW_OWNER_PID* row, TcpTableRow* tableRow) {
+    tableRow->key.localPort = ntohs((USHORT)row->dwLocalPort);
+    tableRow->key.localIP = ntohl(row->dwLocalAddr);
+    tableRow->key.remotePort = ntohs((USHORT)row->dwRemotePort);
+    tableRow->key.remoteIP = ntohl(row->dwRemoteAddr);
+    tableRow->owningPid = row->dwOwningPid;
 }
 
 /** 
  * Find the matching process in the TCP table based on the remote port and IP address, as well as our local port and IP address.
+ * The row we are after is the one owned by the peer, so its local end is the remote end of our socket and vice versa.
  * 
- * @param pTcpTable The TCP table to search.
  * @param remotePort The remote port we are looking for.
  * @param remoteIP The remote IP address we are looking for.
  * @param ourLocalPort The local port of our socket.
  * @param ourLocalIP The local IP address of our socket.
- * @return The full path of the executable for the matching process, or NULL if no match is found.
+ * @param mark The snapshot mark taken once we had the socket, rows from older snapshots are not trusted.
+ * @param owningPid A pointer to a DWORD to receive the ID of the process owning the connection.
+ * @return TRUE if a matching connection was found, FALSE otherwise.
  */
-char* SocketProcessResolver::FindMatchingProcess(PMIB_TCPTABLE_OWNER_PID pTcpTable, DWORD remotePort, DWORD remoteIP, DWORD ourLocalPort, DWORD ourLocalIP) {
-    DWORD i;
-    for (i = 0; i < pTcpTable->dwNumEntries; i++) {
-        const MIB_TCPROW_OWNER_PID* row = &pTcpTable->table[i];
-        
-        DWORD tableLocalPort, tableLocalIP, tableRemotePort, tableRemoteIP;
-        ExtractRowInfo(row, &tableLocalPort, &tableLocalIP, &tableRemotePort, &tableRemoteIP);
-        
-        if (!IsMatchingConnection(tableLocalPort, tableLocalIP, tableRemotePort, tableRemoteIP, ourLocalPort, ourLocalIP, remotePort, remoteIP)) {
-            continue;
-        }
+BOOL SocketProcessResolver::FindMatchingProcess(DWORD remotePort, DWORD remoteIP, DWORD ourLocalPort, DWORD ourLocalIP, uint64_t mark, DWORD* owningPid) {
+    PhaseTimer timer(ResolvePhase::MatchProcess);
+    TcpConnectionKey key = {0};
+    key.localIP = remoteIP;
+    key.localPort = (uint16_t)remotePort;
+    key.remoteIP = ourLocalIP;
+    key.remotePort = (uint16_t)ourLocalPort;
     
-        return GetExecutableNameFromPID(row->dwOwningPid);
+    uint32_t pid = 0;
+    if (!GetTcpSnapshot().FindOwningPid(key, mark, pid)) {
+        return FALSE;
     }
     
-    return NULL;
+    *owningPid = pid;
+    return TRUE;
 }
 
 /** 
- * Get the full path of the executable for the remote process associated with a socket.
+ * Resolve the ID of the process on the other end of a socket, without opening the process.
+ * The PID is always read from a TCP table loaded after this call started, when the connection already existed,
+ * so it can't be the owner of an earlier connection on the same 4-tuple.
  * 
  * @param s The socket to query.
- * @return The full path of the remote process, or "Unknown" if it cannot be determined.
+ * @param owningPid Receives the ID of the process owning the other end.
+ * @return ResolveResult::Ok if the connection was found in the TCP table, otherwise the reason it couldn't be.
  */
-char* SocketProcessResolver::GetRemoteProcessFullPath(SOCKET s) {
-    struct sockaddr_in remoteAddr = {0};
-    if (GetPeerAddress(s, &remoteAddr) != 0) {
-        return AllocateString("Unknown");
-    }
+ResolveResult SocketProcessResolver::ResolveRemoteProcessId(SOCKET s, uint32_t* owningPid) {
+    const uint64_t mark = GetTcpSnapshot().Mark();
     
-    DWORD tableSize = 0;
-    PMIB_TCPTABLE_OWNER_PID pTcpTable = GetTcpTable(&tableSize);
-    if (!pTcpTable) {
-        return AllocateString("Unknown");
+    struct sockaddr_in remoteAddr = {0};
+    if (GetPeerAddress(s, &remoteAddr) != 0 || remoteAddr.sin_family != AF_INET) {
+        return ResolveResult::NoPeerAddress;
     }
     
     DWORD remotePort = ntohs(remoteAddr.sin_port);
@@ -300,14 +313,66 @@ char* SocketProcessResolver::GetRemoteProcessFullPath(SOCKET s) {
     DWORD ourLocalPort, ourLocalIP;
     GetLocalSocketInfo(s, &ourLocalPort, &ourLocalIP);
     
-    char* result = FindMatchingProcess(pTcpTable, remotePort, remoteIP, ourLocalPort, ourLocalIP);
-    free(pTcpTable);
+    ResolveTrace& trace = ResolveTrace::Current();
+    trace.connection.localIP = ourLocalIP;
+    trace.connection.localPort = (uint16_t)ourLocalPort;
+    trace.connection.remoteIP = remoteIP;
+    trace.connection.remotePort = (uint16_t)remotePort;
+    
+    DWORD pid = 0;
+    if (!FindMatchingProcess(remotePort, remoteIP, ourLocalPort, ourLocalIP, mark, &pid)) {
+        return ResolveResult::ConnectionNotFound;
+    }
     
-    if (result) return result;
-    return AllocateString("Unknown");
+    *owningPid = pid;
+    trace.owningPid = pid;
+    return ResolveResult::Ok;
 }
 
-/* Helper function to free the returned strings */
-void SocketProcessResolver::FreeProcessPath(char* path) {
-    if (path) free(path);  
-}
\ No newline at end of file
+/** 
+ * Resolve every process holding the other end of a socket.
+ * The TCP table only names the process that created the socket, whoever else it was handed to. That process has to be trusted
+ * for the connection to be, so it stands for all of the holders.
+ * 
+ * @param s The socket to query.
+ * @param holders Receives the owning process, as the only and complete holder.
+ * @return ResolveResult::Ok if the connection was found in the TCP table, otherwise the reason it couldn't be.
+ */
+ResolveResult SocketProcessResolver::ResolveRemoteHolders(SOCKET s, SocketHolders& holders, bool) {
+    holders.count = 0;
+    holders.complete = false;
+    
+    uint32_t owningPid = 0;
+    ResolveResult result = ResolveRemoteProcessId(s, &owningPid);
+    if (result != ResolveResult::Ok) {
+        return result;
+    }
+    
+    holders.processIds[0] = owningPid;
+    holders.count = 1;
+    holders.complete = true;
+    return ResolveResult::Ok;
+}
+
+/** 
+ * Resolve the process on the other end of a socket.
+ * Nothing in here allocates once the TCP snapshot, device map and process cache are warm, as it runs on the recv path.
+ * 
+ * @param s The socket to query.
+ * @param process Receives the owning process ID and the full path of its executable.
+ * @return ResolveResult::Ok if the process was resolved, otherwise the reason it couldn't be.
+ */
+ResolveResult SocketProcessResolver::ResolveRemoteProcess(SOCKET s, RemoteProcess& process) {
+    process.processId = 0;
+    process.image.path.Clear();
+    process.image.identity = FileIdentity();
+    
+    uint32_t owningPid = 0;
+    ResolveResult result = ResolveRemoteProcessId(s, &owningPid);
+    if (result != ResolveResult::Ok) {
+        return result;
+    }
+    
+    process.processId = owningPid;
+    return GetExecutableNameFromPID(owningPid, process.image);
+}
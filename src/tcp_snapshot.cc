@@ -0,0 +1,125 @@
+#include <tcp_snapshot.h>
+#include <atomic>
+
+TcpTableSnapshot::TcpTableSnapshot(const std::vector<TcpTableRow>& rows, uint64_t generation) {
+    Assign(rows, generation);
+}
+
+/**
+ * Linear probing over at least twice as many buckets as rows. The vectors keep their capacity,
+ * so rebuilding from a table that didn't grow allocates nothing.
+ */
+void TcpTableSnapshot::Assign(const std::vector<TcpTableRow>& loaded, uint64_t loadGeneration) {
+    generation = loadGeneration;
+
+    size_t bucketCount = 16;
+    while (bucketCount < loaded.size() * 2) bucketCount <<= 1;
+    buckets.assign(bucketCount, 0);
+
+    rows.clear();
+    rows.reserve(loaded.size());
+    const size_t mask = bucketCount - 1;
+    for (const TcpTableRow& row : loaded) {
+        size_t bucket = TcpConnectionKeyHash()(row.key) & mask;
+        while (buckets[bucket] != 0 && !(rows[buckets[bucket] - 1].key == row.key)) {
+            bucket = (bucket + 1) & mask;
+        }
+        if (buckets[bucket] != 0) continue;
+
+        rows.push_back(row);
+        buckets[bucket] = (uint32_t)rows.size();
+    }
+}
+
+bool TcpTableSnapshot::FindOwningPid(const TcpConnectionKey& key, uint32_t& owningPid) const {
+    const size_t mask = buckets.size() - 1;
+    for (size_t bucket = TcpConnectionKeyHash()(key) & mask; buckets[bucket] != 0; bucket = (bucket + 1) & mask) {
+        const TcpTableRow& row = rows[buckets[bucket] - 1];
+        if (row.key == key) {
+            owningPid = row.owningPid;
+            return true;
+        }
+    }
+    return false;
+}
+
+TcpSnapshotProvider::TcpSnapshotProvider(Loader loader) : loader(std::move(loader)) {}
+
+std::shared_ptr<const TcpTableSnapshot> TcpSnapshotProvider::Current() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return current;
+}
+
+uint64_t TcpSnapshotProvider::LoadCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return loadCount;
+}
+
+/** Loads are numbered when they start, so every load numbered above the current count starts after this call. */
+uint64_t TcpSnapshotProvider::Mark() const {
+    return LoadCount();
+}
+
+/**
+ * Single-flight refresh. The first thread to find the snapshot stale becomes the loader, every other thread
+ * that shows up while that load is running waits for it and reuses its result.
+ * 
+ * A load that was already running when we arrived may have dumped the table before our connection existed,
+ * so callers only accept a load that started after they did. Loads are numbered in start order for that reason.
+ */
+std::shared_ptr<const TcpTableSnapshot> TcpSnapshotProvider::Refresh() {
+    std::unique_lock<std::mutex> guard(lock);
+    const uint64_t needed = loadCount + 1;
+
+    while (refreshing) {
+        refreshed.wait(guard);
+        if (completedGeneration >= needed) {
+            return (current && current->Generation() >= needed) ? current : nullptr;
+        }
+    }
+
+    refreshing = true;
+    uint64_t generation = ++loadCount;
+    std::shared_ptr<TcpTableSnapshot> snapshot = std::move(spare);
+    guard.unlock();
+
+    const bool loaded = loader(rows);
+    if (loaded) {
+        /** The spare is only reachable from here, so once its count is down to ours no reader can pick it up again. */
+        if (snapshot && snapshot.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            snapshot->Assign(rows, generation);
+        } else {
+            snapshot = std::make_shared<TcpTableSnapshot>(rows, generation);
+        }
+    }
+
+    guard.lock();
+    if (loaded) {
+        spare = std::move(current);
+        current = snapshot;
+    } else {
+        spare = std::move(snapshot);
+    }
+    completedGeneration = generation;
+    refreshing = false;
+    guard.unlock();
+
+    refreshed.notify_all();
+    if (!loaded) return nullptr;
+    return snapshot;
+}
+
+bool TcpSnapshotProvider::FindOwningPid(const TcpConnectionKey& key, uint64_t mark, uint32_t& owningPid) {
+    std::shared_ptr<const TcpTableSnapshot> snapshot = Current();
+    if (snapshot && snapshot->Generation() > mark && snapshot->FindOwningPid(key, owningPid)) {
+        return true;
+    }
+
+    /**
+     * Either the snapshot was loaded before the connection existed, and its row for the 4-tuple may belong to an earlier connection
+     * of another process, or the connection is newer than the snapshot (or we have none yet). One refresh settles both.
+     */
+    snapshot = Refresh();
+    return snapshot && snapshot->FindOwningPid(key, owningPid);
+}
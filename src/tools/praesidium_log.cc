@@ -0,0 +1,120 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <decision_log.h>
+
+/**
+ * Dumps a Praesidium decision log as text or CSV.
+ *
+ * Usage: praesidium-log [--csv] <praesidium.log> [more logs...]
+ * Pass praesidium.1.log before praesidium.log to read the history in order.
+ */
+
+static const char* VerdictName(uint8_t verdict) {
+    switch ((Verdict)verdict) {
+        case Verdict::Allow: return "allow";
+        case Verdict::Block: return "block";
+        case Verdict::Drop: return "drop";
+        case Verdict::Restrict: return "restrict";
+        case Verdict::Pending: return "pending";
+        default: return "unknown";
+    }
+}
+
+static void FormatAddress(uint32_t ip, uint16_t port, char* out, size_t outSize) {
+    snprintf(out, outSize, "%u.%u.%u.%u:%u", (ip >> 24) & 0xFF, (ip >> 16) & 0xFF, (ip >> 8) & 0xFF, ip & 0xFF, port);
+}
+
+static void FormatTimestamp(uint64_t timestamp, char* out, size_t outSize) {
+    time_t seconds = (time_t)(timestamp / 1000000000ull);
+    struct tm utc = {};
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    size_t length = strftime(out, outSize, "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(out + length, outSize - length, ".%06" PRIu64 "Z", (uint64_t)((timestamp % 1000000000ull) / 1000));
+}
+
+static void PrintHeader(bool csv) {
+    if (csv) {
+        printf("timestamp,socket,local,remote,pid,verdict");
+        for (size_t i = 0; i < RESOLVE_PHASE_COUNT; i++) printf(",%s_ns", ResolvePhaseName((ResolvePhase)i));
+        printf(",total_ns\n");
+    }
+}
+
+static void PrintRecord(const DecisionRecord& record, bool csv) {
+    char timestamp[48], local[32], remote[32];
+    FormatTimestamp(record.timestamp, timestamp, sizeof(timestamp));
+    FormatAddress(record.localIP, record.localPort, local, sizeof(local));
+    FormatAddress(record.remoteIP, record.remotePort, remote, sizeof(remote));
+
+    if (csv) {
+        printf("%s,%" PRIu64 ",%s,%s,%u,%s", timestamp, record.socket, local, remote, record.owningPid, VerdictName(record.verdict));
+        for (uint32_t phase : record.phaseNanoseconds) printf(",%u", phase);
+        printf(",%u\n", record.totalNanoseconds);
+        return;
+    }
+
+    printf("%s %-5s socket=%" PRIu64 " %s <- %s pid=%u total=%uns", timestamp, VerdictName(record.verdict), record.socket, local, remote, record.owningPid, record.totalNanoseconds);
+    for (size_t i = 0; i < RESOLVE_PHASE_COUNT; i++) {
+        if (record.phaseNanoseconds[i]) printf(" %s=%uns", ResolvePhaseName((ResolvePhase)i), record.phaseNanoseconds[i]);
+    }
+    printf("\n");
+}
+
+/**
+ * @return false if the file couldn't be read or isn't a decision log.
+ */
+static bool DumpLog(const char* path, bool csv) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "praesidium-log: can't open %s\n", path);
+        return false;
+    }
+
+    DecisionLogHeader header = {};
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, DECISION_LOG_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "praesidium-log: %s is not a decision log\n", path);
+        fclose(file);
+        return false;
+    }
+    if (header.version != DECISION_LOG_VERSION || header.recordSize != sizeof(DecisionRecord) || header.phaseCount != RESOLVE_PHASE_COUNT) {
+        fprintf(stderr, "praesidium-log: %s has an unsupported format (version %u, record size %u)\n", path, header.version, header.recordSize);
+        fclose(file);
+        return false;
+    }
+
+    DecisionRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        PrintRecord(record, csv);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "--csv") == 0) {
+        csv = true;
+        first = 2;
+    }
+
+    if (first >= argc) {
+        fprintf(stderr, "usage: praesidium-log [--csv] <praesidium.log> [more logs...]\n");
+        return 2;
+    }
+
+    PrintHeader(csv);
+
+    int status = 0;
+    for (int i = first; i < argc; i++) {
+        if (!DumpLog(argv[i], csv)) status = 1;
+    }
+    return status;
+}
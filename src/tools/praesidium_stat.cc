@@ -0,0 +1,82 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <metrics.h>
+
+/**
+ * Prints the live metrics of a process running the gate, read from its shared memory segment.
+ *
+ * Usage: praesidium-stat <pid> [interval in seconds]
+ * With an interval the metrics are printed again every interval until interrupted.
+ */
+
+/** Print a duration in the unit that keeps it readable. */
+static void PrintDuration(uint64_t nanoseconds) {
+    if (nanoseconds < 10000) printf(" %8" PRIu64 "ns", nanoseconds);
+    else if (nanoseconds < 10000000) printf(" %8.1fus", nanoseconds / 1e3);
+    else printf(" %8.1fms", nanoseconds / 1e6);
+}
+
+static void PrintHistogram(const char* name, const LatencyHistogram& histogram, LatencyHistogram::Snapshot& snapshot) {
+    histogram.Read(snapshot);
+
+    printf("%-14s %10" PRIu64, name, snapshot.count);
+    PrintDuration(snapshot.ValueAtQuantile(0.50));
+    PrintDuration(snapshot.ValueAtQuantile(0.90));
+    PrintDuration(snapshot.ValueAtQuantile(0.99));
+    PrintDuration(snapshot.ValueAtQuantile(0.999));
+    PrintDuration(snapshot.max);
+    PrintDuration(snapshot.Mean());
+    printf("\n");
+}
+
+static void PrintMetrics(const SharedMetrics& metrics) {
+    /** Too large for the stack of every platform we care about. */
+    static std::unique_ptr<LatencyHistogram::Snapshot> snapshot(new LatencyHistogram::Snapshot());
+
+    printf("pid %u: allowed %" PRIu64 ", blocked %" PRIu64 ", dropped %" PRIu64 ", restricted %" PRIu64 ", denied %" PRIu64 "\n", metrics.header.processId,
+        metrics.allowed.load(std::memory_order_relaxed), metrics.blocked.load(std::memory_order_relaxed), metrics.dropped.load(std::memory_order_relaxed),
+        metrics.restricted.load(std::memory_order_relaxed), metrics.denied.load(std::memory_order_relaxed));
+
+    printf("startup: probe");
+    PrintDuration(metrics.probeNanoseconds.load(std::memory_order_relaxed));
+    printf(", attach");
+    PrintDuration(metrics.attachNanoseconds.load(std::memory_order_relaxed));
+    printf(", start");
+    PrintDuration(metrics.startNanoseconds.load(std::memory_order_relaxed));
+    printf("\n");
+
+    printf("%-14s %10s %10s %10s %10s %10s %10s %10s\n", "phase", "count", "p50", "p90", "p99", "p99.9", "max", "mean");
+    for (size_t i = 0; i < RESOLVE_PHASE_COUNT; i++) {
+        PrintHistogram(ResolvePhaseName((ResolvePhase)i), metrics.phases[i], *snapshot);
+    }
+    PrintHistogram("total", metrics.total, *snapshot);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: praesidium-stat <pid> [interval in seconds]\n");
+        return 2;
+    }
+
+    uint32_t processId = (uint32_t)strtoul(argv[1], nullptr, 10);
+    double interval = argc > 2 ? atof(argv[2]) : 0;
+
+    const SharedMetrics* metrics = Metrics::OpenSegment(processId);
+    if (!metrics) {
+        fprintf(stderr, "praesidium-stat: no metrics for process %u\n", processId);
+        return 1;
+    }
+
+    PrintMetrics(*metrics);
+    while (interval > 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+        printf("\n");
+        PrintMetrics(*metrics);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+#include <trust_policy.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wide_path.h>
+
+static const char PATH_SEPARATOR = '\\';
+
+/** Windows paths are case-insensitive and take either slash, so both sides of a comparison are lowercased with backslashes. */
+static void NormalizePath(char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+        if (c == '/') c = '\\';
+        else if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        data[i] = c;
+    }
+}
+
+/**
+ * @param path The file.
+ * @param size Receives the size of the file.
+ * @param modified Receives the last write time of the file.
+ * @return false if the file doesn't exist.
+ */
+static bool GetFileStamp(const std::string& path, uint64_t& size, uint64_t& modified) {
+    std::wstring widePath;
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!ToWidePath(path.c_str(), widePath) || !GetFileAttributesExW(widePath.c_str(), GetFileExInfoStandard, &data)) return false;
+
+    size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    modified = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+/** @return The file opened for reading, NULL if it can't be. */
+static FILE* OpenPolicyFile(const std::string& path) {
+    std::wstring widePath;
+    return ToWidePath(path.c_str(), widePath) ? _wfopen(widePath.c_str(), L"rb") : NULL;
+}
+#else
+#include <sys/stat.h>
+
+static const char PATH_SEPARATOR = '/';
+
+static void NormalizePath(char*, size_t) {}
+
+static bool GetFileStamp(const std::string& path, uint64_t& size, uint64_t& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+
+    size = (uint64_t)info.st_size;
+    modified = (uint64_t)info.st_mtim.tv_sec * 1000000000ull + (uint64_t)info.st_mtim.tv_nsec;
+    return true;
+}
+
+static FILE* OpenPolicyFile(const std::string& path) {
+    return fopen(path.c_str(), "rb");
+}
+#endif
+
+/** A policy with tens of thousands of entries is well below this, anything larger isn't a policy file. */
+static const uint64_t MAX_POLICY_BYTES = 16 * 1024 * 1024;
+
+static std::string_view Trim(std::string_view text) {
+    static const char* WHITESPACE = " \t\r";
+    size_t first = text.find_first_not_of(WHITESPACE);
+    if (first == std::string_view::npos) return std::string_view();
+
+    size_t last = text.find_last_not_of(WHITESPACE);
+    return text.substr(first, last - first + 1);
+}
+
+static std::string Normalized(std::string_view path) {
+    std::string result(path);
+    NormalizePath(&result[0], result.size());
+    return result;
+}
+
+std::unique_ptr<const TrustPolicy> TrustPolicy::Compile(std::string_view text, size_t& errorLine) {
+    std::unique_ptr<TrustPolicy> policy(new TrustPolicy());
+    std::vector<std::string> prefixList;
+
+    size_t lineNumber = 0;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = Trim(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        lineNumber++;
+
+        if (line.empty() || line[0] == '#') continue;
+
+        /** The value is the rest of the line, paths can contain spaces. */
+        size_t space = line.find_first_of(" \t");
+        std::string_view kind = line.substr(0, space);
+        std::string_view value = space == std::string_view::npos ? std::string_view() : Trim(line.substr(space));
+        if (value.empty() || value.size() >= PROCESS_PATH_CAPACITY) {
+            errorLine = lineNumber;
+            return nullptr;
+        }
+
+        if (kind == "identity") {
+            std::string path(value);
+            FileIdentity identity;
+            std::string imagePath;
+#ifdef _WIN32
+            bool found = GetFileIdentity(path.c_str(), identity) && GetFinalPath(path.c_str(), imagePath);
+            NormalizePath(&imagePath[0], imagePath.size());
+#else
+            bool found = GetFileIdentity(path.c_str(), identity);
+#endif
+            if (found) policy->identities.emplace(identity, std::move(imagePath));
+            else policy->missingIdentities++;
+        } else if (kind == "path") {
+            policy->pathStorage.push_back(Normalized(value));
+        } else if (kind == "sha256") {
+            Sha256Digest digest;
+            if (!Sha256Digest::FromHex(value, digest)) {
+                errorLine = lineNumber;
+                return nullptr;
+            }
+            policy->digests.insert(digest);
+        } else if (kind == "prefix") {
+            /** A prefix names a directory, so C:\Tools doesn't match C:\ToolsEvil\x.exe. */
+            std::string prefix = Normalized(value);
+            if (prefix.back() != PATH_SEPARATOR) prefix += PATH_SEPARATOR;
+            prefixList.push_back(std::move(prefix));
+        } else {
+            errorLine = lineNumber;
+            return nullptr;
+        }
+    }
+
+    /** Every prefix that starts with a kept one sorts right after it, so one pass over the sorted list drops them all. */
+    std::sort(prefixList.begin(), prefixList.end());
+    for (std::string& prefix : prefixList) {
+        const std::string* kept = policy->prefixStorage.empty() ? nullptr : &policy->prefixStorage.back();
+        if (kept && prefix.compare(0, kept->size(), *kept) == 0) continue;
+        policy->prefixStorage.push_back(std::move(prefix));
+    }
+
+    policy->paths.reserve(policy->pathStorage.size());
+    for (const std::string& path : policy->pathStorage) policy->paths.insert(path);
+    policy->prefixes.assign(policy->prefixStorage.begin(), policy->prefixStorage.end());
+    return policy;
+}
+
+/**
+ * No kept prefix starts with another, so a matching prefix is the greatest one that sorts before the path:
+ * anything between it and the path would start with it too.
+ */
+bool TrustPolicy::MatchesPrefix(std::string_view path) const {
+    auto next = std::upper_bound(prefixes.begin(), prefixes.end(), path);
+    if (next == prefixes.begin()) return false;
+
+    std::string_view candidate = *(next - 1);
+    return path.compare(0, candidate.size(), candidate) == 0;
+}
+
+/** On Windows an identity only counts together with the path the process was started from, see SecurityCheck::IsSteamProcess. */
+bool TrustPolicy::Trusts(const ProcessImage& image) const {
+#ifdef _WIN32
+    if (image.path.Empty()) return false;
+
+    char normalized[PROCESS_PATH_CAPACITY];
+    memcpy(normalized, image.path.CStr(), image.path.length);
+    NormalizePath(normalized, image.path.length);
+    std::string_view path(normalized, image.path.length);
+
+    if (!identities.empty() && image.identity.IsValid()) {
+        auto identity = identities.find(image.identity);
+        if (identity != identities.end() && identity->second == path) return true;
+    }
+#else
+    if (!identities.empty() && image.identity.IsValid() && identities.count(image.identity)) return true;
+    if (image.path.Empty()) return false;
+
+    std::string_view path = image.path.View();
+#endif
+
+    return (!paths.empty() && paths.count(path)) || (!prefixes.empty() && MatchesPrefix(path));
+}
+
+TrustPolicyFile::TrustPolicyFile(std::string path, std::chrono::milliseconds interval)
+    : path(std::move(path)), interval(interval) {}
+
+TrustPolicyFile::~TrustPolicyFile() {
+    Shutdown(true);
+}
+
+/**
+ * @param path The file.
+ * @param size The size of the file when it was stamped, what is read may differ if the file is being written.
+ * @param text Receives the contents of the file.
+ */
+static bool ReadPolicyFile(const std::string& path, uint64_t size, std::string& text) {
+    if (size > MAX_POLICY_BYTES) return false;
+
+    FILE* file = OpenPolicyFile(path);
+    if (!file) return false;
+
+    text.resize((size_t)size);
+    text.resize(fread(&text[0], 1, text.size(), file));
+    fclose(file);
+    return true;
+}
+
+/**
+ * The stamp of an invalid file is remembered too, so a broken file is compiled again only once it changes.
+ * A file that is caught halfway through being written is loaded again on the next check, as its stamp changes once more.
+ */
+bool TrustPolicyFile::Reload() {
+    std::lock_guard<std::mutex> guard(reloadLock);
+
+    uint64_t size = 0;
+    uint64_t modified = 0;
+    if (!GetFileStamp(path, size, modified)) {
+        if (!loaded) return false;
+
+        loaded = false;
+        current.Publish(nullptr);
+        loads.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (loaded && size == loadedSize && modified == loadedTime) return false;
+
+    std::string text;
+    if (!ReadPolicyFile(path, size, text)) return false;
+
+    loaded = true;
+    loadedSize = size;
+    loadedTime = modified;
+
+    size_t errorLine = 0;
+    std::unique_ptr<const TrustPolicy> policy = TrustPolicy::Compile(text, errorLine);
+    if (!policy) return false;
+
+    current.Publish(std::move(policy));
+    loads.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void TrustPolicyFile::Start() {
+    if (reloader.joinable() || stopping.load(std::memory_order_acquire)) return;
+    reloader = std::thread(&TrustPolicyFile::ReloaderLoop, this);
+}
+
+void TrustPolicyFile::Shutdown(bool join) {
+    if (stopping.exchange(true)) return;
+
+    if (!reloader.joinable()) return;
+    if (join) reloader.join();
+    else reloader.detach();
+}
+
+/** Waits in short steps so Shutdown doesn't have to wait out a whole interval. */
+void TrustPolicyFile::ReloaderLoop() {
+    static const std::chrono::milliseconds STEP(100);
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        Reload();
+
+        for (std::chrono::milliseconds waited(0); waited < interval && !stopping.load(std::memory_order_acquire); waited += STEP) {
+            std::this_thread::sleep_for(std::min(STEP, interval - waited));
+        }
+    }
+}
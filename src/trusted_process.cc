@@ -0,0 +1,83 @@
+#include <trusted_process.h>
+#include <process_info.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+TrustedProcess::~TrustedProcess() {
+    if (handle) CloseHandle((HANDLE)handle);
+}
+
+/**
+ * The handle is never used for anything, holding it is what keeps Windows from handing the PID to another process.
+ */
+bool TrustedProcess::Pin(uint32_t processId) {
+    if (processId == 0 || pinnedId != 0) return false;
+    if (!GetProcessStartTime(processId, startTime)) return false;
+
+    HANDLE hProcess = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if (!hProcess) return false;
+
+    /** Make sure the process we opened is the one we got the start time from. */
+    uint64_t openedStartTime = 0;
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime)) {
+        openedStartTime = ((uint64_t)creationTime.dwHighDateTime << 32) | creationTime.dwLowDateTime;
+    }
+    if (openedStartTime != startTime) {
+        CloseHandle(hProcess);
+        return false;
+    }
+
+    handle = hProcess;
+    pinnedId = processId;
+    return true;
+}
+
+bool TrustedProcess::Matches(uint32_t processId) const {
+    return pinnedId != 0 && processId == pinnedId;
+}
+#else
+#include <poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+TrustedProcess::~TrustedProcess() {
+    if (pidfd >= 0) close(pidfd);
+}
+
+bool TrustedProcess::Pin(uint32_t processId) {
+    if (processId == 0 || pinnedId != 0) return false;
+    if (!GetProcessStartTime(processId, startTime)) return false;
+
+#ifdef SYS_pidfd_open
+    pidfd = (int)syscall(SYS_pidfd_open, (pid_t)processId, 0);
+#endif
+
+    /** Make sure the process the pidfd refers to is the one we got the start time from. */
+    uint64_t currentStartTime = 0;
+    if (!GetProcessStartTime(processId, currentStartTime) || currentStartTime != startTime) {
+        if (pidfd >= 0) close(pidfd);
+        pidfd = -1;
+        return false;
+    }
+
+    pinnedId = processId;
+    return true;
+}
+
+/**
+ * A pidfd becomes readable once the process exits. Kernels without pidfd_open (before 5.3) fall back to comparing the start time.
+ */
+bool TrustedProcess::Matches(uint32_t processId) const {
+    if (pinnedId == 0 || processId != pinnedId) return false;
+
+    if (pidfd >= 0) {
+        struct pollfd pfd = { pidfd, POLLIN, 0 };
+        return poll(&pfd, 1, 0) == 0;
+    }
+
+    uint64_t currentStartTime = 0;
+    return GetProcessStartTime(processId, currentStartTime) && currentStartTime == startTime;
+}
+#endif
@@ -8,6 +8,10 @@
 #include <Windows.h>
 #include <TlHelp32.h>
 #include <vector>
+#include <utilities.h>
+#include <command_line.h>
+#include <process_info.h>
+#include <debugger_port.h>
 
 /** 
  * Creates a snapshot of all processes in the system.
@@ -36,73 +40,6 @@ bool FindProcessByPID(HANDLE hSnapshot, DWORD targetPID, PROCESSENTRY32W& pe) {
     return false;
 }
 
-/** 
- * Retrieves the parent process ID of the current process.
- * 
- * @return The parent process ID, or 0 if it cannot be determined.
- */
-DWORD GetCurrentProcessParentPID() {
-    HANDLE hSnapshot = CreateProcessSnapshot();
-    if (hSnapshot == INVALID_HANDLE_VALUE) {
-        return 0;
-    }
-    
-    PROCESSENTRY32W pe = { sizeof(PROCESSENTRY32W) };
-    DWORD currentPID = GetCurrentProcessId();
-    DWORD parentPID = 0;
-    
-    if (FindProcessByPID(hSnapshot, currentPID, pe)) {
-        parentPID = pe.th32ParentProcessID;
-    }
-    
-    CloseHandle(hSnapshot);
-    return parentPID;
-}
-
-/** 
- * Retrieves the name of a process by its PID.
- * 
- * @param pid The PID of the process.
- * @return The name of the process, or an empty string if it cannot be determined.
- */
-std::wstring GetProcessNameByPID(DWORD pid) {
-    if (pid == 0) return {};
-    
-    HANDLE hSnapshot = CreateProcessSnapshot();
-    if (hSnapshot == INVALID_HANDLE_VALUE) return {};  
-    
-    PROCESSENTRY32W pe = { sizeof(PROCESSENTRY32W) };
-    std::wstring processName = L"";
-    
-    if (FindProcessByPID(hSnapshot, pid, pe)) {
-        processName = std::wstring(pe.szExeFile);
-    }
-    
-    CloseHandle(hSnapshot);
-    return processName;
-}
-
-/** 
- * Retrieves the name of the parent process of the current process.
- * 
- * @return The name of the parent process, or an empty string if it cannot be determined.
- */
-std::wstring GetParentProcessName() {
-    DWORD parentPID = GetCurrentProcessParentPID();
-    return GetProcessNameByPID(parentPID);
-}
-
-/** 
- * Extracts the filename from a full path.
- * 
- * @param fullPath The full path to extract the filename from.
- * @return The filename extracted from the full path.
- */
-std::wstring ExtractFilenameFromPath(const std::wstring& fullPath) {
-    size_t pos = fullPath.find_last_of(L"\\/");
-    return (pos == std::wstring::npos) ? fullPath : fullPath.substr(pos + 1);
-}
-
 /** 
  * Converts a string to lowercase.
  * 
@@ -115,69 +52,6 @@ std::wstring ToLowerCase(const std::wstring& str) {
     return result;
 }
 
-/** 
- * Retrieves the name of the current process.
- * 
- * @return The name of the current process, or an empty string if it cannot be determined.
- */
-std::wstring GetCurrentProcessName() {
-    wchar_t path[MAX_PATH] = {0};
-    if (GetModuleFileNameW(nullptr, path, MAX_PATH) == 0) return {};
-    
-    std::wstring fullPath(path);
-    std::wstring filename = ExtractFilenameFromPath(fullPath);
-    return ToLowerCase(filename);
-}
-
-/** 
- * Parses the command line arguments of the current process.
- * 
- * @return A vector of strings containing the command line arguments.
- */
-std::vector<std::string> ParseCommandLineArgs() {
-    std::vector<std::string> args;
-    
-    LPWSTR* argv;
-    int argc;
-    argv = CommandLineToArgvW(GetCommandLineW(), &argc);
-    
-    if (argv == nullptr) return args;
-    
-    for (int i = 0; i < argc; ++i) {
-        std::wstring warg(argv[i]);
-        std::string arg(warg.begin(), warg.end());
-        args.push_back(arg);
-    }
-    
-    LocalFree(argv);
-    return args;
-}
-
-/** 
- * Checks if a specific command line argument exists.
- * 
- * @param targetArg The argument to check for.
- * @return True if the argument exists, false otherwise.
- */
-bool HasCommandLineArg(const std::string& targetArg) {
-    std::vector<std::string> args = ParseCommandLineArgs();
-    
-    for (const auto& arg : args) 
-        if (arg == targetArg) return true;
-    
-    return false;
-}
-
-/** 
- * Checks if the application is running in developer mode.
- * Developer mode is indicated by the presence of the "-dev" command line argument.
- * 
- * @return True if in developer mode, false otherwise.
- */
-BOOL IsDeveloperMode() {
-    return HasCommandLineArg("-dev");
-}
-
 /** 
  * Converts a wide string to a UTF-8 encoded string.
  * 
@@ -196,79 +70,67 @@ std::string WideStringToUTF8(const std::wstring& wstr) {
 }
 
 /** 
- * Finds a command line argument that starts with a specific prefix.
+ * Finds the current process and its parent in a single snapshot.
+ * The parent is looked up by a second walk over the same snapshot, walking it is cheap next to taking it.
  * 
- * @param prefix The prefix to search for.
- * @return The argument string if found, or an empty string if not found.
+ * @param probe The probe to fill in, processId has to be set.
+ * @return True if the current process was found, false otherwise.
  */
-std::string FindArgWithPrefix(const std::string& prefix) {
-    std::wstring cmdLineW = GetCommandLineW();
-    std::string cmdLine = WideStringToUTF8(cmdLineW);
+static bool ProbeProcesses(StartupProbe& probe) {
+    HANDLE hSnapshot = CreateProcessSnapshot();
+    if (hSnapshot == INVALID_HANDLE_VALUE) return false;
     
-    size_t pos = cmdLine.find(prefix);
-    if (pos == std::string::npos) return {};
+    PROCESSENTRY32W pe = { sizeof(PROCESSENTRY32W) };
+    bool found = FindProcessByPID(hSnapshot, probe.processId, pe);
+    
+    if (found) {
+        probe.processName = WideStringToUTF8(ToLowerCase(pe.szExeFile));
+        probe.parentId = pe.th32ParentProcessID;
+        
+        if (probe.parentId && FindProcessByPID(hSnapshot, probe.parentId, pe)) {
+            probe.parentName = WideStringToUTF8(ToLowerCase(pe.szExeFile));
+        }
+    }
     
-    return cmdLine.substr(pos + prefix.length());
+    CloseHandle(hSnapshot);
+    return found;
 }
 
 /** 
- * Extracts a quoted path from a string starting at a specific position.
+ * Reads the arguments the gate cares about from the command line, which is converted to UTF-8 and split once.
  * 
- * @param str The string to search in.
- * @param startPos The position to start searching from.
- * @return The extracted path, or an empty string if not found.
+ * @param probe The probe to fill in.
  */
-std::string ExtractQuotedPath(const std::string& str, size_t startPos) {
-    if (startPos >= str.length() || str[startPos] != '"') return {};
+static void ProbeCommandLine(StartupProbe& probe) {
+    CommandLine commandLine = CommandLine::FromWindows(WideStringToUTF8(GetCommandLineW()));
+    probe.developerMode = commandLine.Has("-dev");
     
-    size_t endPos = str.find('"', startPos + 1);
-    if (endPos == std::string::npos) return {};
-
-    return str.substr(startPos + 1, endPos - startPos - 1);
+    std::string_view steamPath;
+    if (commandLine.Get("-steampath", steamPath)) probe.steamPath = std::string(steamPath);
+    
+    probe.hasDebuggingPort = ParseRemoteDebuggingPort(commandLine, probe.debuggingPort);
 }
 
 /** 
- * Extracts an unquoted path from a string starting at a specific position.
+ * Captures the probe with one process snapshot, where checking the current process and its parent used to take one each.
+ * A parent that started after us can't have started us: steam.exe exited and its PID was handed to another process.
  * 
- * @param str The string to search in.
- * @param startPos The position to start searching from.
- * @return The extracted path, or an empty string if not found.
+ * @param probe Receives the probe.
+ * @return True if the current process was found in the snapshot, false otherwise.
  */
-std::string ExtractUnquotedPath(const std::string& str, size_t startPos) {
-    size_t endPos = startPos;
+bool CaptureStartupProbe(StartupProbe& probe) {
+    probe.processId = GetCurrentProcessId();
+    bool found = ProbeProcesses(probe);
     
-    while (endPos < str.length()) {
-        if (str.substr(endPos, 4) == ".exe") { endPos += 4; break; }
-        if (str[endPos] == ' ' && endPos + 1 < str.length() && str[endPos + 1] == '-') break;
-        if (endPos == str.length() - 1) { endPos++; break; }
-          
-        endPos++;
+    uint64_t startTime = 0;
+    uint64_t parentStartTime = 0;
+    if (!probe.parentName.empty() && GetProcessStartTime(probe.processId, startTime) 
+        && GetProcessStartTime(probe.parentId, parentStartTime) && parentStartTime > startTime) {
+        probe.parentName.clear();
     }
     
-    return str.substr(startPos, endPos - startPos);
-}
-
-/** 
- * Extracts a path from a command line argument string.
- * 
- * @param argStr The argument string to extract the path from.
- * @return The extracted path, or an empty string if not found.
- */
-std::string ExtractPathFromArg(const std::string& argStr) {
-    if (argStr.empty()) return {};
-    return argStr[0] == '"' ? ExtractQuotedPath(argStr, 0) : ExtractUnquotedPath(argStr, 0);
-}
-
-/** 
- * Retrieves the Steam installation path from the command line arguments.
- * 
- * The path is expected to be provided with the "-steampath=" prefix.
- * 
- * @return The Steam installation path, or an empty string if not found.
- */
-std::string GetSteamPath() {
-    std::string steamPathArg = FindArgWithPrefix("-steampath=");
-    return ExtractPathFromArg(steamPathArg);
+    ProbeCommandLine(probe);
+    return found;
 }
 
 /** 
@@ -276,10 +138,6 @@ std::string GetSteamPath() {
  * 
  * @return True if the current process is steamwebhelper.exe and its parent is steam.exe, false otherwise.
  */
-BOOL IsSteamWebHelper() {
-    std::wstring currentProc = GetCurrentProcessName();
-    std::wstring parentProc = GetParentProcessName();
-    std::wstring parentProcLower = ToLowerCase(parentProc);
-    
-    return (currentProc == L"steamwebhelper.exe" && parentProcLower == L"steam.exe");
+bool StartupProbe::IsSteamWebHelper() const {
+    return processName == "steamwebhelper.exe" && parentName == "steam.exe";
 }
\ No newline at end of file
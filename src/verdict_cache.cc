@@ -0,0 +1,109 @@
+#include <verdict_cache.h>
+
+void VerdictSlot::Publish(Verdict value) {
+    std::vector<std::function<void(Verdict)>> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        Verdict expected = Verdict::Pending;
+        if (verdict.compare_exchange_strong(expected, value, std::memory_order_acq_rel)) {
+            callbacks.swap(continuations);
+        }
+    }
+    ready.notify_all();
+
+    /** Outside the lock, a callback may well look at this slot again. */
+    for (auto& callback : callbacks) {
+        callback(value);
+    }
+}
+
+bool VerdictSlot::OnPublished(std::function<void(Verdict)> callback) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (Load() != Verdict::Pending) return false;
+
+    continuations.push_back(std::move(callback));
+    return true;
+}
+
+Verdict VerdictSlot::Wait(std::chrono::milliseconds timeout) {
+    Verdict current = Load();
+    if (current != Verdict::Pending) return current;
+
+    std::unique_lock<std::mutex> guard(lock);
+    ready.wait_for(guard, timeout, [this] { return Load() != Verdict::Pending; });
+
+    current = Load();
+    return current == Verdict::Pending ? Verdict::Block : current;
+}
+
+/**
+ * Pick the shard for a socket handle.
+ * Windows socket handles are multiples of 4 and file descriptors are small sequential integers, so the raw value is mixed
+ * with a multiplicative hash first to spread neighbouring handles over different shards.
+ */
+SocketVerdictTable::Shard& SocketVerdictTable::ShardFor(uint64_t socket) const {
+    uint64_t hash = (socket >> 2) * 0x9E3779B97F4A7C15ull;
+    return shards[(hash >> 58) % SHARD_COUNT];
+}
+
+Verdict SocketVerdictTable::Lookup(uint64_t socket) const {
+    Shard& shard = ShardFor(socket);
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+
+    auto it = shard.entries.find(socket);
+    return it == shard.entries.end() ? Verdict::Unknown : it->second->Load();
+}
+
+Verdict SocketVerdictTable::Insert(uint64_t socket, Verdict verdict) {
+    bool created = false;
+    std::shared_ptr<VerdictSlot> slot = Acquire(socket, created);
+
+    /** Publish doesn't overwrite, so whichever thread finished the check first wins. */
+    slot->Publish(verdict);
+    return slot->Load();
+}
+
+std::shared_ptr<VerdictSlot> SocketVerdictTable::Acquire(uint64_t socket, bool& created) {
+    Shard& shard = ShardFor(socket);
+    {
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        auto it = shard.entries.find(socket);
+        if (it != shard.entries.end()) {
+            created = false;
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+    auto result = shard.entries.emplace(socket, nullptr);
+    if (result.second) {
+        result.first->second = std::make_shared<VerdictSlot>();
+    }
+    created = result.second;
+    return result.first->second;
+}
+
+void SocketVerdictTable::Evict(uint64_t socket) {
+    std::shared_ptr<VerdictSlot> slot;
+    {
+        Shard& shard = ShardFor(socket);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        auto it = shard.entries.find(socket);
+        if (it == shard.entries.end()) return;
+
+        slot = std::move(it->second);
+        shard.entries.erase(it);
+    }
+
+    /** A check still queued for the closed socket has nothing left to protect, this lets the resolver skip it and wakes any waiter. */
+    slot->Publish(Verdict::Block);
+}
+
+size_t SocketVerdictTable::Size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < SHARD_COUNT; i++) {
+        std::shared_lock<std::shared_mutex> guard(shards[i].lock);
+        total += shards[i].entries.size();
+    }
+    return total;
+}
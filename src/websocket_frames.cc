@@ -0,0 +1,128 @@
+#include <websocket_frames.h>
+#include <algorithm>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/** Payloads are unmasked into a buffer of this size on the stack, one piece at a time. */
+static const size_t UNMASK_CHUNK = 512;
+
+void UnmaskPayload(const char* input, char* output, size_t length, const uint8_t mask[4], uint64_t offset) {
+    /** The key repeats every 4 bytes, so a 16 byte block always starts with the same rotation of it. */
+    uint8_t key[16];
+    for (size_t i = 0; i < sizeof(key); i++) key[i] = mask[(offset + i) & 3];
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i block = _mm_loadu_si128((const __m128i*)key);
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(input + i));
+        _mm_storeu_si128((__m128i*)(output + i), _mm_xor_si128(chunk, block));
+    }
+#endif
+    for (; i < length; i++) {
+        output[i] = (char)(input[i] ^ key[i & 15]);
+    }
+}
+
+bool WebSocketFrameParser::StartFrame(Sink& sink) {
+    finalFrame = (header[0] & 0x80) != 0;
+    frameOpcode = (Opcode)(header[0] & 0x0F);
+    uint8_t shortLength = header[1] & 0x7F;
+
+    if (shortLength == 126) {
+        payloadLength = ((uint64_t)header[2] << 8) | header[3];
+    } else if (shortLength == 127) {
+        payloadLength = 0;
+        for (size_t i = 2; i < 10; i++) payloadLength = (payloadLength << 8) | header[i];
+        if (payloadLength >> 63) return false;
+    } else {
+        payloadLength = shortLength;
+    }
+    memcpy(mask, header + headerLength - 4, sizeof(mask));
+    payloadOffset = 0;
+
+    switch (frameOpcode) {
+        case Opcode::Continuation:
+            if (!inMessage) return false;
+            break;
+        case Opcode::Text:
+        case Opcode::Binary:
+            if (inMessage) return false;
+            inMessage = true;
+            sink.OnMessageStart(frameOpcode);
+            break;
+        case Opcode::Close:
+        case Opcode::Ping:
+        case Opcode::Pong:
+            if (!finalFrame || payloadLength > 125) return false;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool WebSocketFrameParser::Feed(const char* data, size_t length, Sink& sink) {
+    const char* position = data;
+    const char* end = data + length;
+
+    while (position < end && state != State::Invalid) {
+        if (state == State::Header) {
+            /** The first two bytes tell how long the rest of the header is. */
+            if (headerLength < 2) {
+                header[headerLength++] = (uint8_t)*position++;
+                if (headerLength < 2) continue;
+
+                if (!(header[1] & 0x80) || (header[0] & 0x70)) {
+                    /** Client frames have to be masked, and no extension that sets reserved bits was negotiated with us. */
+                    state = State::Invalid;
+                    break;
+                }
+            }
+
+            uint8_t shortLength = header[1] & 0x7F;
+            size_t needed = 2 + (shortLength == 126 ? 2 : shortLength == 127 ? 8 : 0) + 4;
+            size_t copied = std::min((size_t)(end - position), needed - headerLength);
+            memcpy(header + headerLength, position, copied);
+            headerLength += (uint8_t)copied;
+            position += copied;
+            if (headerLength < needed) continue;
+
+            bool valid = StartFrame(sink);
+            headerLength = 0;
+            if (!valid) {
+                state = State::Invalid;
+                break;
+            }
+            state = State::Payload;
+        }
+
+        uint64_t remaining = payloadLength - payloadOffset;
+        size_t available = (size_t)std::min<uint64_t>((uint64_t)(end - position), remaining);
+
+        if (frameOpcode == Opcode::Continuation || frameOpcode == Opcode::Text || frameOpcode == Opcode::Binary) {
+            char unmasked[UNMASK_CHUNK];
+            for (size_t done = 0; done < available;) {
+                size_t piece = std::min(available - done, UNMASK_CHUNK);
+                UnmaskPayload(position + done, unmasked, piece, mask, payloadOffset + done);
+                sink.OnMessageData(unmasked, piece);
+                done += piece;
+            }
+        }
+        position += available;
+        payloadOffset += available;
+
+        if (payloadOffset == payloadLength) {
+            state = State::Header;
+            bool dataFrame = frameOpcode == Opcode::Continuation || frameOpcode == Opcode::Text || frameOpcode == Opcode::Binary;
+            if (dataFrame && finalFrame) {
+                inMessage = false;
+                sink.OnMessageEnd();
+            }
+        }
+    }
+
+    return state != State::Invalid;
+}